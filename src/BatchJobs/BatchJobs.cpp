@@ -0,0 +1,225 @@
+#include "BatchJobs.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ConfigFile/ConfigSchema.h"
+#include "Optimizer/Optimizer.h"
+#include "RaceConfig/RaceSchedule/RaceSchedule.h"
+#include "RaceConfig/Route/Route.h"
+#include "RaceConfig/Weather/Weather.h"
+#include "RaceConfig/WeatherStations/WeatherStations.h"
+#include "SolarCar/SolarCar.h"
+#include "Tools/Json.h"
+#include "Tools/Trace.h"
+#include "Tools/WorkStealing.h"
+
+namespace {
+	/// An input loaded once for every job using it, or why it could not be
+	template <typename T>
+	struct Loaded {
+		std::unique_ptr<const T> value;
+		std::string error;
+	};
+
+	template <typename T, typename Load>
+	Loaded<T> load(const std::string& file, const InputLoadHook& on_load, const Load& load_file) {
+		if (on_load) {
+			on_load(file);
+		}
+		try {
+			return {.value = std::make_unique<const T>(load_file()), .error = {}};
+		} catch (const std::exception& error) {
+			return {.value = nullptr, .error = file + ": " + error.what()};
+		}
+	}
+
+	/// Every distinct input of the jobs of a manifest
+	struct Inputs {
+		using FileAndStations = std::pair<std::string, std::string>;
+		std::map<std::string, Loaded<SolarCar>> cars;
+		std::map<std::string, Loaded<WeatherStations>> weather_stations;
+		std::map<std::string, Loaded<RaceSchedule>> schedules;
+		std::map<FileAndStations, Loaded<Route>> routes;
+		std::map<FileAndStations, Loaded<Weather>> weather;
+	};
+
+	/// The loads of one stage of load_inputs(), each filling in an entry of the inputs no other load touches
+	using Loads = std::vector<std::function<void()>>;
+
+	/// Adds the load of an input to @p loads, unless another job already added it
+	template <typename T, typename Key, typename Load>
+	void add_load(Loads& loads, std::map<Key, Loaded<T>>& inputs, const Key& key, const std::string& file,
+		const InputLoadHook& on_load, Load load_file) {
+		const auto [entry, added] = inputs.try_emplace(key);
+		if (added) {
+			loads.emplace_back([&loaded = entry->second, &file, &on_load, load_file = std::move(load_file)] {
+				loaded = load<T>(file, on_load, load_file);
+			});
+		}
+	}
+
+	void run_loads(const Loads& loads, size_t num_threads) {
+		work_stealing::for_each_index(loads.size(), num_threads, [&](size_t index) { loads[index](); });
+	}
+
+	/// Loads in two stages on the work-stealing pool: the cars, weather stations and schedules, then the routes and
+	/// weather that need the stations and the schedules
+	Inputs load_inputs(const std::vector<BatchJob>& jobs, size_t num_threads, const InputLoadHook& on_load) {
+		Inputs inputs;
+		Loads loads;
+		for (const BatchJob& job : jobs) {
+			add_load(loads, inputs.cars, job.car_file, job.car_file, on_load,
+				[&job] { return SolarCar(read_config(job.car_file)); });
+			add_load(loads, inputs.weather_stations, job.weather_stations_file, job.weather_stations_file, on_load,
+				[&job] { return WeatherStations(job.weather_stations_file); });
+			add_load(loads, inputs.schedules, job.schedule_file, job.schedule_file, on_load,
+				[&job] { return RaceSchedule(read_config(job.schedule_file)); });
+		}
+		run_loads(loads, num_threads);
+
+		// One weather load per (weather, stations) pair, covering the schedules of every job using it
+		std::map<Inputs::FileAndStations, std::vector<const RaceSchedule*>> weather_schedules;
+		for (const BatchJob& job : jobs) {
+			auto& schedules = weather_schedules[{job.weather_file, job.weather_stations_file}];
+			const RaceSchedule* schedule = inputs.schedules.at(job.schedule_file).value.get();
+			if (schedule != nullptr) {
+				schedules.push_back(schedule);
+			}
+		}
+
+		loads.clear();
+		for (const BatchJob& job : jobs) {
+			const Inputs::FileAndStations route_key = {job.route_file, job.weather_stations_file};
+			const Inputs::FileAndStations weather_key = {job.weather_file, job.weather_stations_file};
+			const Loaded<WeatherStations>& stations = inputs.weather_stations.at(job.weather_stations_file);
+			if (!stations.value) {
+				inputs.routes.emplace(route_key, Loaded<Route>{.value = nullptr, .error = stations.error});
+				inputs.weather.emplace(weather_key, Loaded<Weather>{.value = nullptr, .error = stations.error});
+				continue;
+			}
+			add_load(loads, inputs.routes, route_key, job.route_file, on_load,
+				[&job, &stations] { return Route(job.route_file, *stations.value); });
+			const WeatherTimeWindow window = WeatherTimeWindow::from_schedules(weather_schedules.at(weather_key));
+			add_load(loads, inputs.weather, weather_key, job.weather_file, on_load,
+				[&job, &stations, window] { return Weather(job.weather_file, *stations.value, window); });
+		}
+		run_loads(loads, num_threads);
+		return inputs;
+	}
+
+	/// @return the JSON line of a job
+	std::string run_job(const Inputs& inputs, const BatchJob& job, size_t index, bool& failed) {
+		std::string line = "{\"job\": " + std::to_string(index) + ", \"name\": ";
+		json::append_string(line, job.name);
+
+		const auto& car = inputs.cars.at(job.car_file);
+		const auto& schedule = inputs.schedules.at(job.schedule_file);
+		const auto& route = inputs.routes.at({job.route_file, job.weather_stations_file});
+		const auto& weather = inputs.weather.at({job.weather_file, job.weather_stations_file});
+		std::string error;
+		for (const std::string* input_error : {&car.error, &schedule.error, &route.error, &weather.error}) {
+			if (error.empty()) {
+				error = *input_error;
+			}
+		}
+
+		std::optional<Optimizer::OptimizationOutput> solution;
+		if (error.empty()) {
+			try {
+				const std::unique_ptr<const Optimizer> optimizer = Optimizer::create_optimizer(
+					job.optimizer_type, *car.value, *weather.value, *route.value, *schedule.value);
+				solution = optimizer->optimize_race();
+			} catch (const std::exception& exception) {
+				error = "optimizer " + job.optimizer_type + ": " + exception.what();
+			}
+		}
+
+		failed = !error.empty();
+		if (failed) {
+			line += ", \"status\": \"error\", \"error\": ";
+			json::append_string(line, error);
+		} else if (!solution) {
+			line += ", \"status\": \"unfinished\"";
+		} else {
+			line += ", \"status\": \"finished\", \"race_time\": ";
+			json::append_number(line, solution->racetime);
+			line += ", \"speed\": ";
+			json::append_number(line, solution->speed);
+		}
+		line += '}';
+		return line;
+	}
+}  // namespace
+
+JobManifest JobManifest::from_config(const ConfigFile& manifest, std::string_view manifest_directory) {
+	const std::filesystem::path directory(manifest_directory);
+	const std::optional<ConfigFile> defaults = manifest.get_path<ConfigFile>("defaults");
+	std::vector<std::string> problems;
+
+	JobManifest jobs;
+	jobs.threads = static_cast<size_t>(std::max<int64_t>(0, manifest.get<int64_t>("threads").value_or(0)));
+	const auto job_configs = manifest.get_array<ConfigFile>("job").value_or(std::vector<ConfigFile>{});
+	for (size_t index = 0; index < job_configs.size(); ++index) {
+		const ConfigFile& job_config = job_configs[index];
+		const auto read = [&](std::string_view key, bool is_path) {
+			std::optional<std::string> value = job_config.get<std::string>(key);
+			if (!value && defaults) {
+				value = defaults->get<std::string>(key);
+			}
+			if (!value) {
+				problems.push_back("job " + std::to_string(index) + ": missing key " + std::string(key));
+				return std::string();
+			}
+			return is_path ? (directory / *value).lexically_normal().string() : *value;
+		};
+		jobs.jobs.push_back({
+			.name = job_config.get<std::string>("name").value_or(std::to_string(index)),
+			.car_file = read("car", true),
+			.weather_file = read("weather", true),
+			.weather_stations_file = read("stations", true),
+			.route_file = read("route", true),
+			.schedule_file = read("schedule", true),
+			.optimizer_type = read("optimizer", false),
+		});
+	}
+	if (!problems.empty()) {
+		throw ConfigSchemaError(std::move(problems));
+	}
+	return jobs;
+}
+
+JobManifest JobManifest::from_path(std::string_view manifest_file) {
+	const std::optional<ConfigFile> manifest = ConfigFile::from_path(manifest_file);
+	if (!manifest) {
+		throw std::invalid_argument("could not read job manifest " + std::string(manifest_file));
+	}
+	return from_config(*manifest, std::filesystem::path(manifest_file).parent_path().string());
+}
+
+size_t run_jobs(const JobManifest& manifest, std::ostream& out, const InputLoadHook& on_load) {
+	const Inputs inputs = load_inputs(manifest.jobs, manifest.threads, on_load);
+
+	std::mutex out_mutex;
+	size_t num_failed = 0;
+	work_stealing::for_each_index(manifest.jobs.size(), manifest.threads, [&](size_t index) {
+		MINISIM_TRACE_SCOPE_ARG("batch_jobs.job", "job", index);
+		bool failed = false;
+		const std::string line = run_job(inputs, manifest.jobs[index], index, failed);
+		const std::lock_guard lock(out_mutex);
+		out << line << '\n' << std::flush;
+		num_failed += failed ? 1 : 0;
+	});
+	return num_failed;
+}
@@ -0,0 +1,65 @@
+#ifndef MINISIM_BATCHJOBS_H
+#define MINISIM_BATCHJOBS_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ConfigFile/ConfigFile.h"
+
+/// @brief One scenario of a job manifest: the same inputs as a single minisim run
+struct BatchJob {
+	std::string name;
+	std::string car_file;
+	std::string weather_file;
+	std::string weather_stations_file;
+	std::string route_file;
+	std::string schedule_file;
+	std::string optimizer_type;
+};
+
+/// @brief The scenarios of a job manifest (minisim --jobs manifest.toml):
+///
+///     threads = 8              # optional, default: one per hardware thread
+///
+///     [defaults]               # optional: what the jobs leave out
+///     car = "data/Cars/mini-car.toml"
+///     stations = "data/Stations/australia_stations.csv"
+///     route = "data/Route/route.csv"
+///     optimizer = "binary"
+///
+///     [[job]]
+///     name = "2007"            # optional, default: the index of the job
+///     weather = "data/Weather/Australia/August/2007.csv"
+///     schedule = "data/Schedule/August/Schedule2007.toml"
+///
+/// Relative paths are relative to the directory of the manifest.
+struct JobManifest {
+	std::vector<BatchJob> jobs;
+	/// 0 for one per hardware thread
+	size_t threads = 0;
+
+	/// @throws ConfigSchemaError listing every job key that is missing (from the job and the defaults) or not a string
+	static JobManifest from_config(const ConfigFile& manifest, std::string_view manifest_directory);
+	/// @throws std::invalid_argument if the manifest cannot be read, or see from_config()
+	static JobManifest from_path(std::string_view manifest_file);
+};
+
+/// @brief Called by run_jobs() with the path of every input file as it starts loading it, possibly from several
+/// threads at once
+using InputLoadHook = std::function<void(const std::string& file)>;
+
+/// @brief Runs every job of a manifest, writing one JSON line per job to @p out as soon as it finishes:
+///
+///     {"job": 0, "name": "2007", "status": "finished", "race_time": 123.4, "speed": 25.1}
+///
+/// The status is "finished", "unfinished" (the car could not finish the race) or "error" (with an "error" message).
+/// Every distinct input file is loaded once, however many jobs share it; the weather is loaded for the schedules of
+/// all the jobs that use it. The loads and then the jobs run on a work-stealing pool.
+/// @param on_load if given, called for every input file loaded
+/// @return the number of jobs with an error
+size_t run_jobs(const JobManifest& manifest, std::ostream& out, const InputLoadHook& on_load = {});
+
+#endif  // MINISIM_BATCHJOBS_H
@@ -0,0 +1,186 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BatchJobs.h"
+#include "ConfigFile/ConfigSchema.h"
+#include "TestSupport/TestSupport.h"
+#include "Tools/Json.h"
+#include "Tools/RootDirectory.h"
+
+using test_support::text_of;
+
+namespace {
+	/// 2007-08-22T00:00:00Z, two days before the 2007 schedule starts
+	constexpr double WEATHER_START_TIME = 1187740800.0;
+
+	std::vector<json::Value> read_lines(const std::string& text) {
+		std::vector<json::Value> lines;
+		std::istringstream in(text);
+		for (std::string line; std::getline(in, line);) {
+			lines.push_back(json::parse(line));
+		}
+		return lines;
+	}
+}  // namespace
+
+TEST_CASE("JobManifest: from_config", "[BatchJobs]") {
+	SECTION("Jobs take what they leave out from the defaults, relative to the manifest") {
+		const ConfigFile config = ConfigFile::from_toml(R"(
+			threads = 3
+			[defaults]
+			car = "cars/mini-car.toml"
+			stations = "stations.csv"
+			route = "route.csv"
+			optimizer = "binary"
+			[[job]]
+			name = "first"
+			weather = "weather/2007.csv"
+			schedule = "../schedules/2007.toml"
+			[[job]]
+			car = "/cars/other-car.toml"
+			weather = "weather/2008.csv"
+			schedule = "2008.toml"
+			optimizer = "linear"
+		)").value();
+		const JobManifest manifest = JobManifest::from_config(config, "/runs/manifests");
+		CHECK(manifest.threads == 3);
+		REQUIRE(manifest.jobs.size() == 2);
+
+		const BatchJob& first = manifest.jobs[0];
+		CHECK(first.name == "first");
+		CHECK(first.car_file == "/runs/manifests/cars/mini-car.toml");
+		CHECK(first.weather_file == "/runs/manifests/weather/2007.csv");
+		CHECK(first.weather_stations_file == "/runs/manifests/stations.csv");
+		CHECK(first.route_file == "/runs/manifests/route.csv");
+		CHECK(first.schedule_file == "/runs/schedules/2007.toml");
+		CHECK(first.optimizer_type == "binary");
+
+		// Named by its index, with absolute paths kept as they are
+		const BatchJob& second = manifest.jobs[1];
+		CHECK(second.name == "1");
+		CHECK(second.car_file == "/cars/other-car.toml");
+		CHECK(second.schedule_file == "/runs/manifests/2008.toml");
+		CHECK(second.optimizer_type == "linear");
+	}
+
+	SECTION("Without threads or jobs") {
+		const JobManifest manifest = JobManifest::from_config(ConfigFile(), "");
+		CHECK(manifest.threads == 0);
+		CHECK(manifest.jobs.empty());
+	}
+
+	SECTION("Reports every missing key") {
+		const ConfigFile config = ConfigFile::from_toml(R"(
+			[defaults]
+			car = "car.toml"
+			[[job]]
+			weather = "weather.csv"
+			stations = "stations.csv"
+			route = "route.csv"
+			schedule = "schedule.toml"
+			optimizer = "binary"
+			[[job]]
+			weather = "weather.csv"
+			route = 7
+		)").value();
+		// The car comes from the defaults, and a route that is not a string is missing
+		const std::vector<std::string> expected_problems = {
+			"job 1: missing key stations",
+			"job 1: missing key route",
+			"job 1: missing key schedule",
+			"job 1: missing key optimizer",
+		};
+		try {
+			JobManifest::from_config(config, "");
+			FAIL("no ConfigSchemaError was thrown");
+		} catch (const ConfigSchemaError& error) {
+			CHECK(error.get_problems() == expected_problems);
+		}
+	}
+}
+
+TEST_CASE("BatchJobs: run_jobs", "[BatchJobs]") {
+	const test_support::RaceFiles files("minisim-batch-jobs", WEATHER_START_TIME, 12);
+	const std::string root_directory = get_root_directory();
+	const BatchJob job = {
+		.name = "good",
+		.car_file = root_directory + "/data/Cars/mini-car.toml",
+		.weather_file = files.weather_file,
+		.weather_stations_file = files.stations_file,
+		.route_file = files.route_file,
+		.schedule_file = root_directory + "/data/Schedule/August/Schedule2007.toml",
+		.optimizer_type = "binary",
+	};
+
+	SECTION("A failed input only fails the jobs using it") {
+		JobManifest manifest = {.jobs = {job, job, job, job}, .threads = 2};
+		manifest.jobs[1].name = "no car";
+		manifest.jobs[1].car_file = (files.directory / "missing-car.toml").string();
+		manifest.jobs[2].name = "no weather";
+		manifest.jobs[2].weather_file = (files.directory / "missing-weather.csv").string();
+
+		std::ostringstream out;
+		CHECK(run_jobs(manifest, out) == 2);
+		const std::vector<json::Value> lines = read_lines(out.str());
+		REQUIRE(lines.size() == 4);
+		for (const json::Value& line : lines) {
+			const std::string name = text_of(line, "name");
+			const double index = *line.find("job")->get_if<double>();
+			CHECK(name == manifest.jobs[static_cast<size_t>(index)].name);
+			if (name == "good") {
+				CHECK(text_of(line, "status") == "finished");
+				CHECK(*line.find("race_time")->get_if<double>() > 0.0);
+				CHECK(*line.find("speed")->get_if<double>() > 0.0);
+			} else {
+				CHECK(text_of(line, "status") == "error");
+				const std::string& missing_file =
+					name == "no car" ? manifest.jobs[1].car_file : manifest.jobs[2].weather_file;
+				CHECK(text_of(line, "error").starts_with(missing_file + ": "));
+			}
+		}
+	}
+
+	SECTION("Loads every input file once, however many jobs share it") {
+		JobManifest manifest = {.jobs = {job, job, job, job}, .threads = 4};
+		manifest.jobs[1].optimizer_type = "linear";
+		manifest.jobs[2].schedule_file = root_directory + "/data/Schedule/August/Schedule2007-7.toml";
+		manifest.jobs[3].schedule_file = manifest.jobs[2].schedule_file;
+
+		std::mutex loads_mutex;
+		std::map<std::string, int> loads;
+		std::ostringstream out;
+		run_jobs(manifest, out, [&](const std::string& file) {
+			const std::lock_guard lock(loads_mutex);
+			loads[file] += 1;
+		});
+		CHECK(read_lines(out.str()).size() == 4);
+		const std::map<std::string, int> expected_loads = {
+			{job.car_file, 1},
+			{job.weather_file, 1},
+			{job.weather_stations_file, 1},
+			{job.route_file, 1},
+			{job.schedule_file, 1},
+			{manifest.jobs[2].schedule_file, 1},
+		};
+		CHECK(loads == expected_loads);
+	}
+
+	SECTION("An unknown optimizer only fails its job") {
+		JobManifest manifest = {.jobs = {job, job}, .threads = 1};
+		manifest.jobs[0].name = "unknown optimizer";
+		manifest.jobs[0].optimizer_type = "unknown";
+
+		std::ostringstream out;
+		CHECK(run_jobs(manifest, out) == 1);
+		const std::vector<json::Value> lines = read_lines(out.str());
+		REQUIRE(lines.size() == 2);
+		for (const json::Value& line : lines) {
+			CHECK(text_of(line, "status") == (text_of(line, "name") == "good" ? "finished" : "error"));
+		}
+	}
+}
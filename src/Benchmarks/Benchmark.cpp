@@ -0,0 +1,31 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+
+namespace {
+	volatile double kept = 0.0;
+}  // namespace
+
+void benchmark::keep(double value) {
+	kept = value;
+}
+
+void benchmark::print_results(std::ostream& out, const std::vector<Result>& results) {
+	std::size_t name_width = 9;
+	for (const Result& result : results) {
+		name_width = std::max(name_width, result.name.size());
+	}
+	const int width = static_cast<int>(name_width);
+
+	char line[256];
+	std::snprintf(line, sizeof(line), "%-*s %10s %10s %10s %10s %8s\n", width, "benchmark", "ns/op", "min", "max",
+		"Mops/s", "ops");
+	out << line;
+	for (const Result& result : results) {
+		std::snprintf(line, sizeof(line), "%-*s %10.2f %10.2f %10.2f %10.2f %8zu\n", width, result.name.c_str(),
+			result.ns_per_op, result.min_ns_per_op, result.max_ns_per_op, result.ops_per_second() / 1e6,
+			result.ops_per_pass);
+		out << line;
+	}
+	out.flush();
+}
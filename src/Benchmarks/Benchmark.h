@@ -0,0 +1,83 @@
+#ifndef MINISIM_BENCHMARK_H
+#define MINISIM_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief A small harness for microbenchmarks of the simulation kernels.
+///
+/// A benchmark is a pass over a fixed set of inputs (one operation each) that returns the sum of its outputs, so the
+/// compiler has to compute every one of them. Passes are repeated until a sample lasts about
+/// Options::sample_time, and the median of Options::num_samples samples is reported.
+namespace benchmark {
+	struct Options {
+		std::chrono::duration<double> sample_time = std::chrono::milliseconds(50);
+		int num_samples = 7;
+	};
+
+	struct Result {
+		std::string name;
+		/// operations in one pass over the inputs
+		std::size_t ops_per_pass = 0;
+		/// (ns) the median over the samples
+		double ns_per_op = 0.0;
+		/// (ns) the fastest and slowest samples
+		double min_ns_per_op = 0.0;
+		double max_ns_per_op = 0.0;
+
+		double ops_per_second() const {
+			return 1e9 / ns_per_op;
+		}
+	};
+
+	/// @brief Keeps a result of a benchmark, so the work computing it cannot be optimized away
+	void keep(double value);
+
+	/// @brief Times the passes of a benchmark
+	/// @param pass does @p ops_per_pass operations and returns the sum of their outputs
+	template <typename Pass>
+	Result run(std::string name, std::size_t ops_per_pass, Pass&& pass, const Options& options = {}) {
+		using clock = std::chrono::steady_clock;
+		const auto time_passes = [&](std::size_t num_passes) {
+			double sum = 0.0;
+			const clock::time_point start = clock::now();
+			for (std::size_t index = 0; index < num_passes; ++index) {
+				sum += pass();
+			}
+			const std::chrono::duration<double> elapsed = clock::now() - start;
+			keep(sum);
+			return elapsed.count();
+		};
+
+		// Find how many passes fill a sample, which also warms up the caches and branch predictors
+		std::size_t num_passes = 1;
+		double seconds = time_passes(num_passes);
+		while (seconds < options.sample_time.count() / 8) {
+			num_passes *= 2;
+			seconds = time_passes(num_passes);
+		}
+		num_passes = std::max<std::size_t>(
+			1, static_cast<std::size_t>(static_cast<double>(num_passes) * options.sample_time.count() / seconds));
+
+		std::vector<double> samples;
+		for (int sample = 0; sample < options.num_samples; ++sample) {
+			samples.push_back(time_passes(num_passes) * 1e9 / static_cast<double>(num_passes * ops_per_pass));
+		}
+		std::sort(samples.begin(), samples.end());
+		return {.name = std::move(name),
+			.ops_per_pass = ops_per_pass,
+			.ns_per_op = samples[samples.size() / 2],
+			.min_ns_per_op = samples.front(),
+			.max_ns_per_op = samples.back()};
+	}
+
+	/// @brief Writes one aligned row per result: ns/op (median, min, max) and throughput in millions of ops per second
+	void print_results(std::ostream& out, const std::vector<Result>& results);
+}  // namespace benchmark
+
+#endif  // MINISIM_BENCHMARK_H
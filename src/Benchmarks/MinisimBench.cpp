@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Benchmark.h"
+#include "PinnedRace.h"
+#include "RaceConfig/RaceSchedule/RaceSchedule.h"
+#include "RaceConfig/Route/Route.h"
+#include "RaceConfig/Weather/Weather.h"
+#include "RaceConfig/Weather/WeatherCursor.h"
+#include "RaceSegmentRunner/RaceSegmentRunner.h"
+#include "SolarCar/SolarCar.h"
+
+namespace {
+	/// (m/s) the speed the car drives at where the speed limit allows it
+	constexpr double CRUISING_SPEED = 25.0;
+
+	/// @brief The inputs of each component along one drive of the route, one per segment: what the kernels see in a
+	/// race, rather than uniform random numbers
+	struct RaceInputs {
+		explicit RaceInputs(benchmark::PinnedRace race) : race(std::move(race)) {}
+
+		benchmark::PinnedRace race;
+		std::vector<RouteSegment> segments;
+
+		/// (m/s)
+		std::vector<double> speeds;
+		/// (N) the load on each tire
+		std::vector<double> tire_loads;
+		/// the time the car starts and finishes each segment
+		std::vector<double> start_times;
+		std::vector<double> end_times;
+		std::vector<WeatherDataPoint> weather_data;
+		std::vector<VelocityVector> car_velocities;
+		std::vector<ApparentWindVector> apparent_winds;
+		/// (rad/s)
+		std::vector<double> angular_speeds;
+		/// (Nm)
+		std::vector<double> torques;
+		/// (W) power out minus power in, before battery losses
+		std::vector<double> net_powers_demanded;
+		std::vector<double> states_of_charge;
+
+		std::size_t size() const {
+			return segments.size();
+		}
+	};
+
+	RaceInputs make_race_inputs() {
+		RaceInputs inputs(benchmark::PinnedRace::load());
+		const SolarCar& car = inputs.race.car;
+		const Route& route = inputs.race.route;
+		const RaceSchedule& schedule = inputs.race.schedule;
+		const RaceSegmentRunner runner(car);
+
+		// Drive the route day by day, like RaceRunner::calculate_racetime
+		std::size_t day = 0;
+		double time = schedule[day].race_start_time;
+		const std::size_t num_segments = route.get_num_segments();
+		for (std::size_t index = 0; index < num_segments; ++index) {
+			const RouteSegment segment = route.get_segment(index);
+			const double speed = std::min(segment.speed_limit, CRUISING_SPEED);
+			const double duration = segment.distance / speed;
+			if (time + duration > schedule[day].race_end_time && day + 1 < schedule.size()) {
+				time = schedule[++day].race_start_time;
+			}
+			const WeatherDataPoint weather_data = inputs.race.weather.get_weather_during(
+				segment.weather_station, time, time + duration);
+			const VelocityVector car_velocity = VelocityVector::from_polar_components(speed, segment.heading);
+			const double resistive_force = runner.calculate_resistive_force(segment, weather_data, speed);
+			const double angular_speed = speed / car.wheel_radius;
+			const double torque = resistive_force * car.wheel_radius;
+			const double power_out = car.motor.power_consumed(angular_speed, torque);
+
+			inputs.segments.push_back(segment);
+			inputs.speeds.push_back(speed);
+			inputs.tire_loads.push_back(car.mass / 3.0 * segment.gravity);
+			inputs.start_times.push_back(time);
+			inputs.end_times.push_back(time + duration);
+			inputs.weather_data.push_back(weather_data);
+			inputs.car_velocities.push_back(car_velocity);
+			inputs.apparent_winds.push_back(Aerobody::get_wind(weather_data.wind, car_velocity));
+			inputs.angular_speeds.push_back(angular_speed);
+			inputs.torques.push_back(torque);
+			inputs.net_powers_demanded.push_back(power_out - car.array.power_in(weather_data.irradiance));
+			// The battery drains over the race
+			inputs.states_of_charge.push_back(
+				1.0 - 0.8 * static_cast<double>(index) / static_cast<double>(num_segments));
+			time += duration;
+		}
+		return inputs;
+	}
+
+	std::vector<benchmark::Result> run_benchmarks(const RaceInputs& inputs, const std::vector<std::string>& filters) {
+		const auto is_selected = [&](std::string_view name) {
+			return filters.empty() || std::any_of(filters.begin(), filters.end(), [&](const std::string& filter) {
+				return name.find(filter) != std::string_view::npos;
+			});
+		};
+		std::vector<benchmark::Result> results;
+		const auto run = [&](std::string name, auto&& operation) {
+			if (!is_selected(name)) {
+				return;
+			}
+			results.push_back(benchmark::run(std::move(name), inputs.size(), [&] {
+				double sum = 0.0;
+				for (std::size_t index = 0; index < inputs.size(); ++index) {
+					sum += operation(index);
+				}
+				return sum;
+			}));
+		};
+
+		const SolarCar& car = inputs.race.car;
+		run("tire.rolling_resistance", [&](std::size_t index) {
+			return car.tire.rolling_resistance(inputs.tire_loads[index], inputs.speeds[index]);
+		});
+		run("aerobody.get_wind", [&](std::size_t index) {
+			return Aerobody::get_wind(inputs.weather_data[index].wind, inputs.car_velocities[index]).speed;
+		});
+		run("aerobody.aerodynamic_drag", [&](std::size_t index) {
+			return car.aerobody.aerodynamic_drag(inputs.apparent_winds[index], inputs.weather_data[index].air_density);
+		});
+		run("motor.power_consumed", [&](std::size_t index) {
+			return car.motor.power_consumed(inputs.angular_speeds[index], inputs.torques[index]);
+		});
+		run("battery.power_loss", [&](std::size_t index) {
+			return car.battery.power_loss(inputs.net_powers_demanded[index], inputs.states_of_charge[index])
+				.value_or(0.0);
+		});
+		run("array.power_in", [&](std::size_t index) {
+			return car.array.power_in(inputs.weather_data[index].irradiance);
+		});
+
+		const RaceSegmentRunner runner(car);
+		run("race_segment_runner.calculate_power_net", [&](std::size_t index) {
+			return runner
+				.calculate_power_net(inputs.segments[index], inputs.weather_data[index], inputs.states_of_charge[index],
+					inputs.speeds[index])
+				.value_or(0.0);
+		});
+
+		const Weather& weather = inputs.race.weather;
+		run("weather.get_weather_at", [&](std::size_t index) {
+			return weather.get_weather_at(inputs.segments[index].weather_station, inputs.start_times[index]).irradiance;
+		});
+		run("weather.get_weather_during", [&](std::size_t index) {
+			return weather
+				.get_weather_during(inputs.segments[index].weather_station, inputs.start_times[index],
+					inputs.end_times[index])
+				.irradiance;
+		});
+		run("weather.get_weather_during.exact", [&](std::size_t index) {
+			return weather
+				.get_weather_during(inputs.segments[index].weather_station, inputs.start_times[index],
+					inputs.end_times[index], WeatherAveraging::EXACT)
+				.irradiance;
+		});
+		if (is_selected("weather_cursor.get_weather_during")) {
+			// A new cursor each pass, as each race makes one
+			results.push_back(benchmark::run("weather_cursor.get_weather_during", inputs.size(), [&] {
+				WeatherCursor cursor(weather);
+				double sum = 0.0;
+				for (std::size_t index = 0; index < inputs.size(); ++index) {
+					sum += cursor
+							   .get_weather_during(inputs.segments[index].weather_station, inputs.start_times[index],
+								   inputs.end_times[index])
+							   .irradiance;
+				}
+				return sum;
+			}));
+		}
+		return results;
+	}
+}  // namespace
+
+int main(int argc, char** argv) {
+	std::vector<std::string> filters;
+	for (int index = 1; index < argc; ++index) {
+		const std::string_view arg = argv[index];
+		if (arg == "-h" || arg == "--help") {
+			std::cout << "Usage: minisim_bench [filter...]\n\n"
+						 "Times each physics component and weather query on the inputs of one drive of\n"
+						 "data/Route/route.csv with data/Cars/mini-car.toml, in ns per operation and millions of\n"
+						 "operations per second. Only the benchmarks whose names contain a filter are run.\n";
+			return 0;
+		}
+		filters.emplace_back(arg);
+	}
+
+	try {
+		const RaceInputs inputs = make_race_inputs();
+		std::cout << "[BENCH] " << inputs.size() << " route segments\n";
+		const std::vector<benchmark::Result> results = run_benchmarks(inputs, filters);
+		std::cout << "\n";
+		benchmark::print_results(std::cout, results);
+	} catch (const std::exception& error) {
+		std::cerr << "[ERROR] " << error.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,48 @@
+#include "PinnedRace.h"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ConfigFile/ConfigFile.h"
+#include "RaceConfig/Synthetic/SyntheticInputs.h"
+#include "Tools/RootDirectory.h"
+
+namespace {
+	constexpr double HOUR = 3600.0;
+	constexpr std::uint64_t WEATHER_SEED = 1;
+}  // namespace
+
+benchmark::PinnedRace benchmark::PinnedRace::load() {
+	const std::string root_directory = get_root_directory();
+	const WeatherStations weather_stations(root_directory + "/data/Stations/australia_stations.csv");
+	Route route(root_directory + "/data/Route/route.csv", weather_stations);
+	RaceSchedule schedule(read_config(root_directory + "/data/Schedule/August/Schedule2007.toml"));
+	Weather weather = make_weather(WeatherTimeWindow::from_schedule(schedule), weather_stations);
+	return {
+		.car = SolarCar(read_config(root_directory + "/data/Cars/mini-car.toml")),
+		.route = std::move(route),
+		.schedule = std::move(schedule),
+		.weather = std::move(weather),
+	};
+}
+
+Weather benchmark::make_weather(const WeatherTimeWindow& window, const WeatherStations& weather_stations) {
+	std::vector<GeographicalCoordinate> coordinates;
+	for (std::size_t index = 0; index < weather_stations.size(); ++index) {
+		coordinates.push_back(weather_stations[index]);
+	}
+	// Whole hours, and one more on both sides, so the race never queries past the forecasts
+	const std::vector<WeatherForecastRow> rows = synthetic::generate_weather(coordinates,
+		{
+			.seed = WEATHER_SEED,
+			.start_time = (std::floor(window.start_time / HOUR) - 1.0) * HOUR,
+			.end_time = (std::ceil(window.end_time / HOUR) + 1.0) * HOUR,
+			.period = HOUR,
+		});
+	Weather weather;
+	weather.update(rows);
+	return weather;
+}
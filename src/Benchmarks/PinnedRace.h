@@ -0,0 +1,29 @@
+#ifndef MINISIM_PINNEDRACE_H
+#define MINISIM_PINNEDRACE_H
+
+#include "RaceConfig/RaceSchedule/RaceSchedule.h"
+#include "RaceConfig/Route/Route.h"
+#include "RaceConfig/Weather/Weather.h"
+#include "RaceConfig/WeatherStations/WeatherStations.h"
+#include "SolarCar/SolarCar.h"
+
+namespace benchmark {
+	/// @brief The race every benchmark runs, so results stay comparable between commits: the mini car on
+	/// data/Route/route.csv with the August 2007 schedule, and weather generated by make_weather()
+	struct PinnedRace {
+		SolarCar car;
+		Route route;
+		RaceSchedule schedule;
+		Weather weather;
+
+		/// @brief Loads the race from the data directory
+		/// @throws std::runtime_error if a file is missing
+		static PinnedRace load();
+	};
+
+	/// @brief Hourly weather for every weather station over a time window, from synthetic::generate_weather() with a
+	/// fixed seed, so it is the same on every run
+	Weather make_weather(const WeatherTimeWindow& window, const WeatherStations& weather_stations);
+}  // namespace benchmark
+
+#endif  // MINISIM_PINNEDRACE_H
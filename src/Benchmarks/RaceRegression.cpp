@@ -0,0 +1,326 @@
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Optimizer/Optimizer.h"
+#include "PinnedRace.h"
+#include "RaceRunner/RaceRunner.h"
+#include "Tools/Json.h"
+#include "Tools/RootDirectory.h"
+
+namespace {
+	/// (m/s) the speeds full races are timed at
+	constexpr double RACE_SPEEDS[] = {20.0, 25.0, 30.0};
+	/// (s) how long each timed repetition of a case lasts at least
+	constexpr double MIN_REPETITION_SECONDS = 0.02;
+
+	struct CommandLine {
+		std::string baseline_file = get_root_directory() + "/src/Benchmarks/regression_baseline.json";
+		/// how much slower than the baseline a case may be, as a fraction of it
+		double threshold = 0.10;
+		int repetitions = 20;
+		bool write_baseline = false;
+	};
+
+	/// @brief What one case answered and how long each repetition of it took
+	struct CaseResult {
+		std::string name;
+		/// (s) sorted
+		std::vector<double> seconds;
+		int num_evaluations = 0;
+		/// nullopt if the race could not be finished
+		std::optional<double> racetime;
+		std::optional<double> speed;
+
+		double median() const {
+			return seconds[seconds.size() / 2];
+		}
+		/// the nearest-rank 95th percentile
+		double p95() const {
+			const auto rank = static_cast<std::size_t>(std::ceil(0.95 * static_cast<double>(seconds.size())));
+			return seconds[std::max<std::size_t>(rank, 1) - 1];
+		}
+	};
+
+	struct Answer {
+		int num_evaluations;
+		std::optional<double> racetime;
+		std::optional<double> speed;
+	};
+
+	/// @brief Runs a case once to warm up, then times @p repetitions repetitions of it. A repetition runs the case
+	/// often enough to last MIN_REPETITION_SECONDS, so short cases are not all timer noise. Every run must give the
+	/// same answer.
+	CaseResult run_case(std::string name, int repetitions, const std::function<Answer()>& run) {
+		using clock = std::chrono::steady_clock;
+		const clock::time_point warm_up_start = clock::now();
+		const Answer answer = run();
+		const double warm_up_seconds = std::chrono::duration<double>(clock::now() - warm_up_start).count();
+		const int runs_per_repetition = static_cast<int>(std::ceil(MIN_REPETITION_SECONDS / warm_up_seconds));
+
+		CaseResult result = {.name = std::move(name),
+			.seconds = {},
+			.num_evaluations = answer.num_evaluations,
+			.racetime = answer.racetime,
+			.speed = answer.speed};
+		for (int repetition = 0; repetition < repetitions; ++repetition) {
+			const clock::time_point start = clock::now();
+			for (int index = 0; index < runs_per_repetition; ++index) {
+				const Answer repeated = run();
+				if (repeated.racetime != answer.racetime || repeated.speed != answer.speed) {
+					throw std::runtime_error(result.name + " gave different answers from one run to the next");
+				}
+			}
+			result.seconds.push_back(
+				std::chrono::duration<double>(clock::now() - start).count() / runs_per_repetition);
+		}
+		std::sort(result.seconds.begin(), result.seconds.end());
+		return result;
+	}
+
+	std::vector<CaseResult> run_cases(const benchmark::PinnedRace& race, int repetitions) {
+		std::vector<CaseResult> results;
+		for (const double speed : RACE_SPEEDS) {
+			char name[64];
+			std::snprintf(name, sizeof(name), "race_runner.calculate_racetime@%g", speed);
+			results.push_back(run_case(name, repetitions, [&] {
+				const std::optional<double> racetime =
+					RaceRunner::calculate_racetime(race.car, race.route, race.weather, race.schedule, speed);
+				return Answer{.num_evaluations = 1, .racetime = racetime, .speed = speed};
+			}));
+		}
+		for (const char* optimizer_type : {"binary", "linear"}) {
+			const std::unique_ptr<const Optimizer> optimizer =
+				Optimizer::create_optimizer(optimizer_type, race.car, race.weather, race.route, race.schedule);
+			results.push_back(run_case(std::string("optimizer.") + optimizer_type, repetitions, [&] {
+				const auto solution = optimizer->optimize_race();
+				if (!solution.has_value()) {
+					return Answer{.num_evaluations = 0, .racetime = std::nullopt, .speed = std::nullopt};
+				}
+				return Answer{.num_evaluations = solution->num_evaluations,
+					.racetime = solution->racetime,
+					.speed = solution->speed};
+			}));
+		}
+		return results;
+	}
+
+	void append_optional_number(std::string& out, const std::optional<double>& number) {
+		if (number.has_value()) {
+			json::append_number(out, *number);
+		} else {
+			out += "null";
+		}
+	}
+
+	/// @brief Writes the results as a baseline, one case per line
+	void write_baseline(const std::string& file, const std::vector<CaseResult>& results) {
+		std::string text = "{\"cases\": {";
+		for (const CaseResult& result : results) {
+			text += &result == &results.front() ? "\n\t" : ",\n\t";
+			json::append_string(text, result.name);
+			text += ": {\"median_seconds\": ";
+			json::append_number(text, result.median());
+			text += ", \"p95_seconds\": ";
+			json::append_number(text, result.p95());
+			text += ", \"num_evaluations\": " + std::to_string(result.num_evaluations) + ", \"racetime\": ";
+			append_optional_number(text, result.racetime);
+			text += ", \"speed\": ";
+			append_optional_number(text, result.speed);
+			text += '}';
+		}
+		text += "\n}}\n";
+		std::ofstream out(file);
+		out << text;
+		if (!out) {
+			throw std::runtime_error("could not write " + file);
+		}
+	}
+
+	json::Value read_baseline(const std::string& file) {
+		std::ifstream in(file);
+		if (!in) {
+			throw std::runtime_error("could not read the baseline " + file + " (write one with --write-baseline)");
+		}
+		std::ostringstream text;
+		text << in.rdbuf();
+		return json::parse(text.str());
+	}
+
+	std::optional<double> get_optional_number(const json::Value& object, std::string_view key) {
+		const json::Value* value = object.find(key);
+		if (value == nullptr || value->get_if<double>() == nullptr) {
+			return std::nullopt;
+		}
+		return *value->get_if<double>();
+	}
+
+	/// @brief Prints how each case compares with its baseline
+	/// @return whether every case is within the threshold and gave the same answer
+	bool compare(const std::vector<CaseResult>& results, const json::Value& baseline, double threshold) {
+		const json::Value* cases = baseline.find("cases");
+		if (cases == nullptr || cases->get_if<json::Value::Object>() == nullptr) {
+			throw std::invalid_argument("the baseline has no \"cases\" object");
+		}
+
+		char line[256];
+		std::snprintf(line, sizeof(line), "%-38s %10s %10s %8s %10s %10s %8s %6s  %s\n", "case", "median ms",
+			"baseline", "change", "p95 ms", "baseline", "change", "evals", "status");
+		std::cout << line;
+		bool passed = true;
+		for (const CaseResult& result : results) {
+			const json::Value* expected = cases->find(result.name);
+			if (expected == nullptr) {
+				std::snprintf(line, sizeof(line), "%-38s %10.3f %10s %8s %10.3f %10s %8s %6d  new\n",
+					result.name.c_str(), result.median() * 1e3, "-", "-", result.p95() * 1e3, "-", "-",
+					result.num_evaluations);
+				std::cout << line;
+				continue;
+			}
+			const double baseline_median = get_optional_number(*expected, "median_seconds").value_or(NAN);
+			const double baseline_p95 = get_optional_number(*expected, "p95_seconds").value_or(NAN);
+			const auto baseline_evaluations = get_optional_number(*expected, "num_evaluations");
+			const double median_change = result.median() / baseline_median - 1.0;
+			const double p95_change = result.p95() / baseline_p95 - 1.0;
+
+			std::string status;
+			// Compared exactly: the baseline numbers read back as the same doubles
+			if (result.racetime != get_optional_number(*expected, "racetime") ||
+				result.speed != get_optional_number(*expected, "speed")) {
+				status += " ANSWER CHANGED";
+			}
+			if (!baseline_evaluations.has_value() || result.num_evaluations > *baseline_evaluations) {
+				status += " MORE EVALUATIONS";
+			}
+			// NaN (a missing baseline time) fails too
+			if (!(median_change <= threshold) || !(p95_change <= threshold)) {
+				status += " SLOWER";
+			}
+			passed = passed && status.empty();
+
+			std::snprintf(line, sizeof(line), "%-38s %10.3f %10.3f %+7.1f%% %10.3f %10.3f %+7.1f%% %6d  %s\n",
+				result.name.c_str(), result.median() * 1e3, baseline_median * 1e3, median_change * 100.0,
+				result.p95() * 1e3, baseline_p95 * 1e3, p95_change * 100.0, result.num_evaluations,
+				status.empty() ? "ok" : status.c_str() + 1);
+			std::cout << line;
+			if (result.racetime != get_optional_number(*expected, "racetime")) {
+				std::cout << std::setprecision(17) << "    race time " << result.racetime.value_or(NAN)
+						  << " s, baseline " << get_optional_number(*expected, "racetime").value_or(NAN) << " s\n";
+			}
+		}
+		return passed;
+	}
+
+	void print_help() {
+		std::cout << "Usage: minisim_regression [-b <baseline.json>] [-t <threshold>] [-n <repetitions>] [-w]\n\n"
+				  << "Times full races and both optimizers on the pinned benchmark race, and compares the median\n"
+				  << "and 95th percentile wall times, the number of race times calculated and the answers with a\n"
+				  << "baseline.\n"
+				  << "Exits with 1 if a case is slower than the threshold allows, calculates more race times, or\n"
+				  << "gives a race time or speed that is not bit for bit the one in the baseline.\n\n"
+				  << "Options:\n"
+				  << "  -h, --help            display this help and exit\n"
+				  << "  -b, --baseline        the baseline file (default src/Benchmarks/regression_baseline.json)\n"
+				  << "  -t, --threshold       how much slower a case may be, as a fraction (default 0.10)\n"
+				  << "  -n, --repetitions     how many times each case is timed (default 20)\n"
+				  << "  -w, --write-baseline  write the results as the new baseline instead of comparing\n";
+	}
+
+	double read_number(const std::string& text, const std::string& option) {
+		std::size_t end = 0;
+		try {
+			const double number = std::stod(text, &end);
+			if (end == text.size()) {
+				return number;
+			}
+		} catch (const std::exception&) {
+		}
+		throw std::invalid_argument(option + " takes a number, not \"" + text + "\"");
+	}
+
+	/// @return nullopt if the program should exit (after --help)
+	std::optional<CommandLine> read_args(int argc, char** argv) {
+		static const option long_options[] = {
+			{"help",           no_argument,       nullptr, 'h'},
+			{"baseline",       required_argument, nullptr, 'b'},
+			{"threshold",      required_argument, nullptr, 't'},
+			{"repetitions",    required_argument, nullptr, 'n'},
+			{"write-baseline", no_argument,       nullptr, 'w'},
+			{nullptr,          0,                 nullptr, 0  },
+		};
+		CommandLine args;
+		opterr = 0;
+		int choice = 0;
+		while ((choice = getopt_long(argc, argv, "hb:t:n:w", long_options, nullptr)) != -1) {
+			switch (choice) {
+				case 'h':
+					print_help();
+					return std::nullopt;
+				case 'b':
+					args.baseline_file = optarg;
+					break;
+				case 't':
+					args.threshold = read_number(optarg, "--threshold");
+					break;
+				case 'n':
+					args.repetitions = static_cast<int>(read_number(optarg, "--repetitions"));
+					break;
+				case 'w':
+					args.write_baseline = true;
+					break;
+				default:
+					throw std::invalid_argument("unknown option (see --help)");
+			}
+		}
+		if (!(args.threshold >= 0.0) || args.repetitions < 1) {
+			throw std::invalid_argument("the threshold must not be negative and there must be a repetition");
+		}
+		return args;
+	}
+}  // namespace
+
+int main(int argc, char** argv) {
+	std::optional<CommandLine> args;
+	try {
+		args = read_args(argc, argv);
+	} catch (const std::exception& error) {
+		std::cerr << "[ERROR] " << error.what() << "\n";
+		return 2;
+	}
+	if (!args.has_value()) {
+		return 0;
+	}
+
+	try {
+		const benchmark::PinnedRace race = benchmark::PinnedRace::load();
+		const std::vector<CaseResult> results = run_cases(race, args->repetitions);
+		if (args->write_baseline) {
+			write_baseline(args->baseline_file, results);
+			std::cout << "[REGRESSION] Wrote " << results.size() << " cases to " << args->baseline_file << "\n";
+			return 0;
+		}
+		if (!compare(results, read_baseline(args->baseline_file), args->threshold)) {
+			std::cout << "[REGRESSION] Failed against " << args->baseline_file << "\n";
+			return 1;
+		}
+		std::cout << "[REGRESSION] Passed against " << args->baseline_file << "\n";
+	} catch (const std::exception& error) {
+		std::cerr << "[ERROR] " << error.what() << "\n";
+		return 2;
+	}
+	return 0;
+}
@@ -6,6 +6,7 @@
 #include <ostream>
 #include <span>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -53,6 +54,14 @@ std::optional<ConfigFile> ConfigFile::from_path(std::string_view file_path) {
 	return std::nullopt;
 }
 
+ConfigFile read_config(const std::string& file_path) {
+	std::optional<ConfigFile> config = ConfigFile::from_path(file_path);
+	if (!config) {
+		throw std::invalid_argument("not a valid TOML file: " + file_path);
+	}
+	return std::move(*config);
+}
+
 bool ConfigFile::contains(std::string_view key) const noexcept {
 	switch (config_type) {
 		case ConfigType::TOML:
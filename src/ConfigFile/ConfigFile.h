@@ -7,6 +7,7 @@
 #include <initializer_list>
 #include <optional>
 #include <span>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -353,4 +354,8 @@ void ConfigFile::insert_override_l<ConfigFile>(std::string_view full_key, const
 template <>
 void ConfigFile::insert_override_arr_l<ConfigFile>(std::string_view full_key, std::span<const ConfigFile> values);
 
+/// @brief Reads a config file that every input loader needs
+/// @throws std::invalid_argument naming the file, if it is not a valid TOML file
+ConfigFile read_config(const std::string& file_path);
+
 #endif  // MINISIM_OPTIMIZERCONFIG_H
@@ -0,0 +1,166 @@
+#ifndef MINISIM_CONFIGSCHEMA_H
+#define MINISIM_CONFIGSCHEMA_H
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ConfigFile.h"
+
+/// @brief Every key a ConfigSchema could not extract
+class ConfigSchemaError : public std::invalid_argument {
+   public:
+	explicit ConfigSchemaError(std::vector<std::string> problems)
+		: std::invalid_argument(join(problems)), problems(std::move(problems)) {}
+
+	/// @return one message per missing or mistyped key, e.g. "missing key tire.alpha"
+	const std::vector<std::string>& get_problems() const noexcept {
+		return problems;
+	}
+
+   private:
+	static std::string join(const std::vector<std::string>& problems) {
+		std::string message = "invalid config:";
+		for (const auto& problem : problems) {
+			message += "\n  ";
+			message += problem;
+		}
+		return message;
+	}
+
+	std::vector<std::string> problems;
+};
+
+/// @brief Binds the fields of a struct to dotted TOML paths once, then extracts all of them from a ConfigFile in a
+/// single walk of its tables.
+///
+/// The paths are split into a tree when they are bound, so a table shared by several paths (e.g. "tire" in
+/// "tire.alpha" and "tire.beta") is looked up once per extraction. Build a schema once (e.g. as a static) and reuse it:
+///
+///     static const auto schema = ConfigSchema<CarParameters>()
+///         .bind("mass", &CarParameters::mass)
+///         .bind("tire.alpha", &CarParameters::tire_alpha);
+///     const CarParameters parameters = schema.extract(car_config);
+///
+/// Fields may be double, int64_t, bool or std::string. As with ConfigFile::get(), integers are read into doubles.
+template <typename Struct>
+class ConfigSchema {
+   public:
+	ConfigSchema() : nodes(1) {}
+
+	/// @brief Binds a field to a dotted path (e.g. "battery.capacity")
+	template <typename T>
+	ConfigSchema& bind(std::string_view path, T Struct::*field) {
+		size_t node = 0;
+		while (!path.empty()) {
+			const size_t dot = path.find('.');
+			node = child(node, path.substr(0, dot));
+			path = dot == std::string_view::npos ? std::string_view() : path.substr(dot + 1);
+		}
+		if (node == 0 || nodes[node].read || !nodes[node].children.empty()) {
+			throw std::invalid_argument("config path bound twice, or both to a value and a table");
+		}
+		nodes[node].read = [field](const toml::node& value, Struct& out) {
+			const std::optional<T> typed = value.value<T>();
+			if (typed) {
+				out.*field = *typed;
+			}
+			return typed.has_value();
+		};
+		nodes[node].type_name = type_name<T>();
+		return *this;
+	}
+
+	/// @brief Reads every bound field of @p out from a config
+	/// @throws ConfigSchemaError listing every bound path that is missing or of the wrong type; @p out may then be
+	/// partially filled in
+	void extract_into(const ConfigFile& config, Struct& out) const {
+		std::vector<std::string> problems;
+		std::string path;
+		walk(0, config.get_toml_force(), out, path, problems);
+		if (!problems.empty()) {
+			throw ConfigSchemaError(std::move(problems));
+		}
+	}
+
+	/// @brief Same as extract_into(), into a value-initialized Struct
+	Struct extract(const ConfigFile& config) const {
+		Struct out{};
+		extract_into(config, out);
+		return out;
+	}
+
+   private:
+	struct Node {
+		std::string key;
+		std::vector<size_t> children;
+		/// set on leaves: stores the value into its field, and returns false if it has the wrong type
+		std::function<bool(const toml::node&, Struct&)> read;
+		std::string_view type_name;
+	};
+
+	size_t child(size_t parent, std::string_view key) {
+		for (const size_t existing : nodes[parent].children) {
+			if (nodes[existing].key == key) {
+				return existing;
+			}
+		}
+		if (key.empty() || nodes[parent].read) {
+			throw std::invalid_argument("invalid config path");
+		}
+		nodes.push_back({.key = std::string(key), .children = {}, .read = {}, .type_name = {}});
+		nodes[parent].children.push_back(nodes.size() - 1);
+		return nodes.size() - 1;
+	}
+
+	void walk(size_t node, const toml::table& table, Struct& out, std::string& path,
+		std::vector<std::string>& problems) const {
+		const size_t path_length = path.size();
+		for (const size_t index : nodes[node].children) {
+			const Node& child_node = nodes[index];
+			if (path_length > 0) {
+				path += '.';
+			}
+			path += child_node.key;
+
+			const toml::node* value = table.get(child_node.key);
+			if (value == nullptr) {
+				problems.push_back("missing key " + path);
+			} else if (child_node.read) {
+				if (!child_node.read(*value, out)) {
+					problems.push_back(path + " is not " + std::string(child_node.type_name));
+				}
+			} else if (const toml::table* child_table = value->as_table()) {
+				walk(index, *child_table, out, path, problems);
+			} else {
+				problems.push_back(path + " is not a table");
+			}
+			path.resize(path_length);
+		}
+	}
+
+	template <typename T>
+	static constexpr std::string_view type_name() {
+		if constexpr (std::is_same_v<T, double>) {
+			return "a number";
+		} else if constexpr (std::is_same_v<T, std::int64_t>) {
+			return "an integer";
+		} else if constexpr (std::is_same_v<T, bool>) {
+			return "a boolean";
+		} else {
+			static_assert(std::is_same_v<T, std::string>, "config fields must be double, int64_t, bool or string");
+			return "a string";
+		}
+	}
+
+	/// nodes[0] is the root table
+	std::vector<Node> nodes;
+};
+
+#endif  // MINISIM_CONFIGSCHEMA_H
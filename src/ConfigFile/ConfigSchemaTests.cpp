@@ -0,0 +1,74 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <string>
+
+#include "ConfigFile.h"
+#include "ConfigSchema.h"
+
+namespace {
+	struct Settings {
+		double mass;
+		std::int64_t laps;
+		bool enabled;
+		std::string name;
+		double alpha;
+		double beta;
+	};
+
+	const auto schema = ConfigSchema<Settings>()
+							.bind("mass", &Settings::mass)
+							.bind("laps", &Settings::laps)
+							.bind("race.enabled", &Settings::enabled)
+							.bind("race.car.name", &Settings::name)
+							.bind("tire.alpha", &Settings::alpha)
+							.bind("tire.beta", &Settings::beta);
+}  // namespace
+
+TEST_CASE("ConfigSchema: extracts every bound field", "[ConfigFile]") {
+	const ConfigFile config = ConfigFile::from_toml(R"(
+		mass = 243
+		laps = 3
+		unused = "ignored"
+		[race]
+		enabled = true
+		car = { name = "mini" }
+		[tire]
+		alpha = -0.5
+		beta = 1.25
+	)").value();
+
+	const Settings settings = schema.extract(config);
+	CHECK(settings.mass == 243.0);
+	CHECK(settings.laps == 3);
+	CHECK(settings.enabled);
+	CHECK(settings.name == "mini");
+	CHECK(settings.alpha == config.get_force<double>("tire.alpha"));
+	CHECK(settings.beta == 1.25);
+}
+
+TEST_CASE("ConfigSchema: reports every problem at once", "[ConfigFile]") {
+	const ConfigFile config = ConfigFile::from_toml(R"(
+		mass = "heavy"
+		race = 4
+		[tire]
+		beta = 1.25
+	)").value();
+
+	try {
+		static_cast<void>(schema.extract(config));
+		FAIL("no ConfigSchemaError");
+	} catch (const ConfigSchemaError& error) {
+		const auto& problems = error.get_problems();
+		REQUIRE(problems.size() == 4);
+		CHECK(problems[0] == "mass is not a number");
+		CHECK(problems[1] == "missing key laps");
+		CHECK(problems[2] == "race is not a table");
+		CHECK(problems[3] == "missing key tire.alpha");
+	}
+
+	CHECK_THROWS_AS(ConfigSchema<Settings>().bind("mass", &Settings::mass).bind("mass", &Settings::alpha),
+		std::invalid_argument);
+	CHECK_THROWS_AS(ConfigSchema<Settings>().bind("tire", &Settings::mass).bind("tire.alpha", &Settings::alpha),
+		std::invalid_argument);
+}
@@ -3,6 +3,7 @@
 #include <optional>
 
 #include "RaceRunner/RaceRunner.h"
+#include "Tools/Metrics.h"
 
 BinarySearchOptimizer::BinarySearchOptimizer(
 	const SolarCar& car, const Weather& weather, const Route& route, const RaceSchedule& schedule)
@@ -16,12 +17,15 @@ std::optional<Optimizer::OptimizationOutput> BinarySearchOptimizer::optimize_rac
 	double high = maximum_speed;
 	double best_speed = 0;
 	double best_racetime = 0;
+	int num_evaluations = 0;
 
 	 
 	while (high - low > precision) {
+		MINISIM_TIME_SCOPE("optimizer.binary.iteration");
 		const double mid = (low + high) / 2.0;
 
 		const auto racetime_opt = RaceRunner::calculate_racetime(car, route, weather, schedule, mid);
+		num_evaluations++;
 
 		if (racetime_opt.has_value()) {
 			 
@@ -42,10 +46,12 @@ std::optional<Optimizer::OptimizationOutput> BinarySearchOptimizer::optimize_rac
 	 
 	 
 	auto verification = RaceRunner::calculate_racetime(car, route, weather, schedule, best_speed);
+	num_evaluations++;
 	if (!verification.has_value()) {
 		 
 		best_speed -= precision;
 		auto fallback = RaceRunner::calculate_racetime(car, route, weather, schedule, best_speed);
+		num_evaluations++;
 
 		if (!fallback.has_value()) {
 			 
@@ -55,5 +61,5 @@ std::optional<Optimizer::OptimizationOutput> BinarySearchOptimizer::optimize_rac
 		best_racetime = fallback.value();
 	}
 
-	return OptimizationOutput{best_racetime, best_speed};
+	return OptimizationOutput{best_racetime, best_speed, num_evaluations};
 }
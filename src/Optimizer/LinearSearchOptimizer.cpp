@@ -3,6 +3,7 @@
 #include <optional>
 
 #include "RaceRunner/RaceRunner.h"
+#include "Tools/Metrics.h"
 
 LinearSearchOptimizer::LinearSearchOptimizer(
 	const SolarCar& car, const Weather& weather, const Route& route, const RaceSchedule& schedule)
@@ -14,10 +15,13 @@ std::optional<Optimizer::OptimizationOutput> LinearSearchOptimizer::optimize_rac
 
 	double best_speed = 0;
 	double best_racetime = 0;
+	int num_evaluations = 0;
 
 	 
 	for (double speed = minimum_speed; speed <= maximum_speed; speed += speed_step) {
+		MINISIM_TIME_SCOPE("optimizer.linear.iteration");
 		const auto racetime_opt = RaceRunner::calculate_racetime(car, route, weather, schedule, speed);
+		num_evaluations++;
 
 		 
 		if (racetime_opt.has_value()) {
@@ -31,5 +35,5 @@ std::optional<Optimizer::OptimizationOutput> LinearSearchOptimizer::optimize_rac
 		return std::nullopt;
 	}
 
-	return OptimizationOutput{best_racetime, best_speed};
+	return OptimizationOutput{best_racetime, best_speed, num_evaluations};
 }
@@ -24,6 +24,8 @@ class Optimizer {
 	struct OptimizationOutput {
 		double racetime;
 		double speed;
+		/// how many race times were calculated to find it
+		int num_evaluations;
 	};
 
 	/// Using a heuristic, optimizes the entire race.
@@ -97,6 +97,8 @@ namespace race_config {
 		static constexpr unsigned long SOLAR_FILE_NUMBER_OF_COLUMNS = 5;
 		static constexpr unsigned long DIM_OF_WEATHER_INTERP = 6;
 		static constexpr unsigned long DIM_OF_SOLAR_INTERP = 3;
+		/// Every column except the weather station and the timestamp is interpolated
+		static constexpr int NUM_WEATHER_VARIABLES = static_cast<int>(WEATHER_FILE_NUMBER_OF_COLUMNS) - 2;
 		// column names
 		constexpr std::string_view CN_WEATHER_STATION = "weather_group";
 		constexpr std::string_view CN_UNIX_PERIOD = "period_time_unix";
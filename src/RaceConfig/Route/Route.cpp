@@ -1,17 +1,107 @@
 #include "Route.h"
 
-#include <numeric>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <ranges>
 #include <span>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "RouteConstants.h"
 #include "Tools/Conversions.h"
+#include "Tools/FileTools.h"
+#include "Tools/Metrics.h"
+#include "Tools/Trace.h"
 #include "csv/csv.h"
 
+namespace {
+	/// What Route::write_binary() puts in front of the segments
+	struct BinaryRouteHeader {
+		std::array<char, 8> magic;
+		std::uint64_t format_version;
+		/// sizeof(RouteSegment) of the machine that wrote the file
+		std::uint64_t segment_size;
+		std::uint64_t num_segments;
+	};
+
+	constexpr std::array<char, 8> BINARY_ROUTE_MAGIC = {'M', 'S', 'R', 'O', 'U', 'T', 'E', '1'};
+	/// bump whenever BinaryRouteHeader or RouteSegment change
+	constexpr std::uint64_t BINARY_ROUTE_FORMAT_VERSION = 1;
+
+	static_assert(std::is_trivially_copyable_v<RouteSegment>);
+	static_assert(sizeof(BinaryRouteHeader) % alignof(RouteSegment) == 0);
+}  // namespace
+
 Route::Route(std::string_view route_file, WeatherStations weather_stations)
 	: weather_stations(std::move(weather_stations)) {
+	const std::string path(route_file);
+	if (is_binary_route_file(path)) {
+		map_binary(path);
+	} else {
+		read_csv(route_file);
+	}
+	index_distances();
+}
+
+void Route::index_distances() {
+	cumulative_distances.resize(segments.size() + 1);
+	cumulative_distances[0] = 0.0;
+	for (size_t index = 0; index < segments.size(); ++index) {
+		cumulative_distances[index + 1] = cumulative_distances[index] + segments[index].distance;
+	}
+	total_distance = cumulative_distances.back();
+
+	// About one segment per bucket, so a bucket holds a segment or two unless the segment lengths vary wildly
+	distance_buckets.clear();
+	buckets_per_distance = 0.0;
+	if (segments.empty() || total_distance <= 0.0) {
+		return;
+	}
+	const size_t num_buckets = segments.size();
+	buckets_per_distance = static_cast<double>(num_buckets) / total_distance;
+	distance_buckets.resize(num_buckets + 1);
+	size_t segment = 0;
+	for (size_t bucket = 0; bucket < num_buckets; ++bucket) {
+		const double bucket_start = static_cast<double>(bucket) / buckets_per_distance;
+		while (segment + 1 < segments.size() && cumulative_distances[segment + 1] <= bucket_start) {
+			++segment;
+		}
+		distance_buckets[bucket] = segment;
+	}
+	distance_buckets[num_buckets] = segments.size() - 1;
+}
+
+RouteLocation Route::locate(double distance) const {
+	if (segments.empty()) {
+		return {.segment_index = 0, .offset = 0.0};
+	}
+	distance = std::clamp(distance, 0.0, total_distance);
+	size_t first = 0;
+	size_t last = segments.size() - 1;
+	if (!distance_buckets.empty()) {
+		// the bucket start is rounded, so its segment is only a hint: widen by one bucket on each side
+		const auto bucket =
+			std::min(static_cast<size_t>(distance * buckets_per_distance), distance_buckets.size() - 2);
+		first = distance_buckets[bucket == 0 ? 0 : bucket - 1];
+		last = distance_buckets[std::min(bucket + 2, distance_buckets.size() - 1)];
+	}
+	// the last segment starting at or before the distance
+	const auto starts = std::span(cumulative_distances).subspan(first + 1, last - first);
+	const auto index = first + static_cast<size_t>(std::ranges::upper_bound(starts, distance) - starts.begin());
+	return {.segment_index = index, .offset = distance - cumulative_distances[index]};
+}
+
+void Route::read_csv(std::string_view route_file) {
+	MINISIM_TIME_SCOPE("route.read_csv");
+	MINISIM_TRACE_SCOPE("route.read_csv");
 	io::CSVReader<route::NUM_COLUMNS_ROUTE_FILE> route_csv(route_file.data());
 
 	route_csv.read_header(io::ignore_extra_column,
@@ -33,71 +123,93 @@ Route::Route(std::string_view route_file, WeatherStations weather_stations)
 		route::CN_GRAVITY_TIMES_SINE_ROAD_ANGLE   
 	);
 
-	struct RouteSegmentData {
-		double weather_station;
-		GeographicalCoordinate start_coordinate;
-		GeographicalCoordinate end_coordinate;
-		std::string end_condition;
-		std::string type;
-		double speed_limit;
-		double distance;
-		double heading;
-		double elevation;
-		double grade;
-		double road_incline_angle;
-		double sine_road_incline_angle;
-		double gravity;
-		double gravity_times_sine_road_incline_angle;
-	};
+	auto parsed = std::make_shared<std::vector<RouteSegment>>();
+	RouteSegment segment = {};
+	// reused across rows, so the end condition and type strings only allocate once
+	std::string end_condition;
+	std::string type;
+	while (route_csv.read_row(segment.coordinate_start.latitude,
+		segment.coordinate_start.longitude,
+		segment.coordinate_end.latitude,
+		segment.coordinate_end.longitude,
+		end_condition,
+		type,
+		segment.speed_limit,
+		segment.weather_station,
+		segment.distance,
+		segment.heading,
+		segment.elevation,
+		segment.grade,
+		segment.road_incline_angle,
+		segment.sine_road_incline_angle,
+		segment.gravity,
+		segment.gravity_times_sine_road_incline_angle)) {
+		segment.end_condition = parse_segment_end_condition(end_condition);
+		segment.type = parse_segment_type(type);
+		parsed->push_back(segment);
+	}
 
-	std::vector<RouteSegmentData> route_segment_data;
-
-	while (true) {
-		RouteSegmentData current_segment_data;
-
-		if (!route_csv.read_row(current_segment_data.start_coordinate.latitude,   
-				current_segment_data.start_coordinate.longitude,                  
-				current_segment_data.end_coordinate.latitude,                     
-				current_segment_data.end_coordinate.longitude,                    
-				current_segment_data.end_condition,                               
-				current_segment_data.type,                                        
-				current_segment_data.speed_limit,                                 
-				current_segment_data.weather_station,                             
-				current_segment_data.distance,                                    
-				current_segment_data.heading,                                     
-				current_segment_data.elevation,                                   
-				current_segment_data.grade,                                       
-				current_segment_data.road_incline_angle,                          
-				current_segment_data.sine_road_incline_angle,                     
-				current_segment_data.gravity,                                     
-				current_segment_data.gravity_times_sine_road_incline_angle        
-				)) {
-			break;
+	segments = *parsed;
+	storage = std::move(parsed);
+}
+
+void Route::map_binary(const std::string& route_file) {
+	MINISIM_TIME_SCOPE("route.map_binary");
+	MINISIM_TRACE_SCOPE("route.map_binary");
+	const file_tools::MappedFile mapped = file_tools::map_file(route_file);
+	BinaryRouteHeader header = {};
+	if (mapped.bytes.size() < sizeof(header)) {
+		throw std::invalid_argument("binary route file is truncated: " + route_file);
+	}
+	std::memcpy(&header, mapped.bytes.data(), sizeof(header));
+	if (header.magic != BINARY_ROUTE_MAGIC || header.format_version != BINARY_ROUTE_FORMAT_VERSION ||
+		header.segment_size != sizeof(RouteSegment)) {
+		throw std::invalid_argument("not a binary route file of this version of minisim: " + route_file);
+	}
+	if ((mapped.bytes.size() - sizeof(header)) / sizeof(RouteSegment) < header.num_segments) {
+		throw std::invalid_argument("binary route file is truncated: " + route_file);
+	}
+
+	// The mapping is page aligned and the header keeps the segments aligned after it
+	const auto* first = reinterpret_cast<const RouteSegment*>(mapped.bytes.data() + sizeof(header));
+	const std::span<const RouteSegment> mapped_segments(first, header.num_segments);
+	for (const auto& segment : mapped_segments) {
+		if (segment.end_condition < CONTROL_STOP || segment.end_condition > YIELD_SIGN_OR_BLINKING_YELLOW ||
+			(segment.type != RACE && segment.type != MARSHALING)) {
+			throw std::invalid_argument("binary route file has invalid segments: " + route_file);
 		}
-		route_segment_data.push_back(current_segment_data);
 	}
+	segments = mapped_segments;
+	storage = mapped.mapping;
+}
 
-	for (const auto& segment_data : route_segment_data) {
-		const RouteSegment segment{
-			.coordinate_start = segment_data.start_coordinate,
-			.coordinate_end = segment_data.end_coordinate,
-			.end_condition = parse_segment_end_condition(segment_data.end_condition),
-			.type = parse_segment_type(segment_data.type),
-			.speed_limit = segment_data.speed_limit,
-			.weather_station = segment_data.weather_station,
-			.distance = segment_data.distance,
-			.heading = segment_data.heading,
-			.elevation = segment_data.elevation,
-			.grade = segment_data.grade,
-			.road_incline_angle = segment_data.road_incline_angle,
-			.sine_road_incline_angle = segment_data.sine_road_incline_angle,
-			.gravity = segment_data.gravity,
-			.gravity_times_sine_road_incline_angle = segment_data.gravity_times_sine_road_incline_angle,
-		};
-
-		total_distance += segment.distance;
-		segments.push_back(segment);
+void Route::write_binary(const std::string& path) const {
+	const BinaryRouteHeader header = {
+		.magic = BINARY_ROUTE_MAGIC,
+		.format_version = BINARY_ROUTE_FORMAT_VERSION,
+		.segment_size = sizeof(RouteSegment),
+		.num_segments = segments.size(),
+	};
+
+	// Written next to the destination and renamed over it, so a route being mapped is never seen half written
+	const std::string temporary_path = path + ".tmp." + std::to_string(getpid());
+	{
+		std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(segments.data()),
+			static_cast<std::streamsize>(segments.size_bytes()));
+		if (!out) {
+			std::filesystem::remove(temporary_path);
+			throw std::runtime_error("could not write binary route file " + path);
+		}
 	}
+	std::filesystem::rename(temporary_path, path);
+}
+
+bool Route::is_binary_route_file(const std::string& path) {
+	std::ifstream in(path, std::ios::binary);
+	std::array<char, BINARY_ROUTE_MAGIC.size()> magic = {};
+	return in.read(magic.data(), magic.size()) && magic == BINARY_ROUTE_MAGIC;
 }
 
 RouteSegment Route::get_segment(size_t index) const {
@@ -108,10 +220,6 @@ RouteSegment Route::operator[](size_t index) const {
 	return segments[index];
 }
 
-const std::vector<RouteSegment>* Route::get_segments() const {
-	return &segments;
-}
-
 std::span<const RouteSegment> Route::get_segments_span() const {
 	return segments;
 }
@@ -128,17 +236,25 @@ double Route::get_total_distance() const {
 	return total_distance;
 }
 
+RouteMatch Route::match(const GeographicalCoordinate& position) const {
+	return get_spatial_index().nearest(position);
+}
+
+RouteMatch Route::match(const GeographicalCoordinate& position, size_t previous_segment, double tolerance) const {
+	return get_spatial_index().nearest(position, previous_segment, tolerance);
+}
+
+const RouteSpatialIndex& Route::get_spatial_index() const {
+	std::call_once(spatial_index->built, [this] { spatial_index->index = RouteSpatialIndex(segments); });
+	return spatial_index->index;
+}
+
 double Route::get_distance_between(size_t index1, size_t index2) const {
-	if (index1 == index2) {
-		return 0;
-	}
 	if (index1 > index2) {
 		std::swap(index1, index2);
 	}
-	if (index1 > segments.size() || index2 > segments.size()) {
+	if (index2 > segments.size()) {
 		return 0;
 	}
-	const auto range = std::ranges::views::iota(index1, index2);
-	return std::accumulate(
-		range.begin(), range.end(), 0.0, [this](double sum, size_t index) { return sum + segments[index].distance; });
+	return cumulative_distances[index2] - cumulative_distances[index1];
 }
@@ -1,6 +1,8 @@
 #ifndef MINISIM_ROUTE_H
 #define MINISIM_ROUTE_H
 
+#include <memory>
+#include <mutex>
 #include <span>
 #include <string>
 #include <string_view>
@@ -8,32 +10,89 @@
 
 #include "RaceConfig/WeatherStations/WeatherStations.h"
 #include "RouteSegment.h"
+#include "RouteSpatialIndex.h"
+
+/// @brief Where a distance along the route falls
+struct RouteLocation {
+	size_t segment_index;
+	/// the distance from the start of the segment, in [0, distance of the segment]
+	double offset;
+};
 
 /// @brief A wrapper class for a Route the car is taking.
+///
+/// A route is read from a CSV file, or mapped from a binary route file (see write_binary()) without parsing. The
+/// segments are immutable, so copies of a route share them.
 class Route {
    public:
+	/// @param route_file a CSV route file, or a binary route file written by write_binary()
+	/// @throws std::invalid_argument if a binary route file is truncated or from another version of minisim
 	explicit Route(std::string_view route_file, WeatherStations weather_stations);
 	Route() = default;
 
+	/// @brief Writes the segments in the binary route format: a header followed by the RouteSegments as they are in
+	/// memory. The file only loads on machines with the same RouteSegment layout (the header checks it).
+	/// @throws std::runtime_error if the file cannot be written
+	void write_binary(const std::string& path) const;
+
+	/// @return whether a file starts like a binary route file
+	static bool is_binary_route_file(const std::string& path);
+
 	size_t get_num_segments() const;
 	size_t get_num_weather_stations() const;
 	RouteSegment get_segment(size_t index) const;
 	RouteSegment operator[](size_t index) const;
 	double get_total_distance() const;
-	/// @return The distance between two segments, excluding the last segment
+	/// @return The distance between two segments, excluding the last segment (constant time)
 	double get_distance_between(size_t index1, size_t index2) const;
+	/// @return The distance from the start of the route to the start of a segment (index up to get_num_segments())
+	double get_distance_to(size_t index) const {
+		return cumulative_distances[index];
+	}
+
+	/// @brief Finds the segment a distance from the start of the route (e.g. an odometer reading) falls in, in
+	/// constant expected time. Distances before the start or past the end of the route are clamped to it.
+	RouteLocation locate(double distance) const;
+
+	/// (m) how far a position may be from the segments around the previous match of a track and still match them
+	static constexpr double TRACK_TOLERANCE = 30.0;
+
+	/// @brief Finds the segment nearest to a GPS position (see RouteSpatialIndex). The spatial index is built by the
+	/// first match, and shared by copies of the route. The route must not be empty.
+	RouteMatch match(const GeographicalCoordinate& position) const;
+	/// @brief Same as above for the next position of a track, trying the segments around the previous match first
+	RouteMatch match(
+		const GeographicalCoordinate& position, size_t previous_segment, double tolerance = TRACK_TOLERANCE) const;
 
 	WeatherStations weather_stations;
 
-	/// @return A pointer to a const version of segments
-	const std::vector<RouteSegment>* get_segments() const;
 	std::span<const RouteSegment> get_segments_span() const;
 
 	static std::vector<GeographicalCoordinate> parse_weather_stations(std::string_view weatherStationsFile);
 
    private:
-	std::vector<RouteSegment> segments;
+	void read_csv(std::string_view route_file);
+	void map_binary(const std::string& route_file);
+	/// @brief Builds cumulative_distances and distance_buckets from the segments
+	void index_distances();
+
+	std::span<const RouteSegment> segments;
+	/// what segments points into: a vector, or a mapped binary route file
+	std::shared_ptr<const void> storage;
 	double total_distance = 0;
+	/// the distance from the start of the route to the start of every segment, and to the end of the route last
+	std::vector<double> cumulative_distances = {0.0};
+	/// the route split into equally long buckets: the segment each bucket starts in, and the end of the route last
+	std::vector<size_t> distance_buckets;
+	/// buckets per unit of distance
+	double buckets_per_distance = 0.0;
+
+	struct LazySpatialIndex {
+		std::once_flag built;
+		RouteSpatialIndex index;
+	};
+	const RouteSpatialIndex& get_spatial_index() const;
+	std::shared_ptr<LazySpatialIndex> spatial_index = std::make_shared<LazySpatialIndex>();
 };
 
 #endif  // MINISIM_ROUTE_H
@@ -0,0 +1,172 @@
+#include "RouteSpatialIndex.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+#include "Tools/Conversions.h"
+
+namespace {
+	/// the side of a grid cell, about a kilometer: a few route segments long
+	constexpr double CELL_DEGREES = 0.01;
+	/// the rings of cells searched around a position before falling back to every segment (about 16 km)
+	constexpr std::int64_t MAX_RINGS = 16;
+	/// the segments before and after a hint that are tried first
+	constexpr size_t HINT_SEGMENTS_BEFORE = 4;
+	constexpr size_t HINT_SEGMENTS_AFTER = 16;
+	/// (m) the length of a degree of latitude on a sphere of the mean radius of the earth
+	constexpr double METERS_PER_DEGREE = 6371008.8 * std::numbers::pi / 180.0;
+
+	/// @brief Keeps the better of two matches, the lower segment index on ties
+	void keep_nearest(RouteMatch& best, const RouteMatch& candidate) {
+		if (candidate.distance < best.distance ||
+			(candidate.distance == best.distance && candidate.segment_index < best.segment_index)) {
+			best = candidate;
+		}
+	}
+
+	constexpr RouteMatch NO_MATCH = {
+		.segment_index = std::numeric_limits<size_t>::max(),
+		.fraction = 0.0,
+		.distance = std::numeric_limits<double>::infinity(),
+	};
+}  // namespace
+
+RouteSpatialIndex::RouteSpatialIndex(std::span<const RouteSegment> segments)
+	: segments(segments), cell_degrees(CELL_DEGREES) {
+	struct CellRange {
+		std::int64_t first_latitude;
+		std::int64_t last_latitude;
+		std::int64_t first_longitude;
+		std::int64_t last_longitude;
+	};
+	std::vector<CellRange> ranges(segments.size());
+	size_t num_entries = 0;
+	for (size_t index = 0; index < segments.size(); ++index) {
+		const auto& segment = segments[index];
+		const auto [south, north] = std::minmax(segment.coordinate_start.latitude, segment.coordinate_end.latitude);
+		const auto [west, east] = std::minmax(segment.coordinate_start.longitude, segment.coordinate_end.longitude);
+		ranges[index] = {cell_of(south), cell_of(north), cell_of(west), cell_of(east)};
+		num_entries += static_cast<size_t>((ranges[index].last_latitude - ranges[index].first_latitude + 1) *
+										   (ranges[index].last_longitude - ranges[index].first_longitude + 1));
+	}
+
+	// Twice as many buckets as entries keeps the buckets short despite hash collisions
+	bucket_mask = std::bit_ceil(std::max<size_t>(2 * num_entries, 1)) - 1;
+	bucket_offsets.assign(bucket_mask + 2, 0);
+	const auto for_each_cell = [&](const auto& visit) {
+		for (size_t index = 0; index < segments.size(); ++index) {
+			const CellRange& range = ranges[index];
+			for (auto latitude = range.first_latitude; latitude <= range.last_latitude; ++latitude) {
+				for (auto longitude = range.first_longitude; longitude <= range.last_longitude; ++longitude) {
+					visit(bucket_of(latitude, longitude), static_cast<std::uint32_t>(index));
+				}
+			}
+		}
+	};
+	for_each_cell([&](size_t bucket, std::uint32_t) { ++bucket_offsets[bucket + 1]; });
+	for (size_t bucket = 0; bucket + 1 < bucket_offsets.size(); ++bucket) {
+		bucket_offsets[bucket + 1] += bucket_offsets[bucket];
+	}
+	bucket_segments.resize(num_entries);
+	std::vector<std::uint32_t> filled(bucket_offsets.begin(), bucket_offsets.end() - 1);
+	for_each_cell([&](size_t bucket, std::uint32_t index) { bucket_segments[filled[bucket]++] = index; });
+}
+
+RouteMatch RouteSpatialIndex::match_segment(const GeographicalCoordinate& position, size_t segment_index) const {
+	RouteMatch match = project(position, longitude_scale_at(position), segment_index);
+	match.distance = std::sqrt(match.distance);
+	return match;
+}
+
+RouteMatch RouteSpatialIndex::project(
+	const GeographicalCoordinate& position, double longitude_scale, size_t segment_index) const {
+	const RouteSegment& segment = segments[segment_index];
+	// equirectangular projection around the position, in meters
+	const double start_x = (segment.coordinate_start.longitude - position.longitude) * longitude_scale;
+	const double start_y = (segment.coordinate_start.latitude - position.latitude) * METERS_PER_DEGREE;
+	const double along_x = (segment.coordinate_end.longitude - position.longitude) * longitude_scale - start_x;
+	const double along_y = (segment.coordinate_end.latitude - position.latitude) * METERS_PER_DEGREE - start_y;
+	const double length_squared = along_x * along_x + along_y * along_y;
+	const double fraction =
+		length_squared > 0.0 ? std::clamp(-(start_x * along_x + start_y * along_y) / length_squared, 0.0, 1.0) : 0.0;
+	const double x = start_x + fraction * along_x;
+	const double y = start_y + fraction * along_y;
+	return {.segment_index = segment_index, .fraction = fraction, .distance = x * x + y * y};
+}
+
+double RouteSpatialIndex::longitude_scale_at(const GeographicalCoordinate& position) {
+	return std::cos(deg_to_rad(position.latitude)) * METERS_PER_DEGREE;
+}
+
+RouteMatch RouteSpatialIndex::nearest(const GeographicalCoordinate& position) const {
+	RouteMatch best = nearest_squared(position);
+	best.distance = std::sqrt(best.distance);
+	return best;
+}
+
+RouteMatch RouteSpatialIndex::nearest_squared(const GeographicalCoordinate& position) const {
+	RouteMatch best = NO_MATCH;
+	const double longitude_scale = longitude_scale_at(position);
+	const std::int64_t latitude_cell = cell_of(position.latitude);
+	const std::int64_t longitude_cell = cell_of(position.longitude);
+	const auto visit_cell = [&](std::int64_t latitude, std::int64_t longitude) {
+		const size_t bucket = bucket_of(latitude, longitude);
+		for (auto entry = bucket_offsets[bucket]; entry < bucket_offsets[bucket + 1]; ++entry) {
+			keep_nearest(best, project(position, longitude_scale, bucket_segments[entry]));
+		}
+	};
+
+	// Every segment outside the rings searched so far is at least this far per ring
+	const double ring_distance = cell_degrees * longitude_scale;
+	for (std::int64_t ring = 0; ring <= MAX_RINGS; ++ring) {
+		for (auto longitude = longitude_cell - ring; longitude <= longitude_cell + ring; ++longitude) {
+			visit_cell(latitude_cell - ring, longitude);
+			if (ring > 0) {
+				visit_cell(latitude_cell + ring, longitude);
+			}
+		}
+		for (auto latitude = latitude_cell - ring + 1; latitude < latitude_cell + ring; ++latitude) {
+			visit_cell(latitude, longitude_cell - ring);
+			visit_cell(latitude, longitude_cell + ring);
+		}
+		const double searched_distance = static_cast<double>(ring) * ring_distance;
+		if (best.distance <= searched_distance * searched_distance) {
+			return best;
+		}
+	}
+
+	// Far from the route: a closer segment may lie beyond the rings
+	for (size_t index = 0; index < segments.size(); ++index) {
+		keep_nearest(best, project(position, longitude_scale, index));
+	}
+	return best;
+}
+
+RouteMatch RouteSpatialIndex::nearest(const GeographicalCoordinate& position, size_t hint, double tolerance) const {
+	RouteMatch best = NO_MATCH;
+	const double longitude_scale = longitude_scale_at(position);
+	const size_t first = hint - std::min(hint, HINT_SEGMENTS_BEFORE);
+	const size_t last = std::min(hint + HINT_SEGMENTS_AFTER, segments.size() - 1);
+	for (size_t index = first; index <= last; ++index) {
+		keep_nearest(best, project(position, longitude_scale, index));
+	}
+	if (best.distance > tolerance * tolerance) {
+		best = nearest_squared(position);
+	}
+	best.distance = std::sqrt(best.distance);
+	return best;
+}
+
+size_t RouteSpatialIndex::bucket_of(std::int64_t latitude_cell, std::int64_t longitude_cell) const {
+	std::uint64_t hash = static_cast<std::uint64_t>(latitude_cell) * 0x9E3779B97F4A7C15ULL ^
+						 static_cast<std::uint64_t>(longitude_cell) * 0xC2B2AE3D27D4EB4FULL;
+	hash ^= hash >> 32;
+	return static_cast<size_t>(hash) & bucket_mask;
+}
+
+std::int64_t RouteSpatialIndex::cell_of(double degrees) const {
+	return static_cast<std::int64_t>(std::floor(degrees / cell_degrees));
+}
@@ -0,0 +1,68 @@
+#ifndef MINISIM_ROUTESPATIALINDEX_H
+#define MINISIM_ROUTESPATIALINDEX_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "DataClasses/GeographicalCoordinate.h"
+#include "RouteSegment.h"
+
+/// @brief The segment of a route nearest to a position
+struct RouteMatch {
+	size_t segment_index;
+	/// where along the segment the nearest point is, from 0 (coordinate_start) to 1 (coordinate_end)
+	double fraction;
+	/// (m) from the position to the nearest point of the segment
+	double distance;
+};
+
+/// @brief Finds the route segment nearest to a GPS position, treating segments as straight lines between their
+/// coordinates.
+///
+/// The segments are hashed into a uniform latitude/longitude grid, by the cells their bounding boxes overlap. A query
+/// searches rings of cells around its position until no closer segment can be in the next ring, so the answer is
+/// exactly the nearest segment. Distances are measured in an equirectangular projection around the position, which is
+/// accurate to well under a meter at the lengths of route segments.
+class RouteSpatialIndex {
+   public:
+	RouteSpatialIndex() = default;
+	/// @param segments must outlive the index
+	explicit RouteSpatialIndex(std::span<const RouteSegment> segments);
+
+	/// @return the segment nearest to the position (the first of them on ties). The route must not be empty.
+	RouteMatch nearest(const GeographicalCoordinate& position) const;
+
+	/// @brief Same as nearest(), but first looks a few segments around the previous match of a track of positions.
+	/// A segment there within @p tolerance of the position is taken even if another part of the route is marginally
+	/// closer, which keeps a track on its own stretch of road where the route passes the same place twice.
+	/// @param tolerance (m)
+	RouteMatch nearest(const GeographicalCoordinate& position, size_t hint, double tolerance) const;
+
+	/// @return the match against one segment
+	RouteMatch match_segment(const GeographicalCoordinate& position, size_t segment_index) const;
+
+   private:
+	/// @brief Same as match_segment(), but with the squared distance
+	/// @param longitude_scale longitude_scale_at() the position
+	RouteMatch project(const GeographicalCoordinate& position, double longitude_scale, size_t segment_index) const;
+	/// @return (m/degree) the length of a degree of longitude at the latitude of a position
+	static double longitude_scale_at(const GeographicalCoordinate& position);
+	/// @brief Same as nearest(), but with the squared distance
+	RouteMatch nearest_squared(const GeographicalCoordinate& position) const;
+
+	/// @return the hash bucket of a grid cell
+	size_t bucket_of(std::int64_t latitude_cell, std::int64_t longitude_cell) const;
+	std::int64_t cell_of(double degrees) const;
+
+	std::span<const RouteSegment> segments;
+	/// the grid cells are this many degrees of latitude by this many degrees of longitude
+	double cell_degrees = 0.0;
+	/// the number of hash buckets minus one (a power of two minus one)
+	size_t bucket_mask = 0;
+	/// bucket b holds the segments bucket_segments[bucket_offsets[b]] to bucket_segments[bucket_offsets[b + 1] - 1]
+	std::vector<std::uint32_t> bucket_offsets;
+	std::vector<std::uint32_t> bucket_segments;
+};
+
+#endif  // MINISIM_ROUTESPATIALINDEX_H
@@ -0,0 +1,156 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "Route.h"
+#include "TestSupport/TestSupport.h"
+#include "Tools/RootDirectory.h"
+
+using Catch::Matchers::WithinRel;
+using test_support::temporary_path;
+
+namespace {
+	const std::string route_file = get_root_directory() + "/data/Route/route.csv";
+}  // namespace
+
+TEST_CASE("Route: binary route files", "[Route]") {
+	const Route csv_route(route_file, WeatherStations());
+	REQUIRE(csv_route.get_num_segments() > 0);
+	CHECK_FALSE(Route::is_binary_route_file(route_file));
+
+	const std::string binary_file = temporary_path("minisim-route.bin");
+	csv_route.write_binary(binary_file);
+	REQUIRE(Route::is_binary_route_file(binary_file));
+
+	SECTION("a mapped route has the same segments") {
+		const Route binary_route(binary_file, WeatherStations());
+		REQUIRE(binary_route.get_num_segments() == csv_route.get_num_segments());
+		CHECK(binary_route.get_total_distance() == csv_route.get_total_distance());
+		const auto expected = csv_route.get_segments_span();
+		const auto mapped = binary_route.get_segments_span();
+		CHECK(std::memcmp(expected.data(), mapped.data(), expected.size_bytes()) == 0);
+
+		// copies share the mapping, which outlives the route it was mapped by
+		Route copy;
+		{
+			const Route scoped(binary_file, WeatherStations());
+			copy = scoped;
+		}
+		CHECK(copy.get_segment(copy.get_num_segments() - 1).distance ==
+			  csv_route.get_segment(csv_route.get_num_segments() - 1).distance);
+	}
+
+	SECTION("a truncated file is rejected") {
+		std::filesystem::resize_file(binary_file, std::filesystem::file_size(binary_file) - 1);
+		CHECK_THROWS_AS(Route(binary_file, WeatherStations()), std::invalid_argument);
+	}
+
+	std::filesystem::remove(binary_file);
+}
+
+TEST_CASE("Route: distance queries", "[Route]") {
+	const Route route(route_file, WeatherStations());
+	const auto segments = route.get_segments_span();
+
+	SECTION("distances between segments") {
+		double distance = 0.0;
+		for (size_t index = 0; index < segments.size(); distance += segments[index].distance, ++index) {
+			REQUIRE_THAT(route.get_distance_between(0, index), WithinRel(distance, 1e-12));
+		}
+		CHECK(route.get_distance_between(segments.size(), 0) == route.get_total_distance());
+		CHECK(route.get_distance_between(7, 7) == 0.0);
+		CHECK(route.get_distance_between(0, segments.size() + 1) == 0.0);
+	}
+
+	SECTION("locating distances") {
+		std::mt19937_64 random(39);
+		std::uniform_real_distribution<double> distances(0.0, route.get_total_distance());
+		for (int query = 0; query < 100000; ++query) {
+			const double distance = distances(random);
+			const RouteLocation location = route.locate(distance);
+			REQUIRE(location.segment_index < segments.size());
+			REQUIRE(route.get_distance_to(location.segment_index) <= distance);
+			REQUIRE(distance < route.get_distance_to(location.segment_index + 1));
+			REQUIRE(location.offset == distance - route.get_distance_to(location.segment_index));
+		}
+
+		// every segment start is found in its own segment
+		for (size_t index = 0; index < segments.size(); ++index) {
+			if (segments[index].distance > 0.0) {
+				REQUIRE(route.locate(route.get_distance_to(index)).segment_index == index);
+			}
+		}
+
+		CHECK(route.locate(-1.0).segment_index == 0);
+		CHECK(route.locate(-1.0).offset == 0.0);
+		const RouteLocation end = route.locate(route.get_total_distance() * 2.0);
+		CHECK(end.segment_index == segments.size() - 1);
+		CHECK(end.offset == route.get_total_distance() - route.get_distance_to(segments.size() - 1));
+	}
+}
+
+TEST_CASE("Route: matching GPS positions", "[Route]") {
+	const Route route(route_file, WeatherStations());
+	const auto segments = route.get_segments_span();
+	const RouteSpatialIndex brute_force(segments);
+	const auto nearest_by_scan = [&](const GeographicalCoordinate& position) {
+		RouteMatch best = brute_force.match_segment(position, 0);
+		for (size_t index = 1; index < segments.size(); ++index) {
+			const RouteMatch match = brute_force.match_segment(position, index);
+			if (match.distance < best.distance) {
+				best = match;
+			}
+		}
+		return best;
+	};
+
+	std::mt19937_64 random(40);
+	std::uniform_int_distribution<size_t> segment_indices(0, segments.size() - 1);
+	std::uniform_real_distribution<double> fractions(0.0, 1.0);
+	// about a kilometer
+	std::uniform_real_distribution<double> noise(-0.01, 0.01);
+	const auto position_near = [&](size_t index) {
+		const RouteSegment& segment = segments[index];
+		const double fraction = fractions(random);
+		return GeographicalCoordinate{
+			.latitude = segment.coordinate_start.latitude * (1.0 - fraction) + segment.coordinate_end.latitude * fraction,
+			.longitude =
+				segment.coordinate_start.longitude * (1.0 - fraction) + segment.coordinate_end.longitude * fraction,
+		};
+	};
+
+	SECTION("the nearest segment is found") {
+		for (int query = 0; query < 2000; ++query) {
+			GeographicalCoordinate position = position_near(segment_indices(random));
+			position.latitude += noise(random);
+			position.longitude += noise(random);
+			const RouteMatch expected = nearest_by_scan(position);
+			const RouteMatch match = route.match(position);
+			REQUIRE(match.distance == expected.distance);
+		}
+
+		// far off the route (Sydney)
+		const GeographicalCoordinate sydney = {.latitude = -33.87, .longitude = 151.21};
+		CHECK(route.match(sydney).distance == nearest_by_scan(sydney).distance);
+	}
+
+	SECTION("a track follows the route") {
+		size_t previous = 0;
+		for (size_t index = 0; index < segments.size(); ++index) {
+			if (segments[index].distance <= 0.0) {
+				continue;
+			}
+			const GeographicalCoordinate position = position_near(index);
+			const RouteMatch match = route.match(position, previous);
+			REQUIRE(match.distance < 1.0);
+			REQUIRE(match.segment_index >= previous);
+			previous = match.segment_index;
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#include "SolarGeometryTable.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "SolarPosition.h"
+
+namespace {
+	/// The atmosphere the refraction correction assumes
+	///
+	/// Units: millibars
+	constexpr double STANDARD_PRESSURE = 1013.25;
+	/// Units: Celsius
+	constexpr double STANDARD_TEMPERATURE = 15.0;
+}  // namespace
+
+SolarGeometryTable::SolarGeometryTable(
+	const WeatherStations& weather_stations, double start_time, double end_time, double step)
+	: start_time(start_time), inverse_step(1.0 / step), num_weather_stations(weather_stations.size()) {
+	if (num_weather_stations == 0 || !(end_time > start_time) || !(step > 0.0)) {
+		throw std::invalid_argument("solar geometry table needs weather stations, a time range and a positive step");
+	}
+	num_times = static_cast<size_t>(std::ceil((end_time - start_time) / step)) + 1;
+	last_position = static_cast<double>(num_times - 1);
+
+	std::vector<double> timestamps(num_times);
+	for (size_t time = 0; time < num_times; ++time) {
+		timestamps[time] = start_time + static_cast<double>(time) * step;
+	}
+	std::vector<double> latitudes(num_times);
+	std::vector<double> longitudes(num_times);
+	const std::vector<double> pressures(num_times, STANDARD_PRESSURE);
+	const std::vector<double> temperatures(num_times, STANDARD_TEMPERATURE);
+	std::vector<double> azimuths(num_times);
+	std::vector<double> zeniths(num_times);
+
+	geometry.resize(num_weather_stations * num_times);
+	for (size_t station = 0; station < num_weather_stations; ++station) {
+		const GeographicalCoordinate coordinate = weather_stations[station];
+		std::fill(latitudes.begin(), latitudes.end(), coordinate.latitude);
+		std::fill(longitudes.begin(), longitudes.end(), coordinate.longitude);
+		SolarPosition::fast::calculate_batch(
+			{timestamps, latitudes, longitudes, pressures, temperatures}, {azimuths, zeniths});
+		for (size_t time = 0; time < num_times; ++time) {
+			geometry[station * num_times + time] = {
+				.cos_zenith = std::cos(zeniths[time]),
+				.cos_azimuth = std::cos(azimuths[time]),
+				.sin_azimuth = std::sin(azimuths[time]),
+			};
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef MINISIM_SOLARGEOMETRYTABLE_H
+#define MINISIM_SOLARGEOMETRYTABLE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "RaceConfig/WeatherStations/WeatherStations.h"
+
+/// @brief Where the sun is, as seen from a weather station
+struct SolarGeometry {
+	/// cosine of the (refracted) zenith angle: 1 with the sun overhead, negative at night
+	double cos_zenith;
+	/// cosine and sine of the azimuth (North = 0, East = pi / 2); kept as a pair so interpolation never wraps
+	double cos_azimuth;
+	double sin_azimuth;
+};
+
+/// @brief The solar geometry at every weather station on a uniform time grid, for lookups inside the race loop.
+///
+/// The sun's position at a station only depends on time, so it is computed once (with SolarPosition::fast, for a
+/// standard atmosphere) and interpolated linearly afterwards. With a step of a minute, the interpolation adds less
+/// than 1e-5 to the zenith cosine away from the horizon (1e-3 right at it, where refraction bends it fastest), and
+/// less than 1e-4 / sin(zenith) to the azimuth cosine and sine. A lookup is a few multiply-adds.
+class SolarGeometryTable {
+   public:
+	/// @param start_time (Epoch Time) the first time of the grid
+	/// @param end_time (Epoch Time) the grid covers up to (at least) this time
+	/// @param step (seconds) the spacing of the grid
+	/// @throws std::invalid_argument if there are no weather stations, end_time <= start_time or step <= 0
+	SolarGeometryTable(const WeatherStations& weather_stations, double start_time, double end_time, double step);
+
+	/// @brief The interpolated solar geometry at a weather station. Times outside of the grid get the geometry at
+	/// its nearest end.
+	/// @param station_index the 0-based index of the weather station in WeatherStations. Weather and
+	/// RouteSegment::weather_station number the weather stations from 1, so weather station n is station_index n - 1.
+	SolarGeometry at(size_t station_index, double time) const {
+		const double position = std::clamp((time - start_time) * inverse_step, 0.0, last_position);
+		const auto index = std::min(static_cast<size_t>(position), num_times - 2);
+		const double t = position - static_cast<double>(index);
+		const SolarGeometry& before = geometry[station_index * num_times + index];
+		const SolarGeometry& after = geometry[station_index * num_times + index + 1];
+		return {
+			.cos_zenith = before.cos_zenith + t * (after.cos_zenith - before.cos_zenith),
+			.cos_azimuth = before.cos_azimuth + t * (after.cos_azimuth - before.cos_azimuth),
+			.sin_azimuth = before.sin_azimuth + t * (after.sin_azimuth - before.sin_azimuth),
+		};
+	}
+
+	size_t get_num_weather_stations() const {
+		return num_weather_stations;
+	}
+	double get_start_time() const {
+		return start_time;
+	}
+	double get_end_time() const {
+		return start_time + last_position / inverse_step;
+	}
+
+   private:
+	double start_time;
+	double inverse_step;
+	/// the position of the last grid time, in steps
+	double last_position;
+	size_t num_times;
+	size_t num_weather_stations;
+	/// layout: [weather station][time]
+	std::vector<SolarGeometry> geometry;
+};
+
+#endif  // MINISIM_SOLARGEOMETRYTABLE_H
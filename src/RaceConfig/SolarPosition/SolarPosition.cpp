@@ -1,5 +1,9 @@
 #include "SolarPosition.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
 #include <stdexcept>
 
 #include "DataClasses/GeographicalCoordinate.h"
@@ -7,6 +11,153 @@
 #include "Tools/TimeTools.h"
 #include "solpos/solpos.h"
 
+namespace {
+	constexpr double PI = std::numbers::pi;
+
+	// The helpers below are branch free (selects only, no calls into libm), so loops over them vectorize
+
+	/// Rounds to the nearest integer for |x| < 2^51, by letting the addition round the fraction away
+	[[gnu::always_inline]] inline double round_to_integer(double x) {
+		constexpr double shifter = 0x1.8p52;
+		return (x + shifter) - shifter;
+	}
+
+	/// sin and cos of x, accurate to about 1e-15 for |x| < 1e6 radians
+	[[gnu::always_inline]] inline void sin_cos(double x, double& sine, double& cosine) {
+		// pi / 2 in two parts, the first short enough that its product with the quadrant is exact (from fdlibm)
+		constexpr double half_pi_high = 1.57079632673412561417e+00;
+		constexpr double half_pi_low = 6.07710050650619224932e-11;
+		const double quadrant = round_to_integer(x * (2.0 / PI));
+		const double r = (x - quadrant * half_pi_high) - quadrant * half_pi_low;
+		const double z = r * r;
+
+		// fdlibm's minimax polynomials on [-pi / 4, pi / 4]
+		const double sin_r =
+			r + r * z * (-1.66666666666666324348e-01 +
+							z * (8.33333333332248946124e-03 +
+									z * (-1.98412698298579493134e-04 +
+											z * (2.75573137070700676789e-06 +
+													z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+		const double cos_r =
+			1.0 - 0.5 * z +
+			z * z * (4.16666666666666019037e-02 +
+						z * (-1.38888888888741095749e-03 +
+								z * (2.48015872894767294178e-05 +
+										z * (-2.75573143513906633035e-07 +
+												z * (2.08757232129817482790e-09 - z * 1.13596475577881948265e-11)))));
+
+		// the quadrant modulo 4, without integer conversions
+		const double turn = quadrant - 4.0 * round_to_integer((quadrant - 1.5) / 4.0);
+		const bool odd = (turn == 1.0) | (turn == 3.0);
+		const double unsigned_sine = odd ? cos_r : sin_r;
+		const double unsigned_cosine = odd ? sin_r : cos_r;
+		sine = turn >= 2.0 ? -unsigned_sine : unsigned_sine;
+		cosine = ((turn == 1.0) | (turn == 2.0)) ? -unsigned_cosine : unsigned_cosine;
+	}
+
+	/// atan of x in [0, 1], accurate to about 2e-12
+	[[gnu::always_inline]] inline double atan_unit(double x) {
+		// atan(x) = pi / 4 + atan((x - 1) / (x + 1)) brings the argument within tan(pi / 8) of 0, where 13 terms of the
+		// Taylor series are enough
+		constexpr double tan_eighth_pi = 0.41421356237309503;
+		const bool shifted = x > tan_eighth_pi;
+		// both sides of every select are computed, so the compiler can turn it into a blend
+		const double shifted_x = (x - 1.0) / (x + 1.0);
+		const double t = shifted ? shifted_x : x;
+		const double z = t * t;
+		double series = 1.0 / 25.0;
+		for (int term = 11; term >= 0; --term) {
+			series = 1.0 / (2.0 * term + 1.0) - z * series;
+		}
+		return (shifted ? PI / 4.0 : 0.0) + t * series;
+	}
+
+	/// atan2(y, x) in [-pi, pi]
+	[[gnu::always_inline]] inline double atan_2(double y, double x) {
+		const double abs_x = std::abs(x);
+		const double abs_y = std::abs(y);
+		const double larger = std::max(abs_x, abs_y);
+		const double smaller = std::min(abs_x, abs_y);
+		double angle = atan_unit(smaller / std::max(larger, std::numeric_limits<double>::min()));
+		angle = abs_y > abs_x ? PI / 2.0 - angle : angle;
+		angle = x < 0.0 ? PI - angle : angle;
+		return y < 0.0 ? -angle : angle;
+	}
+
+	/// The solar position of one query, see SolarPosition::fast
+	[[gnu::always_inline]] inline void solar_position(double timestamp, double latitude, double longitude, double pressure,
+		double temperature, double& azimuth, double& zenith) {
+		// Days since 2000-01-01 12:00 UT, and hours since midnight UT
+		constexpr double seconds_per_day = 86400.0;
+		constexpr double unix_days_at_j2000 = 10957.5;
+		const double days = timestamp / seconds_per_day - unix_days_at_j2000;
+		const double hours = (timestamp - seconds_per_day * round_to_integer(timestamp / seconds_per_day - 0.5)) / 3600.0;
+
+		// Ecliptic coordinates of the sun
+		double sin_omega = 0.0;
+		double cos_omega = 0.0;
+		sin_cos(2.1429 - 0.0010394594 * days, sin_omega, cos_omega);
+		double sin_anomaly = 0.0;
+		double cos_anomaly = 0.0;
+		sin_cos(6.2400600 + 0.0172019699 * days, sin_anomaly, cos_anomaly);
+		const double mean_longitude = 4.8950630 + 0.017202791698 * days;
+		const double ecliptic_longitude = mean_longitude + 0.03341607 * sin_anomaly +
+										  0.00034894 * 2.0 * sin_anomaly * cos_anomaly - 0.0001134 -
+										  0.0000203 * sin_omega;
+		const double obliquity = 0.4090928 - 6.2140e-9 * days + 0.0000396 * cos_omega;
+
+		// Celestial coordinates
+		double sin_longitude = 0.0;
+		double cos_longitude = 0.0;
+		sin_cos(ecliptic_longitude, sin_longitude, cos_longitude);
+		double sin_obliquity = 0.0;
+		double cos_obliquity = 0.0;
+		sin_cos(obliquity, sin_obliquity, cos_obliquity);
+		const double right_ascension = atan_2(cos_obliquity * sin_longitude, cos_longitude);
+		const double sin_declination = sin_obliquity * sin_longitude;
+		const double cos_declination = std::sqrt(1.0 - sin_declination * sin_declination);
+
+		// Local coordinates
+		const double sidereal_hours = 6.6974243242 + 0.0657098283 * days + hours;
+		const double hour_angle = (sidereal_hours * 15.0 + longitude) * (PI / 180.0) - right_ascension;
+		double sin_hour_angle = 0.0;
+		double cos_hour_angle = 0.0;
+		sin_cos(hour_angle, sin_hour_angle, cos_hour_angle);
+		double sin_latitude = 0.0;
+		double cos_latitude = 0.0;
+		sin_cos(latitude * (PI / 180.0), sin_latitude, cos_latitude);
+
+		const double cos_zenith =
+			cos_latitude * cos_hour_angle * cos_declination + sin_declination * sin_latitude;
+		const double sin_zenith = std::sqrt(std::max(0.0, 1.0 - cos_zenith * cos_zenith));
+		// with the parallax of looking from the surface of the earth rather than its centre
+		constexpr double earth_radius_in_au = 6371.01 / 149597890.0;
+		const double geometric_zenith = atan_2(sin_zenith, cos_zenith) + earth_radius_in_au * sin_zenith;
+		const double raw_azimuth = atan_2(-sin_hour_angle * cos_declination,
+			sin_declination * cos_latitude - sin_latitude * cos_hour_angle * cos_declination);
+		azimuth = raw_azimuth < 0.0 ? raw_azimuth + 2.0 * PI : raw_azimuth;
+
+		// solpos' atmospheric refraction correction, in degrees and arcseconds like solpos
+		const double elevation = 90.0 - geometric_zenith * (180.0 / PI);
+		double sin_elevation = 0.0;
+		double cos_elevation = 0.0;
+		sin_cos(elevation * (PI / 180.0), sin_elevation, cos_elevation);
+		const double tan_elevation = sin_elevation / cos_elevation;
+		const double tan_elevation_3 = tan_elevation * tan_elevation * tan_elevation;
+		const double tan_elevation_5 = tan_elevation_3 * tan_elevation * tan_elevation;
+		const double high_sun = 58.1 / tan_elevation - 0.07 / tan_elevation_3 + 0.000086 / tan_elevation_5;
+		const double low_sun =
+			1735.0 + elevation * (-518.2 + elevation * (103.4 + elevation * (-12.79 + elevation * 0.711)));
+		const double set_sun = -20.774 / tan_elevation;
+		const double arcseconds = elevation > 85.0 ? 0.0
+								  : elevation >= 5.0 ? high_sun
+								  : elevation >= -0.575 ? low_sun
+														: set_sun;
+		const double refraction = arcseconds * (pressure * 283.0) / (1013.0 * (273.0 + temperature)) / 3600.0;
+		zenith = (90.0 - std::max(elevation + refraction, -9.0)) * (PI / 180.0);
+	}
+}  // namespace
+
 SolarPosition::SolarPositionData SolarPosition::solpos::calculate(const SolarPositionConfig& config) {
 	const double latitude = config.coordinate.latitude;
 	const double longitude = config.coordinate.longitude;
@@ -17,7 +168,7 @@ SolarPosition::SolarPositionData SolarPosition::solpos::calculate(const SolarPos
 	S_init(&output_data);
 
 	 
-	output_data.function = (S_REFRAC & ~S_DOY) | S_SOLAZM;   
+	output_data.function = (S_REFRAC | S_SOLAZM) & ~S_DOY;   
 
 	 
 	output_data.year = time_data.year;
@@ -47,3 +198,30 @@ SolarPosition::SolarPositionData SolarPosition::solpos::calculate(const SolarPos
 		deg_to_rad(static_cast<double>(output_data.zenref)),
 	};
 }
+
+SolarPosition::SolarPositionData SolarPosition::fast::calculate(const SolarPositionConfig& config) {
+	SolarPositionData data = {};
+	solar_position(config.timestamp, config.coordinate.latitude, config.coordinate.longitude, config.pressure,
+		config.temperature, data.azimuth, data.zenith);
+	return data;
+}
+
+void SolarPosition::fast::calculate_batch(const SolarPositionBatchIn& in, const SolarPositionBatchOut& out) {
+	const size_t count = in.timestamps.size();
+	if (in.latitudes.size() != count || in.longitudes.size() != count || in.pressures.size() != count ||
+		in.temperatures.size() != count || out.azimuths.size() != count || out.zeniths.size() != count) {
+		throw std::invalid_argument("solar position batch arrays must all have the same length");
+	}
+	const double* timestamps = in.timestamps.data();
+	const double* latitudes = in.latitudes.data();
+	const double* longitudes = in.longitudes.data();
+	const double* pressures = in.pressures.data();
+	const double* temperatures = in.temperatures.data();
+	double* azimuths = out.azimuths.data();
+	double* zeniths = out.zeniths.data();
+#pragma GCC ivdep
+	for (size_t query = 0; query < count; ++query) {
+		solar_position(timestamps[query], latitudes[query], longitudes[query], pressures[query], temperatures[query],
+			azimuths[query], zeniths[query]);
+	}
+}
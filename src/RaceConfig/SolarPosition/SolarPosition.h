@@ -2,6 +2,7 @@
 #define MINISIM_SOLARPOSITION_H
 
 #include <optional>
+#include <span>
 
 #include "DataClasses/GeographicalCoordinate.h"
 
@@ -74,10 +75,47 @@ namespace SolarPosition {
 		double zenith;
 	};
 
+	/// @brief The inputs of a batch of solar position calculations, one element per query in each array
+	struct SolarPositionBatchIn {
+		/// Units: Epoch Time
+		std::span<const double> timestamps;
+		/// Units: degrees
+		std::span<const double> latitudes;
+		/// Units: degrees
+		std::span<const double> longitudes;
+		/// Units: millibars
+		std::span<const double> pressures;
+		/// Units: Celsius
+		std::span<const double> temperatures;
+	};
+
+	/// @brief Where a batch of solar position calculations goes, one element per query in each array
+	struct SolarPositionBatchOut {
+		/// Radians Azimuth of the Sun
+		std::span<double> azimuths;
+		/// Radians Zenith of the Sun
+		std::span<double> zeniths;
+	};
+
 	namespace solpos {
 		SolarPositionData calculate(const SolarPositionConfig& config);
 	}
 
+	/// A compact analytical solar position algorithm (the PSA algorithm of Blanco-Muriel et al., 2001) with solpos'
+	/// atmospheric refraction correction, for when solar positions are needed inside the race loop.
+	///
+	/// It works straight from the epoch time (no calendar conversion), and the batch version runs across SIMD lanes.
+	/// In daylight from 2000 to 2030 it agrees with solpos::calculate() to within 0.01 degrees in zenith while the sun
+	/// is more than 5 degrees up (0.05 degrees lower down, where refraction changes fastest), and to within
+	/// 0.025 / sin(zenith) degrees in azimuth. At night solpos clamps the zenith to about 99 degrees, and this to 99.
+	namespace fast {
+		SolarPositionData calculate(const SolarPositionConfig& config);
+
+		/// @brief calculate() for many queries at once
+		/// @throws std::invalid_argument if the arrays do not all have the same length
+		void calculate_batch(const SolarPositionBatchIn& in, const SolarPositionBatchOut& out);
+	}  // namespace fast
+
 }  // namespace SolarPosition
 
 #endif  // MINISIM_SOLARPOSITION_H
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "SolarGeometryTable.h"
+#include "SolarPosition.h"
+
+using Catch::Matchers::WithinAbs;
+
+using namespace SolarPosition;
+
+namespace {
+	constexpr double RADIANS_PER_DEGREE = std::numbers::pi / 180.0;
+
+	/// Random daylight and night queries between 2000 and 2030
+	std::vector<SolarPositionConfig> make_configs(size_t count) {
+		std::mt19937 generator(3);
+		std::uniform_real_distribution<double> timestamp(946684800.0, 1893456000.0);
+		std::uniform_real_distribution<double> latitude(-45.0, 45.0);
+		std::uniform_real_distribution<double> longitude(-180.0, 180.0);
+		std::uniform_real_distribution<double> pressure(900.0, 1050.0);
+		std::uniform_real_distribution<double> temperature(-10.0, 45.0);
+		std::vector<SolarPositionConfig> configs;
+		for (size_t config = 0; config < count; ++config) {
+			configs.push_back({
+				.pressure = pressure(generator),
+				.temperature = temperature(generator),
+				.elevation = 0.0,
+				// solpos takes whole seconds
+				.timestamp = std::floor(timestamp(generator)),
+				.coordinate = {latitude(generator), longitude(generator)},
+			});
+		}
+		return configs;
+	}
+}  // namespace
+
+TEST_CASE("SolarPosition: fast matches solpos", "[SolarPosition]") {
+	for (const auto& config : make_configs(20000)) {
+		const SolarPositionData expected = solpos::calculate(config);
+		const SolarPositionData actual = fast::calculate(config);
+		if (expected.zenith >= 90.0 * RADIANS_PER_DEGREE) {
+			continue;
+		}
+		const double zenith_error = expected.zenith < 85.0 * RADIANS_PER_DEGREE ? 0.01 : 0.05;
+		REQUIRE_THAT(actual.zenith, WithinAbs(expected.zenith, zenith_error * RADIANS_PER_DEGREE));
+		const double azimuth_difference = std::remainder(actual.azimuth - expected.azimuth, 2.0 * std::numbers::pi);
+		REQUIRE_THAT(azimuth_difference * std::sin(expected.zenith), WithinAbs(0.0, 0.025 * RADIANS_PER_DEGREE));
+	}
+}
+
+TEST_CASE("SolarPosition: fast batches match single queries", "[SolarPosition]") {
+	const auto configs = make_configs(1001);
+	std::vector<double> timestamps;
+	std::vector<double> latitudes;
+	std::vector<double> longitudes;
+	std::vector<double> pressures;
+	std::vector<double> temperatures;
+	for (const auto& config : configs) {
+		timestamps.push_back(config.timestamp);
+		latitudes.push_back(config.coordinate.latitude);
+		longitudes.push_back(config.coordinate.longitude);
+		pressures.push_back(config.pressure);
+		temperatures.push_back(config.temperature);
+	}
+	std::vector<double> azimuths(configs.size());
+	std::vector<double> zeniths(configs.size());
+	fast::calculate_batch({timestamps, latitudes, longitudes, pressures, temperatures}, {azimuths, zeniths});
+
+	for (size_t query = 0; query < configs.size(); ++query) {
+		const SolarPositionData single = fast::calculate(configs[query]);
+		REQUIRE_THAT(azimuths[query], WithinAbs(single.azimuth, 1e-12));
+		REQUIRE_THAT(zeniths[query], WithinAbs(single.zenith, 1e-12));
+	}
+
+	std::vector<double> too_short(configs.size() - 1);
+	REQUIRE_THROWS_AS(
+		fast::calculate_batch({timestamps, latitudes, longitudes, pressures, temperatures}, {azimuths, too_short}),
+		std::invalid_argument);
+}
+
+TEST_CASE("SolarGeometryTable: matches the solar position between grid times", "[SolarPosition]") {
+	const WeatherStations weather_stations(std::vector<GeographicalCoordinate>{{-12.46, 130.84}, {-34.93, 138.60}});
+	constexpr double start_time = 1697328000.0;
+	constexpr double end_time = start_time + 3.0 * 86400.0;
+	constexpr double step = 60.0;
+	const SolarGeometryTable table(weather_stations, start_time, end_time, step);
+	REQUIRE(table.get_num_weather_stations() == 2);
+	REQUIRE(table.get_end_time() >= end_time);
+
+	for (size_t station = 0; station < weather_stations.size(); ++station) {
+		for (double time = start_time; time <= end_time; time += 317.3) {
+			const SolarPositionData position = fast::calculate({
+				.pressure = 1013.25,
+				.temperature = 15.0,
+				.elevation = 0.0,
+				.timestamp = time,
+				.coordinate = weather_stations[station],
+			});
+			const SolarGeometry geometry = table.at(station, time);
+			// refraction bends the zenith quickly right at the horizon, so allow for more there
+			const double tolerance = std::abs(std::cos(position.zenith)) < 0.1 ? 1e-3 : 1e-5;
+			REQUIRE_THAT(geometry.cos_zenith, WithinAbs(std::cos(position.zenith), tolerance));
+			if (std::cos(position.zenith) > 0.1) {
+				// the azimuth swings quickly with the sun near the zenith, where it matters little
+				const double sin_zenith = std::sin(position.zenith);
+				REQUIRE_THAT(geometry.cos_azimuth * sin_zenith, WithinAbs(std::cos(position.azimuth) * sin_zenith, 1e-4));
+				REQUIRE_THAT(geometry.sin_azimuth * sin_zenith, WithinAbs(std::sin(position.azimuth) * sin_zenith, 1e-4));
+			}
+		}
+	}
+
+	// outside of the grid, the nearest end
+	REQUIRE(table.at(1, start_time - 1000.0).cos_zenith == table.at(1, start_time).cos_zenith);
+	REQUIRE(table.at(1, end_time + 1e6).cos_zenith == table.at(1, table.get_end_time()).cos_zenith);
+	REQUIRE_THROWS_AS(SolarGeometryTable(weather_stations, start_time, start_time, step), std::invalid_argument);
+}
@@ -0,0 +1,547 @@
+#include "SyntheticInputs.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "RaceConfig/RaceConfigConstants.h"
+#include "RaceConfig/Weather/WeatherConstants.h"
+#include "Tools/Conversions.h"
+#include "Tools/TimeTools.h"
+
+namespace {
+	constexpr double PI = std::numbers::pi;
+	constexpr double HOUR = 3600.0;
+	constexpr double DAY = 86400.0;
+	/// (m)
+	constexpr double EARTH_RADIUS = 6371000.0;
+
+	/// @brief Uniform and normal random numbers from std::mt19937_64, whose output the standard fixes. The standard
+	/// distributions are left to the implementation, so they would give other inputs with another standard library.
+	class Random {
+	   public:
+		explicit Random(std::uint64_t seed) : engine(seed) {}
+
+		/// @return in [0, 1)
+		double uniform() {
+			constexpr int MANTISSA_BITS = 53;
+			return static_cast<double>(engine() >> (64 - MANTISSA_BITS)) * 0x1.0p-53;
+		}
+
+		double uniform(double low, double high) {
+			return low + (high - low) * uniform();
+		}
+
+		/// @return a standard normal number (Box-Muller)
+		double normal() {
+			const double radius = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+			return radius * std::cos(2.0 * PI * uniform());
+		}
+
+		bool chance(double probability) {
+			return uniform() < probability;
+		}
+
+	   private:
+		std::mt19937_64 engine;
+	};
+
+	/// @brief A seed for the stream of one weather station or day, independent of the streams of the others
+	/// (splitmix64)
+	std::uint64_t mix(std::uint64_t seed, std::uint64_t index) {
+		std::uint64_t z = seed + (index + 1) * 0x9E3779B97F4A7C15ULL;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	// Route
+
+	struct SpeedLimit {
+		/// (m/s)
+		double speed;
+		/// how many segments of data/Route/route.csv have it
+		double num_segments;
+		/// how many segments it holds for on average
+		double mean_run;
+	};
+
+	constexpr std::array<SpeedLimit, 9> SPEED_LIMITS = {{
+		{.speed = 36.11111, .num_segments = 3236.0, .mean_run = 60.0},
+		{.speed = 30.55556, .num_segments = 2478.0, .mean_run = 40.0},
+		{.speed = 27.77778, .num_segments = 254.0, .mean_run = 12.0},
+		{.speed = 16.66667, .num_segments = 214.0, .mean_run = 8.0},
+		{.speed = 22.22222, .num_segments = 157.0, .mean_run = 8.0},
+		{.speed = 13.88889, .num_segments = 94.0, .mean_run = 6.0},
+		{.speed = 11.11111, .num_segments = 65.0, .mean_run = 4.0},
+		{.speed = 25.0, .num_segments = 25.0, .mean_run = 6.0},
+		{.speed = 19.44444, .num_segments = 21.0, .mean_run = 6.0},
+	}};
+	/// (m/s) traffic lights are only in towns
+	constexpr double TOWN_SPEED_LIMIT = 16.7;
+	constexpr double TRAFFIC_LIGHT_CHANCE = 0.15;
+	constexpr double BEND_CHANCE = 0.1;
+	constexpr double HILL_CHANCE = 0.01;
+	constexpr int NUM_CONTROL_STOPS = 9;
+
+	/// (m) a segment that ends for no other reason
+	constexpr double MIN_FULL_SEGMENT = 470.0;
+	constexpr double MAX_FULL_SEGMENT = 510.0;
+	/// (m) a segment cut short by a bend, a grade change, a speed limit change, a traffic light or a control stop
+	constexpr double MIN_SHORT_SEGMENT = 30.0;
+
+	/// (m)
+	constexpr double MIN_ELEVATION = 20.0;
+	constexpr double MAX_ELEVATION = 700.0;
+	constexpr double MAX_GRADE = 0.06;
+
+	/// the route turns back north at the south coast and back south at the north coast
+	constexpr double SOUTH_TURN_LATITUDE = -34.9;
+	constexpr double NORTH_TURN_LATITUDE = -12.4;
+
+	/// Picks the speed limit of the next run of segments, other than the current one. Each is picked as often as
+	/// gives it the share of segments it has in data/Route/route.csv.
+	std::size_t pick_speed_limit(Random& random, std::size_t current) {
+		double total = 0.0;
+		for (std::size_t index = 0; index < SPEED_LIMITS.size(); ++index) {
+			total += index == current ? 0.0 : SPEED_LIMITS[index].num_segments / SPEED_LIMITS[index].mean_run;
+		}
+		double pick = random.uniform() * total;
+		for (std::size_t index = 0; index < SPEED_LIMITS.size(); ++index) {
+			if (index == current) {
+				continue;
+			}
+			pick -= SPEED_LIMITS[index].num_segments / SPEED_LIMITS[index].mean_run;
+			if (pick < 0.0) {
+				return index;
+			}
+		}
+		return current == 0 ? 1 : 0;
+	}
+
+	/// @return how many segments a speed limit holds for: at least one, geometric with its mean run
+	int pick_run(Random& random, std::size_t speed_limit) {
+		const double mean_run = SPEED_LIMITS[speed_limit].mean_run;
+		return 1 + static_cast<int>(std::floor(std::log(1.0 - random.uniform()) / std::log(1.0 - 1.0 / mean_run)));
+	}
+
+	/// @return (m/s^2) the International Gravity Formula with the free air correction
+	double gravity_at(double latitude, double elevation) {
+		const double sine_latitude = std::sin(deg_to_rad(latitude));
+		const double sine_twice_latitude = std::sin(2.0 * deg_to_rad(latitude));
+		return 9.780327 *
+				   (1.0 + 0.0053024 * sine_latitude * sine_latitude -
+					   0.0000058 * sine_twice_latitude * sine_twice_latitude) -
+			   3.086e-6 * elevation;
+	}
+
+	/// @param heading (rad) clockwise from north
+	/// @param distance (m)
+	GeographicalCoordinate move(const GeographicalCoordinate& from, double heading, double distance) {
+		const double angle = distance / EARTH_RADIUS;
+		return {
+			.latitude = from.latitude + rad_to_deg(angle * std::cos(heading)),
+			.longitude = from.longitude + rad_to_deg(angle * std::sin(heading) / std::cos(deg_to_rad(from.latitude))),
+		};
+	}
+
+	/// Spaces the weather stations evenly along the route, and sets the weather station of each segment to where its
+	/// middle is between them
+	std::vector<GeographicalCoordinate> place_weather_stations(
+		std::vector<RouteSegment>& segments, std::size_t num_weather_stations) {
+		double total_distance = 0.0;
+		for (const RouteSegment& segment : segments) {
+			total_distance += segment.distance;
+		}
+		const auto spacing = num_weather_stations > 1
+								 ? total_distance / static_cast<double>(num_weather_stations - 1)
+								 : std::numeric_limits<double>::infinity();
+
+		// (m) along the route
+		const auto next_weather_station = [&](const std::vector<GeographicalCoordinate>& placed) {
+			return placed.empty() ? 0.0 : static_cast<double>(placed.size()) * spacing;
+		};
+
+		std::vector<GeographicalCoordinate> weather_stations;
+		double distance = 0.0;
+		for (RouteSegment& segment : segments) {
+			segment.weather_station = 1.0 + (distance + 0.5 * segment.distance) / spacing;
+			while (weather_stations.size() < num_weather_stations &&
+				   next_weather_station(weather_stations) <= distance + segment.distance) {
+				const double fraction =
+					std::clamp((next_weather_station(weather_stations) - distance) / segment.distance, 0.0, 1.0);
+				weather_stations.push_back(
+					segment.coordinate_start + (segment.coordinate_end - segment.coordinate_start) * fraction);
+			}
+			distance += segment.distance;
+		}
+		// The last one can fall just past the end from rounding
+		while (weather_stations.size() < num_weather_stations) {
+			weather_stations.push_back(segments.back().coordinate_end);
+		}
+		return weather_stations;
+	}
+
+	// Weather
+
+	constexpr double SPECIFIC_GAS_CONSTANT_DRY_AIR = 287.05;  // J/(kg K)
+	constexpr double HEAT_CAPACITY_RATIO_DRY_AIR = 1.4;
+
+	/// the dry season cloud cover, out of 1, and how much it changes from day to day
+	constexpr double MEAN_CLOUD_COVER = 0.12;
+	constexpr double CLOUD_COVER_SPREAD = 0.2;
+	/// how much of the anomalies of cloud cover, temperature and pressure carries over to the next day
+	constexpr double DAILY_PERSISTENCE = 0.6;
+	/// (deg) the size of weather systems: weather stations closer than this mostly share their days
+	constexpr double WEATHER_SYSTEM_SIZE = 5.0;
+	/// how much of a day's anomaly is the weather system's, rather than the weather station's own
+	constexpr double WEATHER_SYSTEM_SHARE = 0.8;
+
+	/// (m/s) the south east trade winds
+	constexpr double TRADE_WIND_SPEED = 4.5;
+	constexpr double TRADE_WIND_BEARING = deg_to_rad(135.0);
+	/// (m/s) gusts, which fade by GUST_PERSISTENCE an hour
+	constexpr double GUST_SPREAD = 1.5;
+	constexpr double GUST_PERSISTENCE = 0.85;
+
+	/// a day's anomaly of a weather system, smooth across the weather systems at the latitudes around it
+	double weather_system_anomaly(std::uint64_t seed, std::int64_t day, double latitude) {
+		const double band = (latitude + 90.0) / WEATHER_SYSTEM_SIZE;
+		const double below = std::floor(band);
+		const double fraction = band - below;
+		const std::uint64_t day_seed = mix(seed, static_cast<std::uint64_t>(day));
+		const double anomaly_below = Random(mix(day_seed, static_cast<std::uint64_t>(below))).normal();
+		const double anomaly_above = Random(mix(day_seed, static_cast<std::uint64_t>(below) + 1)).normal();
+		// Interpolating two independent normals narrows them, so scale back to a standard normal
+		return ((1.0 - fraction) * anomaly_below + fraction * anomaly_above) /
+			   std::sqrt((1.0 - fraction) * (1.0 - fraction) + fraction * fraction);
+	}
+
+	/// @return 1 at the peak hour and -1 half a cycle from it
+	/// @param cycles how many times a day it peaks
+	double daily_cycle(double local_solar_hour, double peak_hour, double cycles = 1.0) {
+		return std::cos(2.0 * PI * cycles * (local_solar_hour - peak_hour) / 24.0);
+	}
+
+	/// @return the cosine of the solar zenith angle
+	/// @param local_solar_hour (h) 12 at solar noon
+	double cosine_solar_zenith(double time, double latitude, double local_solar_hour) {
+		const auto days = static_cast<std::int64_t>(std::floor(time / DAY));
+		const int year = civil_from_days(days).year;
+		const auto day_of_year = static_cast<double>(days - days_from_civil(year, 1, 1) + 1);
+		const double declination = deg_to_rad(23.45) * std::sin(2.0 * PI * (284.0 + day_of_year) / 365.0);
+		const double hour_angle = deg_to_rad(15.0 * (local_solar_hour - 12.0));
+		const double phi = deg_to_rad(latitude);
+		return std::sin(phi) * std::sin(declination) + std::cos(phi) * std::cos(declination) * std::cos(hour_angle);
+	}
+
+	/// Forecasts for one weather station, in time order
+	void generate_station_weather(std::size_t index, const GeographicalCoordinate& coordinate,
+		const synthetic::WeatherOptions& options, std::vector<WeatherForecastRow>& rows) {
+		using namespace race_config::weather;
+		Random random(mix(options.seed, index));
+		const std::uint64_t weather_system_seed = mix(options.seed, ~std::uint64_t{0});
+		const auto num_forecasts =
+			static_cast<std::size_t>(std::ceil((options.end_time - options.start_time) / options.period)) + 1;
+		const double gust_persistence = std::pow(GUST_PERSISTENCE, options.period / HOUR);
+		const double gust_innovation = GUST_SPREAD * std::sqrt(1.0 - gust_persistence * gust_persistence);
+
+		// (h) solar time is ahead of UTC by an hour every 15 degrees east
+		const double solar_offset = coordinate.longitude / 15.0;
+		const double mean_temperature = 26.0 + 0.5 * (coordinate.latitude + 12.5);
+		const double mean_pressure = 101300.0 + 50.0 * (-12.5 - coordinate.latitude);
+
+		std::int64_t day = std::numeric_limits<std::int64_t>::min();
+		double cloud_anomaly = 0.0;
+		double temperature_anomaly = 0.0;
+		double gust_ns = GUST_SPREAD * random.normal();
+		double gust_ew = GUST_SPREAD * random.normal();
+		for (std::size_t forecast = 0; forecast < num_forecasts; ++forecast) {
+			const double time = options.start_time + static_cast<double>(forecast) * options.period;
+			const double solar_time = time + solar_offset * HOUR;
+			const double local_solar_hour = (solar_time - DAY * std::floor(solar_time / DAY)) / HOUR;
+
+			const auto solar_day = static_cast<std::int64_t>(std::floor(solar_time / DAY));
+			if (solar_day != day) {
+				const double persistence = day == solar_day - 1 ? DAILY_PERSISTENCE : 0.0;
+				const double innovation = std::sqrt(1.0 - persistence * persistence);
+				day = solar_day;
+				const double shared = weather_system_anomaly(weather_system_seed, day, coordinate.latitude);
+				const double anomaly =
+					WEATHER_SYSTEM_SHARE * shared + std::sqrt(1.0 - WEATHER_SYSTEM_SHARE * WEATHER_SYSTEM_SHARE) *
+														random.normal();
+				cloud_anomaly = persistence * cloud_anomaly + innovation * anomaly;
+				temperature_anomaly = persistence * temperature_anomaly + innovation * random.normal();
+			}
+
+			// Irradiance: Haurwitz's clear sky model, dimmed by the cloud cover (Kasten and Czeplak)
+			const double cloud_cover = std::clamp(
+				MEAN_CLOUD_COVER + CLOUD_COVER_SPREAD * cloud_anomaly + 0.05 * random.normal(), 0.0, 1.0);
+			const double cosine_zenith = cosine_solar_zenith(time, coordinate.latitude, local_solar_hour);
+			const double clear_sky_ghi = cosine_zenith > 0.0 ? 1098.0 * cosine_zenith * std::exp(-0.057 / cosine_zenith)
+															 : 0.0;
+			const double ghi = clear_sky_ghi * (1.0 - 0.75 * std::pow(cloud_cover, 3.4));
+			const double diffuse_fraction = std::min(1.0, 0.12 + 0.85 * cloud_cover);
+			const double dhi = diffuse_fraction * ghi;
+			const double dni = cosine_zenith > 0.05 ? (ghi - dhi) / cosine_zenith : 0.0;
+
+			// Wind: the trade winds, strongest in the afternoon, with gusts on top
+			gust_ns = gust_persistence * gust_ns + gust_innovation * random.normal();
+			gust_ew = gust_persistence * gust_ew + gust_innovation * random.normal();
+			const double trade_wind = TRADE_WIND_SPEED * (1.0 + 0.35 * daily_cycle(local_solar_hour, 14.0));
+			// The wind blows from the bearing, so it moves towards the opposite one
+			const double wind_ns = -trade_wind * std::cos(TRADE_WIND_BEARING) + gust_ns;
+			const double wind_ew = -trade_wind * std::sin(TRADE_WIND_BEARING) + gust_ew;
+
+			// Temperature peaks mid afternoon, less so under cloud; pressure has two tides a day, peaking at 10 and 22
+			const double temperature = mean_temperature + 1.5 * temperature_anomaly +
+									   7.0 * (1.0 - 0.5 * cloud_cover) * daily_cycle(local_solar_hour, 15.0);
+			const double pressure =
+				mean_pressure - 250.0 * cloud_anomaly + 120.0 * daily_cycle(local_solar_hour, 10.0, 2.0);
+
+			WeatherForecastRow row = {.weather_station = static_cast<double>(index + 1), .time = time, .values = {}};
+			row.values[CO_DHI] = dhi;
+			row.values[CO_DNI] = dni;
+			row.values[CO_GHI] = ghi;
+			row.values[CO_WIND_VELOCITY_NS] = wind_ns;
+			row.values[CO_WIND_VELOCITY_EW] = wind_ew;
+			row.values[CO_AIR_TEMPERATURE_2M] = temperature;
+			row.values[CO_SURFACE_PRESSURE] = pressure;
+			row.values[CO_AIR_DENSITY] =
+				pressure / (SPECIFIC_GAS_CONSTANT_DRY_AIR * celsius_to_kelvin(temperature));
+			rows.push_back(row);
+		}
+	}
+
+	void check_weather_options(const synthetic::WeatherOptions& options) {
+		if (!(options.period > 0.0) || !std::isfinite(options.start_time) || !std::isfinite(options.end_time) ||
+			options.end_time < options.start_time) {
+			throw std::invalid_argument("the weather needs a positive period and an end at or after its start");
+		}
+	}
+
+	// Files
+
+	void append(std::string& out, double number) {
+		std::array<char, 32> digits = {};
+		const auto result = std::to_chars(digits.data(), digits.data() + digits.size(), number);
+		out.append(digits.data(), result.ptr);
+	}
+
+	std::ofstream open(const std::string& path) {
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			throw std::runtime_error("could not write " + path);
+		}
+		return file;
+	}
+
+	void write(std::ofstream& file, const std::string& path, const std::string& text) {
+		file.write(text.data(), static_cast<std::streamsize>(text.size()));
+		if (!file) {
+			throw std::runtime_error("could not write " + path);
+		}
+	}
+
+	template <typename Enum>
+	std::string_view name_of(const std::unordered_map<std::string, Enum>& names, Enum value) {
+		for (const auto& [name, named] : names) {
+			if (named == value) {
+				return name;
+			}
+		}
+		throw std::invalid_argument("a segment has an end condition or type without a name");
+	}
+}  // namespace
+
+synthetic::GeneratedRoute synthetic::generate_route(const RouteOptions& options) {
+	if (options.num_segments == 0 || options.num_weather_stations == 0) {
+		throw std::invalid_argument("a route needs segments and weather stations");
+	}
+	Random random(mix(options.seed, 0));
+	const std::size_t control_stop_interval = std::max<std::size_t>(1, options.num_segments / (NUM_CONTROL_STOPS + 1));
+
+	GeographicalCoordinate position = options.start;
+	double heading = PI;
+	double target_heading = PI;
+	double grade = 0.0;
+	double elevation = 40.0;
+	std::size_t speed_limit = 0;
+	int run = pick_run(random, speed_limit);
+
+	GeneratedRoute route;
+	route.segments.reserve(options.num_segments);
+	for (std::size_t index = 0; index < options.num_segments; ++index) {
+		// What changes after this segment decides why it ends
+		if (target_heading == PI && position.latitude < SOUTH_TURN_LATITUDE) {
+			target_heading = 0.0;
+		} else if (target_heading == 0.0 && position.latitude > NORTH_TURN_LATITUDE) {
+			target_heading = PI;
+		}
+		double turn = 0.1 * std::remainder(target_heading - heading, 2.0 * PI) + deg_to_rad(0.5) * random.normal();
+		if (random.chance(BEND_CHANCE)) {
+			turn += deg_to_rad(8.0) * random.normal();
+		}
+		double next_grade = 0.9 * grade + 0.002 * random.normal();
+		if (random.chance(HILL_CHANCE)) {
+			next_grade += 0.02 * random.normal();
+		}
+		next_grade = std::clamp(next_grade, -MAX_GRADE, MAX_GRADE);
+		if (elevation < MIN_ELEVATION || elevation > MAX_ELEVATION) {
+			next_grade = elevation < MIN_ELEVATION ? std::abs(next_grade) : -std::abs(next_grade);
+		}
+		const bool speed_limit_changes = --run == 0;
+
+		SegmentEndCondition end_condition = MAX_LENGTH_REACHED;
+		if (index + 1 == options.num_segments) {
+			end_condition = FINISH_LINE;
+		} else if ((index + 1) % control_stop_interval == 0 &&
+				   (index + 1) / control_stop_interval <= static_cast<std::size_t>(NUM_CONTROL_STOPS)) {
+			end_condition = CONTROL_STOP;
+		} else if (speed_limit_changes) {
+			end_condition = SPEED_LIMIT_CHANGE;
+		} else if (SPEED_LIMITS[speed_limit].speed < TOWN_SPEED_LIMIT && random.chance(TRAFFIC_LIGHT_CHANCE)) {
+			end_condition = TRAFFIC_LIGHT;
+		} else if (std::abs(turn) > race_config::route::clustering::maximum_heading_delta) {
+			end_condition = MAX_CURVATURE_REACHED;
+		} else if (std::abs(next_grade - grade) > race_config::route::clustering::maximum_grade_delta) {
+			end_condition = MAX_GRADE_CHANGE_REACHED;
+		}
+		const double distance = end_condition == MAX_LENGTH_REACHED
+									? random.uniform(MIN_FULL_SEGMENT, MAX_FULL_SEGMENT)
+									: random.uniform(MIN_SHORT_SEGMENT, MIN_FULL_SEGMENT);
+
+		const GeographicalCoordinate end = move(position, heading, distance);
+		const double mean_elevation = elevation + 0.5 * grade * distance;
+		const double incline = std::atan(grade);
+		const double gravity = gravity_at(0.5 * (position.latitude + end.latitude), mean_elevation);
+		route.segments.push_back({
+			.coordinate_start = position,
+			.coordinate_end = end,
+			.end_condition = end_condition,
+			.type = RACE,
+			.speed_limit = SPEED_LIMITS[speed_limit].speed,
+			.weather_station = 1.0,
+			.distance = distance,
+			// -pi to pi, like the real routes
+			.heading = std::atan2(std::sin(heading), std::cos(heading)),
+			.elevation = mean_elevation,
+			.grade = grade,
+			.road_incline_angle = rad_to_deg(incline),
+			.sine_road_incline_angle = std::sin(incline),
+			.gravity = gravity,
+			.gravity_times_sine_road_incline_angle = gravity * std::sin(incline),
+		});
+
+		position = end;
+		elevation += grade * distance;
+		heading += turn;
+		grade = next_grade;
+		if (speed_limit_changes) {
+			speed_limit = pick_speed_limit(random, speed_limit);
+			run = pick_run(random, speed_limit);
+		}
+	}
+	route.weather_stations = place_weather_stations(route.segments, options.num_weather_stations);
+	return route;
+}
+
+std::vector<WeatherForecastRow> synthetic::generate_weather(
+	const std::vector<GeographicalCoordinate>& weather_stations, const WeatherOptions& options) {
+	check_weather_options(options);
+	std::vector<WeatherForecastRow> rows;
+	for (std::size_t index = 0; index < weather_stations.size(); ++index) {
+		generate_station_weather(index, weather_stations[index], options, rows);
+	}
+	return rows;
+}
+
+void synthetic::write_route(const std::string& path, const std::vector<RouteSegment>& segments) {
+	using namespace route;
+	std::ofstream file = open(path);
+	std::string text = CN_START_LATITUDE + ',' + CN_START_LONGITUDE + ',' + CN_END_LATITUDE + ',' + CN_END_LONGITUDE +
+					   ',' + CN_SEGMENT_END_CONDITION + ',' + CN_SEGMENT_TYPE + ',' + CN_SPEED_LIMIT + ',' +
+					   CN_WEATHER_STATION_INDEX + ',' + CN_DISTANCE + ',' + CN_HEADING + ',' + CN_ELEVATION + ',' +
+					   CN_GRADE + ',' + CN_ROAD_INCLINE_ANGLE + ',' + CN_SINE_ROAD_INCLINE_ANGLE + ',' + CN_GRAVITY +
+					   ',' + CN_GRAVITY_TIMES_SINE_ROAD_ANGLE + '\n';
+	for (const RouteSegment& segment : segments) {
+		for (const double value : {segment.coordinate_start.latitude, segment.coordinate_start.longitude,
+				 segment.coordinate_end.latitude, segment.coordinate_end.longitude}) {
+			append(text, value);
+			text += ',';
+		}
+		text += name_of(string_to_segment_end_condition_map, segment.end_condition);
+		text += ',';
+		text += name_of(string_to_segment_type_map, segment.type);
+		for (const double value : {segment.speed_limit, segment.weather_station, segment.distance, segment.heading,
+				 segment.elevation, segment.grade, segment.road_incline_angle, segment.sine_road_incline_angle,
+				 segment.gravity, segment.gravity_times_sine_road_incline_angle}) {
+			text += ',';
+			append(text, value);
+		}
+		text += '\n';
+	}
+	write(file, path, text);
+}
+
+void synthetic::write_weather_stations(
+	const std::string& path, const std::vector<GeographicalCoordinate>& weather_stations) {
+	using namespace race_config::weather::stations;
+	std::ofstream file = open(path);
+	std::string text = std::string(CN_STATION_NAME) + ',' + std::string(CN_STATION_ID) + ',' +
+					   std::string(CN_STATION_LATITUDE) + ',' + std::string(CN_STATION_LONGITUDE) + '\n';
+	for (std::size_t index = 0; index < weather_stations.size(); ++index) {
+		const std::string id = std::to_string(index + 1);
+		text += "Station" + id + ',' + id + ',';
+		append(text, weather_stations[index].latitude);
+		text += ',';
+		append(text, weather_stations[index].longitude);
+		text += '\n';
+	}
+	write(file, path, text);
+}
+
+void synthetic::write_weather(const std::string& path, const std::vector<GeographicalCoordinate>& weather_stations,
+	const WeatherOptions& options) {
+	using namespace race_config::weather;
+	check_weather_options(options);
+	std::ofstream file = open(path);
+	// The reciprocal speed of sound is not read any more, but older readers of weather files expect it
+	std::string text = std::string(CN_WEATHER_STATION) + ',' + std::string(CN_UNIX_PERIOD) + ',' +
+					   std::string(CN_DHI) + ',' + std::string(CN_DNI) + ',' + std::string(CN_GHI) + ',' +
+					   std::string(CN_WIND_VELOCITY_NS) + ',' + std::string(CN_WIND_VELOCITY_EW) + ',' +
+					   std::string(CN_AIR_TEMPERATURE_2M) + ',' + std::string(CN_SURFACE_PRESSURE) + ',' +
+					   std::string(CN_AIR_DENSITY) + ',' + ::weather::CN_RECIPROCAL_SPEED_OF_SOUND + '\n';
+	std::vector<WeatherForecastRow> rows;
+	for (std::size_t index = 0; index < weather_stations.size(); ++index) {
+		rows.clear();
+		generate_station_weather(index, weather_stations[index], options, rows);
+		for (const WeatherForecastRow& row : rows) {
+			append(text, row.weather_station);
+			text += ',';
+			append(text, row.time);
+			for (const double value : row.values) {
+				text += ',';
+				append(text, value);
+			}
+			text += ',';
+			append(text, 1.0 / std::sqrt(HEAT_CAPACITY_RATIO_DRY_AIR * SPECIFIC_GAS_CONSTANT_DRY_AIR *
+											 celsius_to_kelvin(row.values[CO_AIR_TEMPERATURE_2M])));
+			text += '\n';
+		}
+		write(file, path, text);
+		text.clear();
+	}
+	write(file, path, text);
+}
@@ -0,0 +1,75 @@
+#ifndef MINISIM_SYNTHETICINPUTS_H
+#define MINISIM_SYNTHETICINPUTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "DataClasses/GeographicalCoordinate.h"
+#include "RaceConfig/Route/RouteSegment.h"
+#include "RaceConfig/Weather/WeatherGrid.h"
+
+/// Generates routes, weather stations and weather shaped like the real inputs, of any size, for tests and benchmarks
+/// that must run without the real files and for scaling tests far beyond them. The same options always give the
+/// same inputs: the random numbers do not depend on the standard library.
+namespace synthetic {
+	struct RouteOptions {
+		std::uint64_t seed = 1;
+		std::size_t num_segments = 6544;
+		/// spaced evenly along the route
+		std::size_t num_weather_stations = 23;
+		/// where the route starts: Darwin, like data/Route/route.csv
+		GeographicalCoordinate start = {.latitude = -12.4655, .longitude = 130.8425};
+	};
+
+	struct WeatherOptions {
+		std::uint64_t seed = 1;
+		/// (Epoch Time) the first forecast
+		double start_time = 0.0;
+		/// (Epoch Time) the last forecast is at or after it
+		double end_time = 0.0;
+		/// (s) between forecasts
+		double period = 3600.0;
+	};
+
+	struct GeneratedRoute {
+		std::vector<RouteSegment> segments;
+		/// segment.weather_station is 1 at the first and weather_stations.size() at the last
+		std::vector<GeographicalCoordinate> weather_stations;
+	};
+
+	/// @brief A route that runs south from the start and turns back north when it reaches the south coast, as often
+	/// as it has to: segments of up to about 500 m ending in bends, grade changes, speed limit changes, traffic
+	/// lights and control stops, a bounded random walk of elevation, and runs of the speed limits of the Stuart
+	/// Highway
+	/// @throws std::invalid_argument if there are no segments or no weather stations
+	GeneratedRoute generate_route(const RouteOptions& options);
+
+	/// @brief Forecasts for every weather station from options.start_time to options.end_time, grouped by weather
+	/// station like the real files: irradiance from the position of the sun through clouds that change from day to
+	/// day, the south east trade winds with a diurnal cycle and gusts, a diurnal temperature cycle that is cooler to
+	/// the south, and the semidiurnal pressure tide. Days are cloudy together across neighbouring weather stations.
+	/// @param weather_stations weather station i + 1 is at weather_stations[i]
+	/// @throws std::invalid_argument if the period is not positive or the end is before the start
+	std::vector<WeatherForecastRow> generate_weather(
+		const std::vector<GeographicalCoordinate>& weather_stations, const WeatherOptions& options);
+
+	/// @brief Writes a route file that Route reads
+	/// @throws std::runtime_error if the file cannot be written
+	void write_route(const std::string& path, const std::vector<RouteSegment>& segments);
+
+	/// @brief Writes a weather stations file that WeatherStations reads, naming weather station i + 1 "Station<i + 1>"
+	/// @throws std::runtime_error if the file cannot be written
+	void write_weather_stations(const std::string& path, const std::vector<GeographicalCoordinate>& weather_stations);
+
+	/// @brief Writes the forecasts generate_weather() gives as a weather file that Weather reads, one weather station
+	/// at a time, so months of weather for hundreds of weather stations never have to fit in memory. The numbers are
+	/// written in their shortest form that reads back as the same double.
+	/// @throws std::runtime_error if the file cannot be written
+	/// @throws std::invalid_argument as generate_weather() does
+	void write_weather(const std::string& path, const std::vector<GeographicalCoordinate>& weather_stations,
+		const WeatherOptions& options);
+}  // namespace synthetic
+
+#endif  // MINISIM_SYNTHETICINPUTS_H
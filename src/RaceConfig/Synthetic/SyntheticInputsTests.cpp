@@ -0,0 +1,162 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <numbers>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "RaceConfig/Route/Route.h"
+#include "RaceConfig/Weather/Weather.h"
+#include "RaceConfig/WeatherStations/WeatherStations.h"
+#include "SyntheticInputs.h"
+#include "TestSupport/TestSupport.h"
+
+using Catch::Matchers::WithinAbs;
+using test_support::read_file;
+using test_support::temporary_path;
+
+using namespace race_config::weather;
+
+namespace {
+	/// 2007-08-23T00:00:00Z, the day before the 2007 schedule starts
+	constexpr double START_TIME = 1187827200.0;
+	constexpr double HOUR = 3600.0;
+	constexpr double DAY = 86400.0;
+
+	synthetic::WeatherOptions three_days(std::uint64_t seed = 1) {
+		return {.seed = seed, .start_time = START_TIME, .end_time = START_TIME + 3 * DAY, .period = HOUR};
+	}
+}  // namespace
+
+TEST_CASE("SyntheticInputs: routes", "[SyntheticInputs]") {
+	const synthetic::GeneratedRoute route = synthetic::generate_route({.num_segments = 2000});
+	REQUIRE(route.segments.size() == 2000);
+	REQUIRE(route.weather_stations.size() == 23);
+	CHECK(route.segments.back().end_condition == FINISH_LINE);
+	CHECK(std::count_if(route.segments.begin(), route.segments.end(), [](const RouteSegment& segment) {
+		return segment.end_condition == CONTROL_STOP;
+	}) == 9);
+
+	for (std::size_t index = 0; index < route.segments.size(); ++index) {
+		const RouteSegment& segment = route.segments[index];
+		CHECK(segment.distance > 0.0);
+		CHECK(segment.distance <= 510.0);
+		CHECK(std::abs(segment.heading) <= std::numbers::pi);
+		CHECK(segment.weather_station >= 1.0);
+		CHECK(segment.weather_station <= 23.0);
+		CHECK_THAT(segment.gravity, WithinAbs(9.78, 0.01));
+		if (index > 0) {
+			// The route is continuous
+			CHECK(segment.coordinate_start.latitude == route.segments[index - 1].coordinate_end.latitude);
+			CHECK(segment.coordinate_start.longitude == route.segments[index - 1].coordinate_end.longitude);
+		}
+	}
+	CHECK(route.weather_stations.front().latitude == route.segments.front().coordinate_start.latitude);
+
+	SECTION("Route reads the route file back") {
+		const std::string route_file = temporary_path("minisim-synthetic-route.csv");
+		synthetic::write_route(route_file, route.segments);
+		const Route read(route_file, WeatherStations(route.weather_stations));
+		std::filesystem::remove(route_file);
+		REQUIRE(read.get_num_segments() == route.segments.size());
+		// The CSV parser rounds differently from std::from_chars in the last bits
+		for (std::size_t index = 0; index < route.segments.size(); ++index) {
+			const RouteSegment segment = read.get_segment(index);
+			const RouteSegment& expected = route.segments[index];
+			CHECK(segment.end_condition == expected.end_condition);
+			CHECK(segment.type == expected.type);
+			CHECK_THAT(segment.speed_limit, WithinAbs(expected.speed_limit, 1e-12));
+			CHECK_THAT(segment.coordinate_end.latitude, WithinAbs(expected.coordinate_end.latitude, 1e-12));
+			CHECK_THAT(segment.coordinate_end.longitude, WithinAbs(expected.coordinate_end.longitude, 1e-12));
+			CHECK_THAT(segment.weather_station, WithinAbs(expected.weather_station, 1e-12));
+			CHECK_THAT(segment.distance, WithinAbs(expected.distance, 1e-12));
+			CHECK_THAT(segment.heading, WithinAbs(expected.heading, 1e-12));
+			CHECK_THAT(segment.grade, WithinAbs(expected.grade, 1e-12));
+			CHECK_THAT(segment.gravity_times_sine_road_incline_angle,
+				WithinAbs(expected.gravity_times_sine_road_incline_angle, 1e-12));
+		}
+	}
+
+	SECTION("long routes stay on the continent") {
+		const synthetic::GeneratedRoute long_route =
+			synthetic::generate_route({.seed = 2, .num_segments = 100000, .num_weather_stations = 400});
+		REQUIRE(long_route.weather_stations.size() == 400);
+		for (const RouteSegment& segment : long_route.segments) {
+			REQUIRE(segment.coordinate_end.latitude < -11.0);
+			REQUIRE(segment.coordinate_end.latitude > -36.5);
+		}
+	}
+
+	CHECK_THROWS_AS(synthetic::generate_route({.num_segments = 0}), std::invalid_argument);
+	CHECK_THROWS_AS(synthetic::generate_route({.num_weather_stations = 0}), std::invalid_argument);
+}
+
+TEST_CASE("SyntheticInputs: weather", "[SyntheticInputs]") {
+	const synthetic::GeneratedRoute route = synthetic::generate_route({.num_segments = 1000});
+	const std::vector<WeatherForecastRow> rows = synthetic::generate_weather(route.weather_stations, three_days());
+	REQUIRE(rows.size() == 23 * (3 * 24 + 1));
+
+	for (const WeatherForecastRow& row : rows) {
+		CHECK(row.values[CO_GHI] >= 0.0);
+		CHECK(row.values[CO_GHI] < 1100.0);
+		CHECK(row.values[CO_DHI] <= row.values[CO_GHI]);
+		CHECK(row.values[CO_DNI] >= 0.0);
+		CHECK(row.values[CO_AIR_DENSITY] > 1.0);
+		CHECK(row.values[CO_AIR_DENSITY] < 1.3);
+		// Solar time in Darwin is about 8.7 h ahead of UTC: night from 10:00 to 19:00 UTC, noon near 03:00
+		const double utc_hour = std::fmod(row.time, DAY) / HOUR;
+		if (row.weather_station == 1.0 && utc_hour >= 10.0 && utc_hour <= 19.0) {
+			CHECK(row.values[CO_GHI] == 0.0);
+		}
+		if (row.weather_station == 1.0 && utc_hour == 3.0) {
+			CHECK(row.values[CO_GHI] > 500.0);
+		}
+	}
+
+	SECTION("Weather reads the weather file back") {
+		const std::string weather_file = temporary_path("minisim-synthetic-weather.csv");
+		const std::string stations_file = temporary_path("minisim-synthetic-stations.csv");
+		synthetic::write_weather(weather_file, route.weather_stations, three_days());
+		synthetic::write_weather_stations(stations_file, route.weather_stations);
+		const WeatherStations stations(stations_file);
+		const Weather weather(weather_file, stations, WeatherTimeWindow());
+		std::filesystem::remove(weather_file);
+		std::filesystem::remove(stations_file);
+
+		REQUIRE(stations.size() == route.weather_stations.size());
+		CHECK_THAT(stations[5].latitude, WithinAbs(route.weather_stations[5].latitude, 1e-12));
+		for (const WeatherForecastRow& row : rows) {
+			const WeatherDataPoint point = weather.get_weather_at(row.weather_station, row.time);
+			CHECK_THAT(point.irradiance, WithinAbs(row.values[CO_GHI], 1e-6));
+			CHECK_THAT(point.air_temp, WithinAbs(row.values[CO_AIR_TEMPERATURE_2M], 1e-9));
+			CHECK_THAT(point.air_density, WithinAbs(row.values[CO_AIR_DENSITY], 1e-9));
+		}
+	}
+
+	CHECK_THROWS_AS(synthetic::generate_weather(route.weather_stations, {.start_time = 1.0, .end_time = 0.0}),
+		std::invalid_argument);
+	CHECK_THROWS_AS(
+		synthetic::generate_weather(route.weather_stations, {.end_time = 1.0, .period = 0.0}), std::invalid_argument);
+}
+
+TEST_CASE("SyntheticInputs: the seed decides the files", "[SyntheticInputs]") {
+	const auto write_files = [](std::uint64_t seed, const std::string& name) {
+		const synthetic::GeneratedRoute route = synthetic::generate_route({.seed = seed, .num_segments = 500});
+		const std::string route_file = temporary_path(name + "-route.csv");
+		const std::string weather_file = temporary_path(name + "-weather.csv");
+		synthetic::write_route(route_file, route.segments);
+		synthetic::write_weather(weather_file, route.weather_stations, three_days(seed));
+		std::string contents = read_file(route_file) + read_file(weather_file);
+		std::filesystem::remove(route_file);
+		std::filesystem::remove(weather_file);
+		return contents;
+	};
+
+	const std::string first = write_files(7, "minisim-synthetic-a");
+	CHECK(first == write_files(7, "minisim-synthetic-b"));
+	CHECK(first != write_files(8, "minisim-synthetic-c"));
+}
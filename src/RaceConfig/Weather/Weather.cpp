@@ -1,44 +1,376 @@
 #include "Weather.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
 #include <exception>
 #include <filesystem>
 #include <fstream>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <set>
 #include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "RaceConfig/RaceConfigConstants.h"
+#include "RaceConfig/RaceSchedule/RaceSchedule.h"
+#include "Tools/FileTools.h"
+#include "Tools/Metrics.h"
 #include "Tools/TimeTools.h"
+#include "Tools/Trace.h"
 #include "alglib/ap.h"
 #include "alglib/interpolation.h"
 #include "csv/csv.h"
 
 using namespace race_config::weather;
 
-Weather::Weather(std::string_view weather_file, const WeatherStations& weather_stations)
-	: Weather(std::array<const std::string, 1>{std::string(weather_file.data())}, weather_stations) {}
+namespace {
+	/// the weather variables a WeatherDataPoint is made of
+	constexpr std::array<int, 6> DATA_POINT_VARIABLES = {
+		CO_GHI, CO_WIND_VELOCITY_NS, CO_WIND_VELOCITY_EW, CO_AIR_TEMPERATURE_2M, CO_SURFACE_PRESSURE, CO_AIR_DENSITY};
+
+	WeatherDataPoint make_data_point(const std::array<double, NUM_WEATHER_VARIABLES>& variables) {
+		constexpr double reciprocal_speed_of_sound = 0.0029154519;
+		return {
+			.wind = VelocityVector::from_cartesian_components(
+				variables[CO_WIND_VELOCITY_NS], variables[CO_WIND_VELOCITY_EW]),
+			.irradiance = variables[CO_GHI],
+			.air_temp = variables[CO_AIR_TEMPERATURE_2M],
+			.pressure = variables[CO_SURFACE_PRESSURE],
+			.air_density = variables[CO_AIR_DENSITY],
+			.reciprocal_speed_of_sound = reciprocal_speed_of_sound,
+		};
+	}
+
+	std::vector<WeatherForecastRow> read_forecast_rows(const std::string& file) {
+		io::CSVReader<WEATHER_FILE_NUMBER_OF_COLUMNS> csv(file);
+		csv.read_header(io::ignore_extra_column,
+			CN_WEATHER_STATION.data(),
+			CN_UNIX_PERIOD.data(),
+			CN_DHI.data(),
+			CN_DNI.data(),
+			CN_GHI.data(),
+			CN_WIND_VELOCITY_NS.data(),
+			CN_WIND_VELOCITY_EW.data(),
+			CN_AIR_TEMPERATURE_2M.data(),
+			CN_SURFACE_PRESSURE.data(),
+			CN_AIR_DENSITY.data()
+		);
+
+		std::vector<WeatherForecastRow> rows;
+		WeatherForecastRow row = {};
+		while (csv.read_row(row.weather_station,
+			row.time,
+			row.values[CO_DHI],
+			row.values[CO_DNI],
+			row.values[CO_GHI],
+			row.values[CO_WIND_VELOCITY_NS],
+			row.values[CO_WIND_VELOCITY_EW],
+			row.values[CO_AIR_TEMPERATURE_2M],
+			row.values[CO_SURFACE_PRESSURE],
+			row.values[CO_AIR_DENSITY]
+			)) {
+			rows.push_back(row);
+		}
+		return rows;
+	}
+
+	/// @brief Reads a weather file, parsing only the columns of the given variables and the rows inside a time window.
+	///
+	/// Like the full reader, this expects the rows grouped by weather station (in increasing order), each group
+	/// holding the same increasing times. The grid times just outside of the window are kept as well, so the weather
+	/// inside of it interpolates exactly as with the whole file.
+	WeatherGrid read_weather_file_columns(
+		const std::string& file, WeatherVariables variables, const WeatherTimeWindow& window) {
+		const auto split = [](char* line, std::vector<std::string_view>& fields) {
+			fields.clear();
+			std::string_view rest(line);
+			while (true) {
+				const size_t comma = rest.find(',');
+				std::string_view field = rest.substr(0, comma);
+				while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) {
+					field.remove_prefix(1);
+				}
+				while (!field.empty() && (field.back() == ' ' || field.back() == '\t' || field.back() == '\r')) {
+					field.remove_suffix(1);
+				}
+				fields.push_back(field);
+				if (comma == std::string_view::npos) {
+					return;
+				}
+				rest.remove_prefix(comma + 1);
+			}
+		};
+		const auto parse = [&file](std::string_view field) {
+			double value = 0.0;
+			const auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+			if (error != std::errc() || end != field.data() + field.size()) {
+				throw std::invalid_argument("weather file " + file + " has a malformed value: " + std::string(field));
+			}
+			return value;
+		};
+
+		io::LineReader lines(file);
+		std::vector<std::string_view> fields;
+		char* header = lines.next_line();
+		if (header == nullptr) {
+			throw std::invalid_argument("weather file " + file + " is empty");
+		}
+		split(header, fields);
+		const auto column_of = [&](std::string_view name) {
+			const auto column = std::find(fields.begin(), fields.end(), name);
+			if (column == fields.end()) {
+				throw std::invalid_argument("weather file " + file + " has no column " + std::string(name));
+			}
+			return static_cast<size_t>(std::distance(fields.begin(), column));
+		};
+
+		constexpr std::array<std::string_view, NUM_WEATHER_VARIABLES> variable_names = {CN_DHI, CN_DNI, CN_GHI,
+			CN_WIND_VELOCITY_NS, CN_WIND_VELOCITY_EW, CN_AIR_TEMPERATURE_2M, CN_SURFACE_PRESSURE, CN_AIR_DENSITY};
+		const size_t station_column = column_of(CN_WEATHER_STATION);
+		const size_t time_column = column_of(CN_UNIX_PERIOD);
+		std::vector<std::pair<size_t, std::vector<double>>> variable_columns;
+		for (size_t variable = 0; variable < variable_names.size(); ++variable) {
+			if (variables.test(variable)) {
+				variable_columns.emplace_back(column_of(variable_names[variable]), std::vector<double>());
+			}
+		}
+		const size_t num_columns = fields.size();
+
+		std::vector<double> times;
+		std::vector<double> stations;
+		// the row within the rows of the current weather station
+		size_t station_row = 0;
+		const auto different_times = [&file]() {
+			return std::invalid_argument("weather file " + file + " has weather stations with different times");
+		};
+
+		// Every row of the first weather station is parsed; its times decide which rows of the others are kept
+		size_t first_kept = 0;
+		size_t last_kept = 0;
+		const auto keep_window = [&]() {
+			const auto first_after_start = std::upper_bound(times.begin(), times.end(), window.start_time);
+			first_kept = first_after_start == times.begin()
+							 ? 0
+							 : static_cast<size_t>(std::distance(times.begin(), first_after_start)) - 1;
+			const auto first_at_end = std::lower_bound(times.begin(), times.end(), window.end_time);
+			last_kept = first_at_end == times.end() ? times.size() - 1
+													: static_cast<size_t>(std::distance(times.begin(), first_at_end));
+			// a grid needs two times, also when the window lies entirely before or after the file
+			if (last_kept == first_kept) {
+				if (last_kept + 1 < times.size()) {
+					++last_kept;
+				} else if (first_kept > 0) {
+					--first_kept;
+				}
+			}
+			for (auto& [column, values] : variable_columns) {
+				values.erase(values.begin() + static_cast<std::ptrdiff_t>(last_kept) + 1, values.end());
+				values.erase(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(first_kept));
+			}
+		};
 
-Weather::Weather(std::span<const std::string> weather_files, const WeatherStations& weather_stations)
-	: num_weather_groups(weather_stations.size()) {
+		while (char* line = lines.next_line()) {
+			split(line, fields);
+			if (fields.size() == 1 && fields.front().empty()) {
+				continue;
+			}
+			if (fields.size() != num_columns) {
+				throw std::invalid_argument("weather file " + file + " has a row with the wrong number of columns");
+			}
+
+			const double station = parse(fields[station_column]);
+			const double time = parse(fields[time_column]);
+			if (stations.empty() || station != stations.back()) {
+				if (!stations.empty() && station_row != times.size()) {
+					throw different_times();
+				}
+				if (stations.size() == 1) {
+					keep_window();
+				}
+				stations.push_back(station);
+				station_row = 0;
+			}
+			if (stations.size() == 1) {
+				times.push_back(time);
+			} else if (station_row >= times.size() || times[station_row] != time) {
+				throw different_times();
+			}
+			if (stations.size() == 1 || (station_row >= first_kept && station_row <= last_kept)) {
+				for (auto& [column, values] : variable_columns) {
+					values.push_back(parse(fields[column]));
+				}
+			}
+			++station_row;
+		}
+		if (stations.empty() || station_row != times.size()) {
+			throw different_times();
+		}
+		if (stations.size() == 1) {
+			keep_window();
+		}
+		times.erase(times.begin() + static_cast<std::ptrdiff_t>(last_kept) + 1, times.end());
+		times.erase(times.begin(), times.begin() + static_cast<std::ptrdiff_t>(first_kept));
+
+		// The rows are grouped by station, so each column already is a [station][time] plane
+		std::vector<double> values;
+		values.reserve(stations.size() * times.size() * variable_columns.size());
+		for (const auto& [column, column_values] : variable_columns) {
+			values.insert(values.end(), column_values.begin(), column_values.end());
+		}
+		return WeatherGrid::from_columns(std::move(times), std::move(stations), variables, std::move(values));
+	}
+
+	/// One query of Weather::get_weather_batch(), remembering where its result goes
+	struct BatchQuery {
+		double time;
+		double weather_station;
+		size_t index;
+	};
+
+	/// The buffers Weather::get_weather_batch() needs to sort queries, kept per thread so they are allocated once
+	struct BatchScratch {
+		std::vector<BatchQuery> queries;
+		std::vector<double> sorted_times;
+		std::vector<double> sorted_stations;
+		std::vector<double> sorted_values;
+	};
+
+	/// The number of snapshots each thread remembers, enough for a few Weathers queried in turn
+	constexpr size_t SNAPSHOT_CACHE_SIZE = 8;
+
+	/// How many Weathers were destroyed so far, so each thread knows when to release the snapshots of those it cached
+	std::atomic<uint64_t> num_destroyed_weathers = 0;
+
+	/// What Weather::write_shared() puts in front of the weather grids, followed by the path of the weather file
+	/// (padded to 8 bytes)
+	struct SharedWeatherHeader {
+		std::array<char, 8> magic;
+		std::uint64_t format_version;
+		std::uint64_t num_grids;
+		std::int64_t num_weather_groups;
+		std::uint64_t variables;
+		std::uint64_t storage;
+		std::int64_t modification_time;
+		double window_start_time;
+		double window_end_time;
+		std::uint64_t weather_file_size;
+	};
+
+	constexpr std::array<char, 8> SHARED_WEATHER_MAGIC = {'M', 'S', 'W', 'E', 'A', 'T', 'H', 'R'};
+	/// bump whenever SharedWeatherHeader or WeatherGrid::write() change
+	constexpr std::uint64_t SHARED_WEATHER_FORMAT_VERSION = 3;
+	/// the grids after the header start 8 byte aligned
+	constexpr size_t SHARED_WEATHER_ALIGNMENT = 8;
+
+	size_t padded_to_alignment(size_t size) {
+		return (size + SHARED_WEATHER_ALIGNMENT - 1) / SHARED_WEATHER_ALIGNMENT * SHARED_WEATHER_ALIGNMENT;
+	}
+}  // namespace
+
+Weather::Weather() : snapshot(std::make_shared<const Snapshot>()) {}
+
+WeatherTimeWindow WeatherTimeWindow::from_schedule(const RaceSchedule& schedule, double margin) {
+	WeatherTimeWindow window = {
+		.start_time = std::numeric_limits<double>::infinity(),
+		.end_time = -std::numeric_limits<double>::infinity(),
+	};
+	for (size_t day = 0; day < schedule.size(); ++day) {
+		window.start_time =
+			std::min({window.start_time, schedule[day].morning_charging_start_time, schedule[day].race_start_time});
+		window.end_time =
+			std::max({window.end_time, schedule[day].race_end_time, schedule[day].evening_charging_end_time});
+	}
+	window.start_time -= margin;
+	window.end_time += margin;
+	return window;
+}
+
+WeatherTimeWindow WeatherTimeWindow::from_schedules(std::span<const RaceSchedule* const> schedules, double margin) {
+	if (schedules.empty()) {
+		return {};
+	}
+	WeatherTimeWindow window = from_schedule(*schedules.front(), margin);
+	for (const RaceSchedule* schedule : schedules.subspan(1)) {
+		window = window.covering(from_schedule(*schedule, margin));
+	}
+	return window;
+}
+
+WeatherTimeWindow WeatherTimeWindow::covering(const WeatherTimeWindow& other) const {
+	return {
+		.start_time = std::min(start_time, other.start_time),
+		.end_time = std::max(end_time, other.end_time),
+	};
+}
+
+bool WeatherTimeWindow::is_unbounded() const {
+	return start_time == -std::numeric_limits<double>::infinity() &&
+		   end_time == std::numeric_limits<double>::infinity();
+}
+
+WeatherSource WeatherSource::of(const std::string& weather_file, const WeatherTimeWindow& window) {
+	return {
+		.weather_file = std::filesystem::canonical(weather_file).string(),
+		.modification_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::filesystem::last_write_time(weather_file).time_since_epoch())
+								 .count(),
+		.window = window,
+	};
+}
+
+Weather::Weather(std::string_view weather_file, const WeatherStations& weather_stations, WeatherVariables variables)
+	: Weather(weather_file, weather_stations, WeatherTimeWindow{}, variables) {}
+
+Weather::Weather(
+	std::span<const std::string> weather_files, const WeatherStations& weather_stations, WeatherVariables variables)
+	: Weather(weather_files, weather_stations, WeatherTimeWindow{}, variables) {}
+
+Weather::Weather(std::string_view weather_file, const WeatherStations& weather_stations,
+	const WeatherTimeWindow& window, WeatherVariables variables, WeatherStorage storage)
+	: Weather(std::array<const std::string, 1>{std::string(weather_file.data())}, weather_stations, window, variables,
+		  storage) {}
+
+Weather::Weather(std::span<const std::string> weather_files, const WeatherStations& weather_stations,
+	const WeatherTimeWindow& window, WeatherVariables variables, WeatherStorage storage)
+	: num_weather_groups(weather_stations.size()), variables(variables), storage(storage) {
+	if (!(window.start_time <= window.end_time)) {
+		throw std::invalid_argument("weather time window ends before it starts");
+	}
+	MINISIM_TIME_SCOPE("weather.load");
+	MINISIM_TRACE_SCOPE("weather.load");
+	std::vector<std::shared_ptr<const WeatherGrid>> weather_grids;
+	// Each grid is quantized as soon as it is read, so only one full precision grid is held at a time
+	const auto add_grid = [&](WeatherGrid weather_grid) {
+		weather_grids.push_back(std::make_shared<const WeatherGrid>(
+			storage == WeatherStorage::QUANTIZED ? weather_grid.quantized() : std::move(weather_grid)));
+	};
 	for (const auto& file : weather_files) {
+		// Streaming only the projected columns and windowed rows is faster than even reading the .cache (which holds
+		// all of the file), so partial loads neither read nor write it
+		if (variables != ALL_WEATHER_VARIABLES || !window.is_unbounded()) {
+			add_grid(read_weather_file_columns(file, variables, window));
+			continue;
+		}
+
 		std::string cache_location = file + ".cache";
 
 		 
 		if (std::filesystem::exists(cache_location)) {
-			 
-			SplineAndStartTime spline_and_start_time;
-
+			alglib::spline2dinterpolant weather_spline;
 			std::fstream cache_file(cache_location);
-			alglib::spline2dunserialize(cache_file, spline_and_start_time.weather_spline);
-
-			std::fstream start_time_file(file);
-			 
-			std::string line;
-			std::getline(start_time_file, line);
-			char junk;
-			start_time_file >> spline_and_start_time.start_time >> junk >> spline_and_start_time.start_time;
-			weather_splines.push_back(std::move(spline_and_start_time));
+			alglib::spline2dunserialize(cache_file, weather_spline);
+			add_grid(WeatherGrid::from_spline(weather_spline));
 			continue;
 		}
 
@@ -123,70 +455,500 @@ Weather::Weather(std::span<const std::string> weather_files, const WeatherStatio
 			function_values_array[i * spline_vector_dim + CO_AIR_DENSITY] = air_density_vec[i];        
 		}
 
-		SplineAndStartTime spline_and_start_time{
-			.start_time = time_vec[0],
-			.weather_spline = {},
-		};
+		alglib::spline2dinterpolant weather_spline;
 
 		try {
 			alglib::spline2dbuildbilinearv(abscissas_array, abscissas_dim, ordinates_array, num_weather_groups,
-				function_values_array, spline_vector_dim, spline_and_start_time.weather_spline);
+				function_values_array, spline_vector_dim, weather_spline);
 		} catch (alglib::ap_error& error) {
 			throw std::exception();
 		}
 
 		 
 		std::fstream cache_file(cache_location, std::ios::out);
-		alglib::spline2dserialize(spline_and_start_time.weather_spline, cache_file);
+		alglib::spline2dserialize(weather_spline, cache_file);
+
+		add_grid(WeatherGrid::from_spline(weather_spline));
+	}
+
+	std::sort(weather_grids.begin(), weather_grids.end(),
+		[](const std::shared_ptr<const WeatherGrid>& lhs, const std::shared_ptr<const WeatherGrid>& rhs) {
+			return lhs->get_start_time() < rhs->get_start_time();
+		});
 
-		alglib::spline2dbuildbilinearv(abscissas_array, abscissas_dim, ordinates_array, num_weather_groups,
-			function_values_array, spline_vector_dim, spline_and_start_time.weather_spline);
+	auto initial_snapshot = std::make_shared<Snapshot>();
+	initial_snapshot->weather_grids = std::move(weather_grids);
+	snapshot = std::move(initial_snapshot);
+}
 
-		weather_splines.push_back(std::move(spline_and_start_time));
+Weather::~Weather() {
+	// the lifetime expires first, so a thread that sees the new count also sees it expired
+	lifetime.reset();
+	num_destroyed_weathers.fetch_add(1, std::memory_order_release);
+}
+
+Weather::Weather(const Weather& other)
+	: snapshot(other.get_snapshot()),
+	  num_weather_groups(other.num_weather_groups),
+	  variables(other.variables),
+	  storage(other.storage) {}
+
+Weather& Weather::operator=(const Weather& other) {
+	if (this != &other) {
+		const std::lock_guard<std::mutex> lock(update_mutex);
+		publish(other.get_snapshot());
+		num_weather_groups = other.num_weather_groups;
+		variables = other.variables;
+		storage = other.storage;
 	}
+	return *this;
+}
 
-	std::sort(weather_splines.begin(), weather_splines.end(),
-		[](const SplineAndStartTime& lhs, const SplineAndStartTime& rhs) { return lhs.start_time < rhs.start_time; });
+std::shared_ptr<const Weather::Snapshot> Weather::get_snapshot() const {
+	const std::lock_guard<std::mutex> lock(snapshot_mutex);
+	return snapshot;
 }
 
-WeatherDataPoint Weather::get_weather_at(double weather_station, double time) const {
-	 
-	auto weather_spline = std::upper_bound(weather_splines.begin(), weather_splines.end(), time,
-		[](double time, const SplineAndStartTime& spline_and_start_time) {
-			return time < spline_and_start_time.start_time;
+class Weather::QuerySnapshot {
+   public:
+	/// Pins a snapshot of the per-thread cache
+	QuerySnapshot(const Snapshot& snapshot, size_t& pins) : snapshot(&snapshot), pins(&pins) {
+		++pins;
+	}
+	/// Holds a snapshot of its own, when every snapshot of the cache is pinned
+	explicit QuerySnapshot(std::shared_ptr<const Snapshot> owned) : snapshot(owned.get()), owned(std::move(owned)) {}
+	QuerySnapshot(const QuerySnapshot&) = delete;
+	QuerySnapshot& operator=(const QuerySnapshot&) = delete;
+	~QuerySnapshot() {
+		if (pins != nullptr) {
+			--*pins;
+		}
+	}
+
+	const Snapshot& operator*() const {
+		return *snapshot;
+	}
+	const Snapshot* operator->() const {
+		return snapshot;
+	}
+
+   private:
+	const Snapshot* snapshot;
+	size_t* pins = nullptr;
+	std::shared_ptr<const Snapshot> owned;
+};
+
+Weather::QuerySnapshot Weather::get_query_snapshot() const {
+	struct CachedSnapshot {
+		uint64_t generation = 0;
+		std::shared_ptr<const Snapshot> snapshot;
+		/// expires with the Weather the snapshot belongs to
+		std::weak_ptr<const void> owner;
+		/// how many queries of this thread are reading the snapshot
+		size_t pins = 0;
+	};
+	thread_local std::array<CachedSnapshot, SNAPSHOT_CACHE_SIZE> cache;
+	thread_local size_t next_slot = 0;
+	thread_local uint64_t seen_destroyed_weathers = 0;
+
+	// The snapshots of destroyed Weathers can never be asked for again, so they are released instead of pinning their
+	// weather data until they are evicted
+	const uint64_t destroyed_weathers = num_destroyed_weathers.load(std::memory_order_acquire);
+	if (destroyed_weathers != seen_destroyed_weathers) {
+		seen_destroyed_weathers = destroyed_weathers;
+		for (auto& cached : cache) {
+			if (cached.pins == 0 && cached.owner.expired()) {
+				cached = {};
+			}
+		}
+	}
+
+	const uint64_t current_generation = generation.load(std::memory_order_acquire);
+	for (auto& cached : cache) {
+		if (cached.generation == current_generation) {
+			return QuerySnapshot(*cached.snapshot, cached.pins);
+		}
+	}
+
+	// Snapshots that queries of this thread are still reading are never evicted
+	for (size_t attempt = 0; attempt < cache.size(); ++attempt) {
+		CachedSnapshot& slot = cache[next_slot];
+		next_slot = (next_slot + 1) % cache.size();
+		if (slot.pins != 0) {
+			continue;
+		}
+		// the evicted snapshot is released outside of the lock
+		const std::shared_ptr<const Snapshot> evicted = std::move(slot.snapshot);
+		{
+			// the generation is read again under the lock, so it is the one of the snapshot being copied
+			const std::lock_guard<std::mutex> lock(snapshot_mutex);
+			slot.generation = generation.load(std::memory_order_relaxed);
+			slot.snapshot = snapshot;
+		}
+		slot.owner = lifetime;
+		return QuerySnapshot(*slot.snapshot, slot.pins);
+	}
+	return QuerySnapshot(get_snapshot());
+}
+
+void Weather::publish(std::shared_ptr<const Snapshot> next) {
+	const std::lock_guard<std::mutex> lock(snapshot_mutex);
+	snapshot.swap(next);
+	generation.store(next_generation(), std::memory_order_release);
+}
+
+uint64_t Weather::next_generation() {
+	static std::atomic<uint64_t> last_generation = 0;
+	return last_generation.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+size_t Weather::Snapshot::grid_index_at(double time) const {
+	auto weather_grid = std::upper_bound(weather_grids.begin(), weather_grids.end(), time,
+		[](double time, const std::shared_ptr<const WeatherGrid>& weather_grid) {
+			return time < weather_grid->get_start_time();
 		});
 
-	if (weather_spline == weather_splines.begin()) {
+	if (weather_grid == weather_grids.begin()) {
 		throw std::exception();
 	}
-	weather_spline = std::prev(weather_spline);
+	return static_cast<size_t>(std::distance(weather_grids.begin(), weather_grid)) - 1;
+}
+
+const WeatherGrid& Weather::Snapshot::grid_at(double time) const {
+	return *weather_grids[grid_index_at(time)];
+}
+
+WeatherDataPoint Weather::get_weather_in(const WeatherGrid& weather_grid, const WeatherGrid::Cell& cell) {
+	std::array<double, NUM_WEATHER_VARIABLES> variables = {};
+	for (const int variable : DATA_POINT_VARIABLES) {
+		variables[static_cast<size_t>(variable)] = weather_grid.has_variable(variable)
+													   ? weather_grid.interpolate(variable, cell)
+													   : std::numeric_limits<double>::quiet_NaN();
+	}
+	return make_data_point(variables);
+}
+
+WeatherDataPoint Weather::get_mean_weather(
+	const Snapshot& snapshot, double weather_station, double start_time, double end_time) {
+	if (start_time == end_time) {
+		const WeatherGrid& weather_grid = snapshot.grid_at(start_time);
+		return get_weather_in(weather_grid, weather_grid.locate(start_time, weather_station));
+	}
+	if (end_time < start_time) {
+		std::swap(start_time, end_time);
+	}
 
-	const alglib::spline2dinterpolant& weather_spline_interpolant = weather_spline->weather_spline;
+	// Integrate piece by piece over the weather files the interval touches
+	std::array<double, NUM_WEATHER_VARIABLES> variables = {};
+	size_t grid_index = snapshot.grid_index_at(start_time);
+	double piece_start = start_time;
+	while (true) {
+		const WeatherGrid& weather_grid = *snapshot.weather_grids[grid_index];
+		const bool last_piece = grid_index + 1 == snapshot.weather_grids.size() ||
+								end_time <= snapshot.weather_grids[grid_index + 1]->get_start_time();
+		const double piece_end = last_piece ? end_time : snapshot.weather_grids[grid_index + 1]->get_start_time();
+
+		const WeatherGrid::Cell start_cell = weather_grid.locate(piece_start, weather_station);
+		const WeatherGrid::Cell end_cell = weather_grid.locate(piece_end, weather_station, start_cell);
+		for (const int variable : DATA_POINT_VARIABLES) {
+			variables[static_cast<size_t>(variable)] += weather_grid.has_variable(variable)
+															? weather_grid.antiderivative(variable, end_cell) -
+																  weather_grid.antiderivative(variable, start_cell)
+															: std::numeric_limits<double>::quiet_NaN();
+		}
 
-	alglib::real_1d_array weather_data;
-	alglib::spline2dcalcv(weather_spline_interpolant, time, weather_station, weather_data);
+		if (last_piece) {
+			break;
+		}
+		piece_start = piece_end;
+		++grid_index;
+	}
 
-	const double ghi = weather_data[CO_GHI];
-	const double wind_ns = weather_data[CO_WIND_VELOCITY_NS];
-	const double wind_ew = weather_data[CO_WIND_VELOCITY_EW];
-	const double air_temp = weather_data[CO_AIR_TEMPERATURE_2M];
-	const double pressure = weather_data[CO_SURFACE_PRESSURE];
-	const double air_density = weather_data[CO_AIR_DENSITY];
-	constexpr double reciprocal_speed_of_sound = 0.0029154519;  
+	for (double& variable : variables) {
+		variable /= end_time - start_time;
+	}
+	return make_data_point(variables);
+}
 
+WeatherDataPoint Weather::get_weather_at(double weather_station, double time) const {
+	MINISIM_COUNT("weather.get_weather_at");
+	const QuerySnapshot current = get_query_snapshot();
+	const WeatherGrid& weather_grid = current->grid_at(time);
+	return get_weather_in(weather_grid, weather_grid.locate(time, weather_station));
+}
 
-	return {
-		.wind = VelocityVector::from_cartesian_components(wind_ns, wind_ew),
-		.irradiance = ghi,
-		.air_temp = air_temp,
-		.pressure = pressure,
-		.air_density = air_density,
-		.reciprocal_speed_of_sound = reciprocal_speed_of_sound,
-	};
+double Weather::get_variable_at(int variable, double weather_station, double time) const {
+	if (variable < 0 || variable >= NUM_WEATHER_VARIABLES || !variables.test(static_cast<size_t>(variable))) {
+		throw std::invalid_argument("weather variable " + std::to_string(variable) + " was not loaded");
+	}
+	const QuerySnapshot current = get_query_snapshot();
+	const WeatherGrid& weather_grid = current->grid_at(time);
+	return weather_grid.interpolate(variable, weather_grid.locate(time, weather_station));
 }
 
-WeatherDataPoint Weather::get_weather_during(double weather_station, double start_time, double end_time) const {
-	const WeatherDataPoint start_data = get_weather_at(weather_station, start_time);
-	const WeatherDataPoint end_data = get_weather_at(weather_station, end_time);
+WeatherDataPoint Weather::get_weather_during(
+	double weather_station, double start_time, double end_time, WeatherAveraging averaging) const {
+	const QuerySnapshot current = get_query_snapshot();
+	if (averaging == WeatherAveraging::EXACT) {
+		return get_mean_weather(*current, weather_station, start_time, end_time);
+	}
+	// Both ends are read from the same version of the weather data
+	const WeatherGrid& start_grid = current->grid_at(start_time);
+	const WeatherGrid& end_grid = current->grid_at(end_time);
+	const WeatherDataPoint start_data = get_weather_in(start_grid, start_grid.locate(start_time, weather_station));
+	const WeatherDataPoint end_data = get_weather_in(end_grid, end_grid.locate(end_time, weather_station));
 	return WeatherDataPoint::average(start_data, end_data);
 }
+
+void Weather::get_weather_batch(
+	std::span<const double> weather_stations, std::span<const double> times, WeatherBatchOut& out) const {
+	if (weather_stations.size() != times.size()) {
+		throw std::invalid_argument("weather batch needs exactly one weather station per time");
+	}
+	const size_t count = times.size();
+	out.variables = variables;
+	for (size_t variable = 0; variable < out.values.size(); ++variable) {
+		out.values[variable].resize(variables.test(variable) ? count : 0);
+	}
+	const QuerySnapshot current = get_query_snapshot();
+
+	// Queries are sorted by time in chunks: that gives the grid walk its locality, while the results only have to be
+	// put back in order within a chunk that fits in cache
+	constexpr size_t chunk_size = 4096;
+	thread_local BatchScratch scratch;
+	auto& [queries, sorted_times, sorted_stations, sorted_values] = scratch;
+
+	for (size_t chunk_start = 0; chunk_start < count; chunk_start += chunk_size) {
+		const size_t chunk_count = std::min(chunk_size, count - chunk_start);
+		std::span<const double> query_times = times.subspan(chunk_start, chunk_count);
+		std::span<const double> query_stations = weather_stations.subspan(chunk_start, chunk_count);
+		std::array<double*, NUM_WEATHER_VARIABLES> destinations = {};
+
+		const bool in_order = std::is_sorted(query_times.begin(), query_times.end());
+		if (in_order) {
+			for (size_t variable = 0; variable < destinations.size(); ++variable) {
+				destinations[variable] = variables.test(variable) ? out.values[variable].data() + chunk_start : nullptr;
+			}
+		} else {
+			queries.resize(chunk_count);
+			for (size_t query = 0; query < chunk_count; ++query) {
+				queries[query] = {query_times[query], query_stations[query], query};
+			}
+			std::sort(queries.begin(), queries.end(), [](const BatchQuery& lhs, const BatchQuery& rhs) {
+				return lhs.time < rhs.time;
+			});
+
+			sorted_times.resize(chunk_count);
+			sorted_stations.resize(chunk_count);
+			for (size_t query = 0; query < chunk_count; ++query) {
+				sorted_times[query] = queries[query].time;
+				sorted_stations[query] = queries[query].weather_station;
+			}
+			query_times = sorted_times;
+			query_stations = sorted_stations;
+			sorted_values.resize(chunk_size * NUM_WEATHER_VARIABLES);
+			for (size_t variable = 0; variable < destinations.size(); ++variable) {
+				destinations[variable] = variables.test(variable) ? &sorted_values[variable * chunk_size] : nullptr;
+			}
+		}
+
+		// Each grid covers one run of the sorted queries
+		size_t begin = 0;
+		while (begin < chunk_count) {
+			const size_t grid_index = current->grid_index_at(query_times[begin]);
+			const double grid_end_time = grid_index + 1 < current->weather_grids.size()
+											 ? current->weather_grids[grid_index + 1]->get_start_time()
+											 : std::numeric_limits<double>::infinity();
+			const size_t end = static_cast<size_t>(std::distance(query_times.begin(),
+				std::lower_bound(query_times.begin() + static_cast<std::ptrdiff_t>(begin), query_times.end(), grid_end_time)));
+
+			std::array<double*, NUM_WEATHER_VARIABLES> run_destinations = destinations;
+			for (auto& destination : run_destinations) {
+				destination = destination != nullptr ? destination + begin : nullptr;
+			}
+			current->weather_grids[grid_index]->interpolate_batch(
+				query_times.subspan(begin, end - begin), query_stations.subspan(begin, end - begin), run_destinations);
+			begin = end;
+		}
+
+		if (!in_order) {
+			for (size_t variable = 0; variable < destinations.size(); ++variable) {
+				if (!variables.test(variable)) {
+					continue;
+				}
+				const double* sorted = destinations[variable];
+				double* values = out.values[variable].data() + chunk_start;
+				for (size_t query = 0; query < chunk_count; ++query) {
+					values[queries[query].index] = sorted[query];
+				}
+			}
+		}
+	}
+}
+
+uint64_t Weather::update(std::span<const WeatherForecastRow> forecast_rows) {
+	if (forecast_rows.empty()) {
+		return get_version();
+	}
+	const auto [first_row, last_row] = std::minmax_element(forecast_rows.begin(), forecast_rows.end(),
+		[](const WeatherForecastRow& lhs, const WeatherForecastRow& rhs) { return lhs.time < rhs.time; });
+	const double slab_start = first_row->time;
+	const double slab_end = last_row->time;
+
+	const std::lock_guard<std::mutex> lock(update_mutex);
+	const std::shared_ptr<const Snapshot> current = get_snapshot();
+
+	// Unchanged weather files are shared with the previous version, only the one the slab lands in is rebuilt
+	auto next = std::make_shared<Snapshot>(*current);
+	next->version = current->version + 1;
+
+	if (next->weather_grids.empty()) {
+		WeatherGrid weather_grid = WeatherGrid::from_rows(forecast_rows, variables);
+		num_weather_groups = static_cast<int>(weather_grid.get_stations().size());
+		next->weather_grids.push_back(std::make_shared<const WeatherGrid>(
+			storage == WeatherStorage::QUANTIZED ? weather_grid.quantized() : std::move(weather_grid)));
+	} else {
+		// The file the slab starts in, or the first one for a slab starting before every file
+		auto target = std::upper_bound(next->weather_grids.begin(), next->weather_grids.end(), slab_start,
+			[](double time, const std::shared_ptr<const WeatherGrid>& weather_grid) {
+				return time < weather_grid->get_start_time();
+			});
+		if (target != next->weather_grids.begin()) {
+			target = std::prev(target);
+		}
+		const auto following = std::next(target);
+		if (following != next->weather_grids.end() && slab_end >= (*following)->get_start_time()) {
+			throw std::invalid_argument("weather forecast slab crosses into the next weather file");
+		}
+		*target = std::make_shared<const WeatherGrid>((*target)->merged_with(forecast_rows));
+	}
+
+	const uint64_t version = next->version;
+	publish(std::move(next));
+	return version;
+}
+
+double Weather::get_max_quantization_error(int variable) const {
+	const std::shared_ptr<const Snapshot> current = get_snapshot();
+	double max_error = 0.0;
+	for (const auto& weather_grid : current->weather_grids) {
+		if (weather_grid->has_variable(variable)) {
+			max_error = std::max(max_error, weather_grid->max_quantization_error(variable));
+		}
+	}
+	return max_error;
+}
+
+uint64_t Weather::update(std::string_view forecast_file) {
+	const std::vector<WeatherForecastRow> rows = read_forecast_rows(std::string(forecast_file));
+	return update(rows);
+}
+
+uint64_t Weather::get_version() const {
+	return get_snapshot()->version;
+}
+
+void Weather::write_shared(const std::string& path, const WeatherSource& source) const {
+	const std::shared_ptr<const Snapshot> current = get_snapshot();
+	const SharedWeatherHeader header = {
+		.magic = SHARED_WEATHER_MAGIC,
+		.format_version = SHARED_WEATHER_FORMAT_VERSION,
+		.num_grids = current->weather_grids.size(),
+		.num_weather_groups = num_weather_groups,
+		.variables = variables.to_ullong(),
+		.storage = static_cast<std::uint64_t>(storage),
+		.modification_time = source.modification_time,
+		.window_start_time = source.window.start_time,
+		.window_end_time = source.window.end_time,
+		.weather_file_size = source.weather_file.size(),
+	};
+	const std::array<char, SHARED_WEATHER_ALIGNMENT> padding = {};
+
+	const std::string temporary_path = path + ".tmp." + std::to_string(getpid());
+	{
+		std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(source.weather_file.data(), static_cast<std::streamsize>(source.weather_file.size()));
+		out.write(padding.data(),
+			static_cast<std::streamsize>(padded_to_alignment(source.weather_file.size()) - source.weather_file.size()));
+		for (const auto& weather_grid : current->weather_grids) {
+			weather_grid->write(out);
+		}
+		if (!out) {
+			std::filesystem::remove(temporary_path);
+			throw std::runtime_error("could not write shared weather file " + path);
+		}
+	}
+	std::filesystem::rename(temporary_path, path);
+}
+
+Weather Weather::attach_shared(const std::string& path) {
+	WeatherSource source;
+	return attach_shared_file(path, source);
+}
+
+std::optional<Weather> Weather::attach_shared(const std::string& path, const WeatherSource& source) {
+	// A file that is missing, truncated or written by another version of minisim is as stale as one of another source
+	WeatherSource shared_source;
+	try {
+		Weather weather = attach_shared_file(path, shared_source);
+		if (shared_source != source) {
+			return std::nullopt;
+		}
+		return weather;
+	} catch (const std::invalid_argument&) {
+		return std::nullopt;
+	} catch (const std::runtime_error&) {
+		return std::nullopt;
+	}
+}
+
+Weather Weather::attach_shared_file(const std::string& path, WeatherSource& source) {
+	// Every grid keeps the mapping alive, so it outlives this Weather if copies of it do
+	const file_tools::MappedFile mapped = file_tools::map_file(path);
+	std::span<const std::byte> bytes = mapped.bytes;
+	SharedWeatherHeader header = {};
+	if (bytes.size() < sizeof(header)) {
+		throw std::invalid_argument("shared weather file is truncated: " + path);
+	}
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	bytes = bytes.subspan(sizeof(header));
+	if (header.magic != SHARED_WEATHER_MAGIC || header.format_version != SHARED_WEATHER_FORMAT_VERSION) {
+		throw std::invalid_argument("not a shared weather file of this version of minisim: " + path);
+	}
+	if (header.weather_file_size > bytes.size() || padded_to_alignment(header.weather_file_size) > bytes.size()) {
+		throw std::invalid_argument("shared weather file is truncated: " + path);
+	}
+	source = {
+		.weather_file = std::string(reinterpret_cast<const char*>(bytes.data()), header.weather_file_size),
+		.modification_time = header.modification_time,
+		.window = {.start_time = header.window_start_time, .end_time = header.window_end_time},
+	};
+	bytes = bytes.subspan(padded_to_alignment(header.weather_file_size));
+
+	// The header describes the grids; a file where they disagree would answer queries the reader did not ask for
+	const WeatherVariables variables(header.variables);
+	if (header.storage > static_cast<std::uint64_t>(WeatherStorage::QUANTIZED) ||
+		variables.to_ullong() != header.variables || variables.none()) {
+		throw std::invalid_argument("shared weather file has an invalid header: " + path);
+	}
+	const auto storage = static_cast<WeatherStorage>(header.storage);
+	auto attached = std::make_shared<Snapshot>();
+	for (std::uint64_t grid = 0; grid < header.num_grids; ++grid) {
+		auto weather_grid = std::make_shared<const WeatherGrid>(WeatherGrid::view(bytes, mapped.mapping));
+		if (weather_grid->is_quantized() != (storage == WeatherStorage::QUANTIZED) ||
+			weather_grid->get_variables() != variables ||
+			static_cast<std::int64_t>(weather_grid->get_stations().size()) != header.num_weather_groups) {
+			throw std::invalid_argument("shared weather file has a header that does not match its weather data: " +
+										path);
+		}
+		attached->weather_grids.push_back(std::move(weather_grid));
+	}
+
+	Weather weather;
+	weather.publish(std::move(attached));
+	weather.num_weather_groups = static_cast<int>(header.num_weather_groups);
+	weather.variables = variables;
+	weather.storage = storage;
+	return weather;
+}
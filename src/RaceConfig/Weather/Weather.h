@@ -1,7 +1,15 @@
 #ifndef MINISIM_WEATHER_H
 #define MINISIM_WEATHER_H
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -9,21 +17,137 @@
 #include "RaceConfig/WeatherStations/WeatherStations.h"
 #include "WeatherConstants.h"
 #include "WeatherDataPoint.h"
+#include "WeatherGrid.h"
 #include "alglib/interpolation.h"
 
+class RaceSchedule;
+class WeatherCursor;
+
+/// @brief A time range of weather data to load
+struct WeatherTimeWindow {
+	/// (seconds) the weather loaded around a schedule: a race never leaves its schedule, so its days and a day
+	/// around them are enough
+	static constexpr double SCHEDULE_MARGIN = 24.0 * 3600.0;
+
+	/// Units: Epoch Time
+	double start_time = -std::numeric_limits<double>::infinity();
+	/// Units: Epoch Time
+	double end_time = std::numeric_limits<double>::infinity();
+
+	/// @brief The window from the first morning charge to the last evening charge of a schedule
+	/// @param margin (seconds) how much to widen the window by on both sides
+	/// @return a window that ends before it starts if the schedule has no days
+	static WeatherTimeWindow from_schedule(const RaceSchedule& schedule, double margin = 0.0);
+
+	/// @brief The window covering every schedule, so several schedules can share one load
+	/// @param margin (seconds) how much to widen the window by on both sides
+	/// @return an unbounded window if there are no schedules
+	static WeatherTimeWindow from_schedules(
+		std::span<const RaceSchedule* const> schedules, double margin = SCHEDULE_MARGIN);
+
+	/// @brief The smallest window covering both windows, so several schedules can share one load
+	WeatherTimeWindow covering(const WeatherTimeWindow& other) const;
+
+	bool is_unbounded() const;
+
+	bool operator==(const WeatherTimeWindow& other) const = default;
+};
+
+/// @brief What weather data shared with Weather::write_shared() was loaded from, so a process only attaches to shared
+/// weather loaded from the same inputs as its own
+struct WeatherSource {
+	/// the weather file, as an absolute path
+	std::string weather_file;
+	/// when the weather file was last modified, in nanoseconds since the epoch of the file clock
+	std::int64_t modification_time = 0;
+	WeatherTimeWindow window;
+
+	/// @brief The source of a window of a weather file as the file is now
+	/// @throws std::filesystem::filesystem_error if the file does not exist
+	static WeatherSource of(const std::string& weather_file, const WeatherTimeWindow& window);
+
+	bool operator==(const WeatherSource& other) const = default;
+};
+
+/// @brief How Weather::get_weather_during() averages the weather over a time interval
+enum class WeatherAveraging : std::uint8_t {
+	/// the mean of the weather at the start and at the end of the interval
+	ENDPOINTS,
+	/// the exact mean of the interpolated weather over the whole interval
+	EXACT,
+};
+
+/// @brief The output of Weather::get_weather_batch(): every loaded weather variable in its own contiguous array
+struct WeatherBatchOut {
+	/// indexed by the race_config::weather::CO_* column order; element i of each array answers query i
+	std::array<std::vector<double>, race_config::weather::NUM_WEATHER_VARIABLES> values;
+	/// the variables that were filled in
+	WeatherVariables variables;
+
+	/// @throws std::invalid_argument if the variable was not loaded
+	std::span<const double> get(int variable) const {
+		if (!variables.test(static_cast<size_t>(variable))) {
+			throw std::invalid_argument("weather variable was not loaded");
+		}
+		return values[static_cast<size_t>(variable)];
+	}
+};
+
 /// This class encapsulates all weather data and construction of splines (which predict data in between our known
 /// discrete data points
+///
+/// A Weather can be restricted to a subset of the weather variables (a column projection) when it is constructed: only
+/// those are parsed and stored. WeatherDataPoint fields of variables that were not loaded are NaN, and asking for them
+/// by name (get_variable_at(), WeatherBatchOut::get()) throws.
+///
+/// With WeatherStorage::QUANTIZED every weather file is held as 16 bit integers (WeatherGrid::quantized()), about 5
+/// times less memory than full precision with the 23 weather stations of the route, for large forecast ensembles.
+/// Every value is then off by at most get_max_quantization_error(), however many updates were applied.
+///
+/// The weather data can be shared between processes on one machine: one process write_shared()s it to a file (in
+/// /dev/shm, that is shared memory), and the others attach_shared() it, mapping the same physical pages read-only
+/// instead of each loading their own copy.
+///
+/// Queries are safe to run concurrently with each other and with update(): every update publishes a new immutable
+/// version of the weather data (read-copy-update), and queries keep using whichever version they started with. The
+/// query path only reads immutable grids (alglib is only used while loading), and each thread keeps its own handle to
+/// the current version and its own batch buffers, so concurrent queries share no writable state and take no locks
+/// once a thread has seen the current version. A thread keeps the last few versions it read alive until it reads
+/// others, the Weather they belong to is destroyed, or the thread exits.
 class Weather {
    public:
-	Weather() = default;
+	Weather();
 
 	/// @brief Construct a new Weather object
 	/// @param weatherFile the path to the weather file
 	/// @param weather_station_coordinates the coordinates of the weather stations
-	Weather(std::string_view weather_file, const WeatherStations& weather_station);
+	/// @param variables the weather variables to load
+	Weather(std::string_view weather_file, const WeatherStations& weather_station,
+		WeatherVariables variables = ALL_WEATHER_VARIABLES);
 
 	/// @brief Construct a new Weather object from multiple weather files and merge them together
-	Weather(std::span<const std::string> weather_files, const WeatherStations& weather_station_coordinates);
+	Weather(std::span<const std::string> weather_files, const WeatherStations& weather_station_coordinates,
+		WeatherVariables variables = ALL_WEATHER_VARIABLES);
+
+	/// @brief Construct a new Weather object from the part of the weather files inside a time window.
+	///
+	/// The files are streamed once, and only rows inside of the window (and the grid times just outside of it) are
+	/// kept, so queries inside of the window give the same results as with the whole files. Queries outside of it
+	/// extrapolate.
+	///
+	/// @param storage how the weather data is held in memory; forecast slabs applied with update() are stored the same
+	/// way
+	/// @throws std::invalid_argument if the window ends before it starts
+	Weather(std::string_view weather_file, const WeatherStations& weather_station, const WeatherTimeWindow& window,
+		WeatherVariables variables = ALL_WEATHER_VARIABLES, WeatherStorage storage = WeatherStorage::FULL);
+	Weather(std::span<const std::string> weather_files, const WeatherStations& weather_station_coordinates,
+		const WeatherTimeWindow& window, WeatherVariables variables = ALL_WEATHER_VARIABLES,
+		WeatherStorage storage = WeatherStorage::FULL);
+
+	/// @brief Copies share the current version of the weather data, and are updated independently afterwards
+	Weather(const Weather& other);
+	Weather& operator=(const Weather& other);
+	~Weather();
 
 	/// @brief get the weather data point at the given weather group and time
 	/// @param weather_station the weather group as a decimal
@@ -31,23 +155,140 @@ class Weather {
 	/// @return WeatherDataPoint the weather data point at the given weather group and time
 	WeatherDataPoint get_weather_at(double weather_station, double time) const;
 
+	/// @brief get a single weather variable at the given weather group and time
+	/// @param variable the weather variable (race_config::weather::CO_*)
+	/// @throws std::invalid_argument if the variable was not loaded
+	double get_variable_at(int variable, double weather_station, double time) const;
+
 	/// @brief get the weather data point at the given weather group and time segment
 	/// @param weather_station the weather group as a decimal
 	/// @param start_time the start time
 	/// @param end_time the end time
+	/// @param averaging how to average over the segment. WeatherAveraging::EXACT integrates the weather over the
+	/// whole segment from precomputed running integrals, and costs about as much as two point queries however long
+	/// the segment is.
 	/// @return WeatherDataPoint the weather data point at the given weather group and time segment
-	WeatherDataPoint get_weather_during(double weather_station, double start_time, double end_time) const;
+	WeatherDataPoint get_weather_during(double weather_station, double start_time, double end_time,
+		WeatherAveraging averaging = WeatherAveraging::ENDPOINTS) const;
+
+	/// @brief get every weather variable at many (weather station, time) pairs at once
+	///
+	/// The queries are sorted by time internally (in cache-sized chunks), so they may come in any order. Each value is
+	/// bit-identical to the matching get_weather_at() query.
+	///
+	/// @param weather_stations the weather group of each query as a decimal
+	/// @param times the time of each query
+	/// @param out resized to hold one value per query for every weather variable
+	/// @throws std::invalid_argument if @p weather_stations and @p times have different lengths
+	void get_weather_batch(
+		std::span<const double> weather_stations, std::span<const double> times, WeatherBatchOut& out) const;
+
+	/// @brief Appends or overwrites a time slab of forecast data for every weather station.
+	///
+	/// Every existing time from the first time of the slab to its last is replaced, also those the slab has no rows at.
+	/// Only the weather file the slab starts in is rebuilt (and only from the first time in the slab onwards); the
+	/// .cache of that file is not rewritten. If there is no weather data yet, the slab becomes the weather data.
+	///
+	/// @param forecast_rows exactly one row per (weather station, time) of the slab, covering every weather station
+	/// @return the version of the weather data that includes the slab
+	/// @throws std::invalid_argument if the slab is incomplete or crosses into the next weather file
+	uint64_t update(std::span<const WeatherForecastRow> forecast_rows);
+
+	/// @brief Reads a forecast file (with the same columns as a weather file) and applies it with update()
+	uint64_t update(std::string_view forecast_file);
+
+	/// @return the version of the weather data, incremented by every update
+	uint64_t get_version() const;
+
+	/// @brief Writes the current version of the weather data to a file other processes can attach_shared().
+	///
+	/// The file is written under a temporary name and renamed into place, so a process attaching meanwhile sees
+	/// either the previous file or the whole new one.
+	/// @param path where to write the weather data, usually /dev/shm/<name>
+	/// @param source what the weather data was loaded from, recorded in the file
+	/// @throws std::runtime_error if the file could not be written
+	void write_shared(const std::string& path, const WeatherSource& source = {}) const;
+
+	/// @brief Maps weather data written by write_shared() read-only, without copying or parsing it.
+	///
+	/// Every process attached to the same file shares one physical copy of it. update() still works, but the
+	/// rebuilt weather files are private to this process.
+	/// @throws std::runtime_error if the file could not be mapped
+	/// @throws std::invalid_argument if the file is not weather data written by write_shared(), or its header does
+	/// not match the weather data in it
+	static Weather attach_shared(const std::string& path);
+
+	/// @brief Same as attach_shared(path), but only attaches to weather data loaded from @p source
+	/// @return nullopt if the file was written from another source, such as an older version of the weather file, or
+	/// cannot be attached at all, so the caller writes it anew
+	static std::optional<Weather> attach_shared(const std::string& path, const WeatherSource& source);
+
+	/// @return the weather variables that were loaded
+	WeatherVariables get_variables() const {
+		return variables;
+	}
+
+	WeatherStorage get_storage() const {
+		return storage;
+	}
+
+	/// @return the largest error quantization adds to a value of the variable across the weather files (0 with
+	/// WeatherStorage::FULL)
+	double get_max_quantization_error(int variable) const;
 
    private:
-	struct SplineAndStartTime {
-		double start_time;
-		alglib::spline2dinterpolant weather_spline;
+	friend class WeatherCursor;
+
+	/// One immutable version of the weather data
+	struct Snapshot {
+		uint64_t version = 0;
+		/// one grid per weather file, sorted by start time
+		std::vector<std::shared_ptr<const WeatherGrid>> weather_grids;
+
+		/// @return the index of the grid covering the given time: the last one starting at or before it
+		size_t grid_index_at(double time) const;
+		const WeatherGrid& grid_at(double time) const;
 	};
-	/// spline interpolant for all weather data
-	std::vector<SplineAndStartTime> weather_splines;
+
+	/// @brief Interpolates every weather variable the race needs inside a grid cell
+	static WeatherDataPoint get_weather_in(const WeatherGrid& weather_grid, const WeatherGrid::Cell& cell);
+
+	/// @brief The exact mean of every weather variable the race needs over a time interval, across weather files
+	static WeatherDataPoint get_mean_weather(
+		const Snapshot& snapshot, double weather_station, double start_time, double end_time);
+
+	/// @return the current version of the weather data, which stays valid for as long as it is held
+	std::shared_ptr<const Snapshot> get_snapshot() const;
+	/// The version of the weather data a query reads, pinned in the per-thread cache until the query is done
+	class QuerySnapshot;
+	/// @return the current version of the weather data from a per-thread cache. It stays valid for as long as the
+	/// returned handle exists, whatever other queries the thread makes meanwhile.
+	QuerySnapshot get_query_snapshot() const;
+	/// replaces the current version of the weather data
+	void publish(std::shared_ptr<const Snapshot> next);
+	/// @brief Maps weather data written by write_shared(), and reads the source recorded in it into @p source
+	static Weather attach_shared_file(const std::string& path, WeatherSource& source);
+	/// @return a number no snapshot of any Weather has had yet
+	static uint64_t next_generation();
+
+	/// the current version of the weather data
+	std::shared_ptr<const Snapshot> snapshot;
+	/// only held to copy or replace the snapshot pointer
+	mutable std::mutex snapshot_mutex;
+	/// serializes writers, so a slow update never blocks readers
+	std::mutex update_mutex;
+	/// identifies the current snapshot among those of every Weather, so threads can tell whether theirs is current
+	/// without taking snapshot_mutex
+	std::atomic<uint64_t> generation = next_generation();
+	/// expires when this Weather is destroyed, so the per-thread caches can tell which snapshots to release
+	std::shared_ptr<const void> lifetime = std::make_shared<char>();
 
 	/// the number of weather groups
-	int num_weather_groups;
+	int num_weather_groups = 0;
+	/// the weather variables that are loaded
+	WeatherVariables variables = ALL_WEATHER_VARIABLES;
+	/// how the weather files are held in memory
+	WeatherStorage storage = WeatherStorage::FULL;
 };
 
 #endif  // MINISIM_WEATHER_H
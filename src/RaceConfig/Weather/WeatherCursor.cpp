@@ -0,0 +1,39 @@
+#include "WeatherCursor.h"
+
+#include <limits>
+
+#include "Tools/Metrics.h"
+
+WeatherCursor::WeatherCursor(const Weather& weather) : snapshot(weather.get_snapshot()) {}
+
+WeatherGrid::Cell WeatherCursor::locate(double weather_station, double time) {
+	if (weather_grid != nullptr && time >= grid_start_time && time < grid_end_time) {
+		cell = weather_grid->locate(time, weather_station, cell);
+		return cell;
+	}
+
+	const size_t grid_index = snapshot->grid_index_at(time);
+	weather_grid = snapshot->weather_grids[grid_index].get();
+	grid_start_time = weather_grid->get_start_time();
+	grid_end_time = grid_index + 1 < snapshot->weather_grids.size()
+						? snapshot->weather_grids[grid_index + 1]->get_start_time()
+						: std::numeric_limits<double>::infinity();
+	cell = weather_grid->locate(time, weather_station);
+	return cell;
+}
+
+WeatherDataPoint WeatherCursor::get_weather_at(double weather_station, double time) {
+	MINISIM_COUNT("weather_cursor.get_weather_at");
+	const WeatherGrid::Cell query_cell = locate(weather_station, time);
+	return Weather::get_weather_in(*weather_grid, query_cell);
+}
+
+WeatherDataPoint WeatherCursor::get_weather_during(
+	double weather_station, double start_time, double end_time, WeatherAveraging averaging) {
+	if (averaging == WeatherAveraging::EXACT) {
+		return Weather::get_mean_weather(*snapshot, weather_station, start_time, end_time);
+	}
+	const WeatherDataPoint start_data = get_weather_at(weather_station, start_time);
+	const WeatherDataPoint end_data = get_weather_at(weather_station, end_time);
+	return WeatherDataPoint::average(start_data, end_data);
+}
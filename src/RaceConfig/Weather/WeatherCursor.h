@@ -0,0 +1,45 @@
+#ifndef MINISIM_WEATHERCURSOR_H
+#define MINISIM_WEATHERCURSOR_H
+
+#include <cstddef>
+#include <memory>
+
+#include "Weather.h"
+#include "WeatherDataPoint.h"
+#include "WeatherGrid.h"
+
+/// @brief A stateful view of Weather for queries that move (mostly) forward in time, like a race.
+///
+/// The cursor remembers the weather file and grid cell of its last query and walks from there, so a query next to
+/// the previous one costs a couple of comparisons and a bilinear blend. Jumps fall back to a full search. Results
+/// are identical to Weather::get_weather_at().
+///
+/// A cursor reads the version of the weather data that was current when it was created, and is meant to be used by
+/// one thread at a time.
+class WeatherCursor {
+   public:
+	explicit WeatherCursor(const Weather& weather);
+
+	/// @brief Same as Weather::get_weather_at()
+	WeatherDataPoint get_weather_at(double weather_station, double time);
+
+	/// @brief Same as Weather::get_weather_during()
+	WeatherDataPoint get_weather_during(double weather_station, double start_time, double end_time,
+		WeatherAveraging averaging = WeatherAveraging::ENDPOINTS);
+
+   private:
+	/// @return the cell of the query, moving to another weather file if the time left the current one
+	WeatherGrid::Cell locate(double weather_station, double time);
+
+	std::shared_ptr<const Weather::Snapshot> snapshot;
+
+	/// the weather file of the last query, and the times [start, end) it is used for
+	const WeatherGrid* weather_grid = nullptr;
+	double grid_start_time = 0;
+	double grid_end_time = 0;
+
+	/// the cell of the last query
+	WeatherGrid::Cell cell = {};
+};
+
+#endif  // MINISIM_WEATHERCURSOR_H
@@ -0,0 +1,567 @@
+#include "WeatherGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace race_config::weather;
+
+namespace {
+	/// The index of the first axis node that is not less than x
+	size_t index_of(std::span<const double> axis, double x) {
+		return static_cast<size_t>(std::distance(axis.begin(), std::lower_bound(axis.begin(), axis.end(), x)));
+	}
+
+	/// Same interval search as alglib's spline2dcalcvbuf: the index l of the cell [axis[l], axis[l + 1]] used for x,
+	/// clamped to the first / last cell outside of the axis (linear extrapolation)
+	size_t find_interval(std::span<const double> axis, double x) {
+		return std::clamp<size_t>(index_of(axis, x), 1, axis.size() - 1) - 1;
+	}
+
+	/// Walks the interval index of a previous query to the one find_interval() would give x. Queries that moved more
+	/// than a few cells away fall back to the full search.
+	size_t walk_interval(std::span<const double> axis, double x, size_t index) {
+		constexpr int max_steps = 2;
+		const size_t last_interval = axis.size() - 2;
+		for (int step = 0; step < max_steps; ++step) {
+			if (index < last_interval && axis[index + 1] < x) {
+				++index;
+			} else if (index > 0 && axis[index] >= x) {
+				--index;
+			} else {
+				return index;
+			}
+		}
+		return find_interval(axis, x);
+	}
+
+	std::vector<double> sorted_unique(std::vector<double> values) {
+		std::sort(values.begin(), values.end());
+		values.erase(std::unique(values.begin(), values.end()), values.end());
+		return values;
+	}
+
+	/// What WeatherGrid::write() puts in front of the arrays of a grid
+	struct SerializedGridHeader {
+		std::uint64_t num_times;
+		std::uint64_t num_stations;
+		std::uint64_t variables;
+		std::uint64_t num_values;
+		std::uint64_t num_integrals;
+		std::uint64_t num_quantized_values;
+		std::uint64_t num_value_scales;
+		std::uint64_t num_checkpoints;
+	};
+
+	/// Every serialized array starts 8 byte aligned
+	constexpr size_t SERIALIZED_ALIGNMENT = 8;
+
+	size_t padded_size(size_t size) {
+		return (size + SERIALIZED_ALIGNMENT - 1) / SERIALIZED_ALIGNMENT * SERIALIZED_ALIGNMENT;
+	}
+
+	template <typename T>
+	void write_array(std::ostream& out, std::span<const T> array) {
+		constexpr std::array<char, SERIALIZED_ALIGNMENT> padding = {};
+		out.write(reinterpret_cast<const char*>(array.data()), static_cast<std::streamsize>(array.size_bytes()));
+		out.write(padding.data(), static_cast<std::streamsize>(padded_size(array.size_bytes()) - array.size_bytes()));
+	}
+
+	/// Takes an array of @p count elements off the front of @p bytes
+	template <typename T>
+	std::span<const T> view_array(std::span<const std::byte>& bytes, std::uint64_t count) {
+		if (count > bytes.size() / sizeof(T)) {
+			throw std::invalid_argument("serialized weather grid is truncated");
+		}
+		const size_t size = padded_size(count * sizeof(T));
+		if (size > bytes.size() || reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(T) != 0) {
+			throw std::invalid_argument("serialized weather grid is truncated or misaligned");
+		}
+		const std::span<const T> array(reinterpret_cast<const T*>(bytes.data()), count);
+		bytes = bytes.subspan(size);
+		return array;
+	}
+}  // namespace
+
+WeatherGrid WeatherGrid::from_spline(const alglib::spline2dinterpolant& spline, WeatherVariables variables) {
+	const alglib_impl::spline2dinterpolant* impl = spline.c_ptr();
+	if (impl->stype != -1 || impl->d != NUM_WEATHER_VARIABLES) {
+		throw std::invalid_argument("weather spline is not a bilinear spline over every weather variable");
+	}
+	const auto n = static_cast<size_t>(impl->n);
+	const auto m = static_cast<size_t>(impl->m);
+	const auto d = static_cast<size_t>(impl->d);
+
+	WeatherGrid grid;
+	grid.assign_planes(variables);
+	auto arrays = std::make_shared<Arrays>();
+	arrays->times.assign(impl->x.ptr.p_double, impl->x.ptr.p_double + n);
+	arrays->stations.assign(impl->y.ptr.p_double, impl->y.ptr.p_double + m);
+	arrays->values.resize(n * m * variables.count());
+	for (size_t variable = 0; variable < d; ++variable) {
+		if (!variables.test(variable)) {
+			continue;
+		}
+		const size_t plane = grid.planes[variable];
+		for (size_t station = 0; station < m; ++station) {
+			for (size_t time = 0; time < n; ++time) {
+				arrays->values[(plane * m + station) * n + time] = impl->f.ptr.p_double[d * (n * station + time) + variable];
+			}
+		}
+	}
+	build_integrals(*arrays, 0);
+	grid.adopt(std::move(arrays));
+	return grid;
+}
+
+WeatherGrid WeatherGrid::from_rows(std::span<const WeatherForecastRow> rows, WeatherVariables variables) {
+	WeatherGrid grid;
+	grid.assign_planes(variables);
+	std::vector<double> row_times;
+	std::vector<double> row_stations;
+	row_times.reserve(rows.size());
+	row_stations.reserve(rows.size());
+	for (const auto& row : rows) {
+		row_times.push_back(row.time);
+		row_stations.push_back(row.weather_station);
+	}
+	auto arrays = std::make_shared<Arrays>();
+	arrays->times = sorted_unique(std::move(row_times));
+	arrays->stations = sorted_unique(std::move(row_stations));
+
+	const size_t n = arrays->times.size();
+	const size_t m = arrays->stations.size();
+	if (n < 2 || m < 2) {
+		throw std::invalid_argument("weather forecast needs at least two times and two weather stations");
+	}
+	if (rows.size() != n * m) {
+		throw std::invalid_argument("weather forecast must have exactly one row per weather station and time");
+	}
+
+	arrays->values.resize(n * m * variables.count());
+	std::vector<bool> filled(n * m, false);
+	for (const auto& row : rows) {
+		const size_t time = index_of(arrays->times, row.time);
+		const size_t station = index_of(arrays->stations, row.weather_station);
+		if (filled[station * n + time]) {
+			throw std::invalid_argument("weather forecast has duplicate rows for a weather station and time");
+		}
+		filled[station * n + time] = true;
+		for (size_t variable = 0; variable < row.values.size(); ++variable) {
+			if (!variables.test(variable)) {
+				continue;
+			}
+			const double value = row.values[variable];
+			if (!std::isfinite(value)) {
+				throw std::invalid_argument("weather forecast contains a NaN or infinite value");
+			}
+			arrays->values[(grid.planes[variable] * m + station) * n + time] = value;
+		}
+	}
+	build_integrals(*arrays, 0);
+	grid.adopt(std::move(arrays));
+	return grid;
+}
+
+WeatherGrid WeatherGrid::from_columns(std::vector<double> times, std::vector<double> stations,
+	WeatherVariables variables, std::vector<double> values) {
+	if (times.size() < 2 || stations.size() < 2) {
+		throw std::invalid_argument("weather data needs at least two times and two weather stations");
+	}
+	if (!std::is_sorted(times.begin(), times.end()) || !std::is_sorted(stations.begin(), stations.end()) ||
+		std::adjacent_find(times.begin(), times.end()) != times.end() ||
+		std::adjacent_find(stations.begin(), stations.end()) != stations.end()) {
+		throw std::invalid_argument("weather data times and weather stations must be strictly increasing");
+	}
+	if (values.size() != times.size() * stations.size() * variables.count()) {
+		throw std::invalid_argument("weather data must have one value per weather station, time and variable");
+	}
+
+	WeatherGrid grid;
+	grid.assign_planes(variables);
+	auto arrays = std::make_shared<Arrays>();
+	arrays->times = std::move(times);
+	arrays->stations = std::move(stations);
+	arrays->values = std::move(values);
+	build_integrals(*arrays, 0);
+	grid.adopt(std::move(arrays));
+	return grid;
+}
+
+WeatherGrid WeatherGrid::merged_with(std::span<const WeatherForecastRow> rows) const {
+	const WeatherGrid slab = from_rows(rows, variables);
+	if (!std::equal(slab.stations.begin(), slab.stations.end(), stations.begin(), stations.end())) {
+		throw std::invalid_argument("weather forecast must cover exactly the weather stations of the weather data");
+	}
+
+	WeatherGrid merged;
+	merged.assign_planes(variables);
+	auto arrays = std::make_shared<Arrays>();
+	arrays->stations.assign(stations.begin(), stations.end());
+
+	// Where every existing time that is kept goes. The slab replaces every existing time inside of its range: a finer
+	// existing grid would otherwise keep its old values between the times of the slab.
+	struct KeptTime {
+		size_t time_index;
+		size_t merged_time_index;
+	};
+	std::vector<KeptTime> kept_times;
+	size_t old_index = 0;
+	for (; old_index < times.size() && times[old_index] < slab.times.front(); ++old_index) {
+		kept_times.push_back({old_index, arrays->times.size()});
+		arrays->times.push_back(times[old_index]);
+	}
+	const size_t first_changed_time_index = arrays->times.size();
+	arrays->times.insert(arrays->times.end(), slab.times.begin(), slab.times.end());
+	for (; old_index < times.size(); ++old_index) {
+		if (times[old_index] > slab.times.back()) {
+			kept_times.push_back({old_index, arrays->times.size()});
+			arrays->times.push_back(times[old_index]);
+		}
+	}
+
+	const size_t n = arrays->times.size();
+	const size_t m = stations.size();
+	const size_t num_planes = variables.count();
+	if (is_quantized()) {
+		// The kept times keep their levels and scales, only the times of the slab are quantized
+		arrays->quantized_values.resize(n * m * num_planes);
+		arrays->value_offsets.resize(n * num_planes);
+		arrays->value_scales.resize(n * num_planes);
+		for (size_t plane = 0; plane < num_planes; ++plane) {
+			for (const auto& [time, merged_time] : kept_times) {
+				arrays->value_offsets[plane * n + merged_time] = value_offsets[plane * times.size() + time];
+				arrays->value_scales[plane * n + merged_time] = value_scales[plane * times.size() + time];
+			}
+		}
+		for (size_t row = 0; row < m * num_planes; ++row) {
+			for (const auto& [time, merged_time] : kept_times) {
+				arrays->quantized_values[row * n + merged_time] = quantized_values[row * times.size() + time];
+			}
+		}
+		quantize_times(*arrays, first_changed_time_index, slab, 0, slab.times.size());
+		build_checkpoints(*arrays);
+		merged.adopt(std::move(arrays));
+		return merged;
+	}
+
+	arrays->values.resize(n * m * num_planes);
+	arrays->integrals.resize(arrays->values.size());
+	for (size_t row = 0; row < m * num_planes; ++row) {
+		double* merged_row = &arrays->values[row * n];
+		// Everything before the slab is untouched, so its running integrals are too
+		const double* old_integrals = &integrals[row * times.size()];
+		std::copy(old_integrals, old_integrals + first_changed_time_index, &arrays->integrals[row * n]);
+		for (const auto& [time, merged_time] : kept_times) {
+			merged_row[merged_time] = values[row * times.size() + time];
+		}
+		const double* slab_row = &slab.values[row * slab.times.size()];
+		std::copy(slab_row, slab_row + slab.times.size(), merged_row + first_changed_time_index);
+	}
+	build_integrals(*arrays, first_changed_time_index);
+	merged.adopt(std::move(arrays));
+	return merged;
+}
+
+WeatherGrid WeatherGrid::quantized() const {
+	if (is_quantized()) {
+		return *this;
+	}
+	const size_t n = times.size();
+
+	WeatherGrid grid;
+	grid.assign_planes(variables);
+	auto arrays = std::make_shared<Arrays>();
+	arrays->times.assign(times.begin(), times.end());
+	arrays->stations.assign(stations.begin(), stations.end());
+	arrays->quantized_values.resize(values.size());
+	arrays->value_offsets.resize(n * variables.count());
+	arrays->value_scales.resize(n * variables.count());
+	quantize_times(*arrays, 0, *this, 0, n);
+	build_checkpoints(*arrays);
+	grid.adopt(std::move(arrays));
+	return grid;
+}
+
+WeatherGrid WeatherGrid::expanded() const {
+	if (!is_quantized()) {
+		return *this;
+	}
+	std::vector<double> expanded_values(quantized_values.size());
+	const size_t n = times.size();
+	const size_t plane_size = n * stations.size();
+	for (size_t index = 0; index < expanded_values.size(); ++index) {
+		expanded_values[index] = value_at(index / plane_size, index, index % n);
+	}
+	return from_columns({times.begin(), times.end()}, {stations.begin(), stations.end()}, variables,
+		std::move(expanded_values));
+}
+
+double WeatherGrid::max_quantization_error(int variable) const {
+	if (!is_quantized()) {
+		return 0.0;
+	}
+	const auto plane_scales = value_scales.subspan(plane_of(variable) * times.size(), times.size());
+	return *std::max_element(plane_scales.begin(), plane_scales.end()) / 2.0;
+}
+
+void WeatherGrid::quantize_times(
+	Arrays& arrays, size_t first_time, const WeatherGrid& source, size_t source_first_time, size_t count) {
+	constexpr double levels = std::numeric_limits<std::uint16_t>::max();
+	const size_t n = arrays.times.size();
+	const size_t source_n = source.times.size();
+	const size_t m = arrays.stations.size();
+	std::vector<double> min(count);
+	std::vector<double> max(count);
+	std::vector<double> inverse_scales(count);
+	for (size_t plane = 0; plane < source.variables.count(); ++plane) {
+		// The range of every time across the weather stations, one station row at a time
+		const auto source_row = [&](size_t station) {
+			return &source.values[(plane * m + station) * source_n + source_first_time];
+		};
+		std::copy(source_row(0), source_row(0) + count, min.begin());
+		std::copy(source_row(0), source_row(0) + count, max.begin());
+		for (size_t station = 1; station < m; ++station) {
+			const double* row = source_row(station);
+			for (size_t time = 0; time < count; ++time) {
+				min[time] = std::min(min[time], row[time]);
+				max[time] = std::max(max[time], row[time]);
+			}
+		}
+		for (size_t time = 0; time < count; ++time) {
+			const double scale = (max[time] - min[time]) / levels;
+			arrays.value_offsets[plane * n + first_time + time] = min[time];
+			arrays.value_scales[plane * n + first_time + time] = scale;
+			inverse_scales[time] = scale > 0.0 ? 1.0 / scale : 0.0;
+		}
+		for (size_t station = 0; station < m; ++station) {
+			const double* row = source_row(station);
+			std::uint16_t* quantized_row = &arrays.quantized_values[(plane * m + station) * n + first_time];
+			for (size_t time = 0; time < count; ++time) {
+				const double level = std::round((row[time] - min[time]) * inverse_scales[time]);
+				quantized_row[time] = static_cast<std::uint16_t>(std::clamp(level, 0.0, levels));
+			}
+		}
+	}
+}
+
+void WeatherGrid::build_checkpoints(Arrays& arrays) {
+	// The running integrals are kept every CHECKPOINT_INTERVAL grid times, from the quantized values so they agree
+	// with the interpolant
+	const auto& times = arrays.times;
+	const size_t n = times.size();
+	const size_t m = arrays.stations.size();
+	const size_t num_checkpoints = (n - 1) / CHECKPOINT_INTERVAL + 1;
+	const size_t num_rows = arrays.quantized_values.size() / n;
+	arrays.checkpoints.resize(num_rows * num_checkpoints);
+	for (size_t row = 0; row < num_rows; ++row) {
+		const size_t plane = row / m;
+		const auto dequantized = [&](size_t time) {
+			return arrays.value_offsets[plane * n + time] +
+				   arrays.value_scales[plane * n + time] * arrays.quantized_values[row * n + time];
+		};
+		double integral = 0.0;
+		for (size_t time = 0; time < n; ++time) {
+			if (time > 0) {
+				integral += (times[time] - times[time - 1]) * (dequantized(time - 1) + dequantized(time)) / 2.0;
+			}
+			if (time % CHECKPOINT_INTERVAL == 0) {
+				arrays.checkpoints[row * num_checkpoints + time / CHECKPOINT_INTERVAL] = integral;
+			}
+		}
+	}
+}
+
+double WeatherGrid::checkpointed_integral(size_t plane, size_t index) const {
+	const size_t n = times.size();
+	const size_t row = index / n;
+	const size_t time_index = index % n;
+	const size_t checkpoint = time_index / CHECKPOINT_INTERVAL;
+	double integral = checkpoints[row * ((n - 1) / CHECKPOINT_INTERVAL + 1) + checkpoint];
+	for (size_t time = checkpoint * CHECKPOINT_INTERVAL + 1; time <= time_index; ++time) {
+		integral += (times[time] - times[time - 1]) *
+					(value_at(plane, row * n + time - 1, time - 1) + value_at(plane, row * n + time, time)) / 2.0;
+	}
+	return integral;
+}
+
+void WeatherGrid::write(std::ostream& out) const {
+	const SerializedGridHeader header = {
+		.num_times = times.size(),
+		.num_stations = stations.size(),
+		.variables = variables.to_ullong(),
+		.num_values = values.size(),
+		.num_integrals = integrals.size(),
+		.num_quantized_values = quantized_values.size(),
+		.num_value_scales = value_scales.size(),
+		.num_checkpoints = checkpoints.size(),
+	};
+	write_array(out, std::span<const SerializedGridHeader>(&header, 1));
+	write_array(out, times);
+	write_array(out, stations);
+	write_array(out, values);
+	write_array(out, integrals);
+	write_array(out, value_offsets);
+	write_array(out, value_scales);
+	write_array(out, checkpoints);
+	write_array(out, quantized_values);
+}
+
+WeatherGrid WeatherGrid::view(std::span<const std::byte>& bytes, std::shared_ptr<const void> storage) {
+	const SerializedGridHeader header = view_array<SerializedGridHeader>(bytes, 1)[0];
+
+	WeatherGrid grid;
+	grid.assign_planes(WeatherVariables(header.variables));
+	grid.times = view_array<double>(bytes, header.num_times);
+	grid.stations = view_array<double>(bytes, header.num_stations);
+	grid.values = view_array<double>(bytes, header.num_values);
+	grid.integrals = view_array<double>(bytes, header.num_integrals);
+	grid.value_offsets = view_array<double>(bytes, header.num_value_scales);
+	grid.value_scales = view_array<double>(bytes, header.num_value_scales);
+	grid.checkpoints = view_array<double>(bytes, header.num_checkpoints);
+	grid.quantized_values = view_array<std::uint16_t>(bytes, header.num_quantized_values);
+	grid.storage = std::move(storage);
+
+	// Every index the queries compute has to land inside of the arrays
+	const size_t n = grid.times.size();
+	const size_t size = n * grid.stations.size() * grid.variables.count();
+	const bool full = grid.values.size() == size && grid.integrals.size() == size && grid.quantized_values.empty() &&
+					  grid.value_scales.empty();
+	const bool quantized = grid.values.empty() && grid.integrals.empty() && grid.quantized_values.size() == size &&
+						   grid.value_scales.size() == n * grid.variables.count() &&
+						   grid.checkpoints.size() == size / n * ((n - 1) / CHECKPOINT_INTERVAL + 1);
+	if (n < 2 || grid.stations.size() < 2 || size == 0 || !(full || quantized)) {
+		throw std::invalid_argument("serialized weather grid is inconsistent");
+	}
+	return grid;
+}
+
+void WeatherGrid::adopt(std::shared_ptr<const Arrays> arrays) {
+	times = arrays->times;
+	stations = arrays->stations;
+	values = arrays->values;
+	integrals = arrays->integrals;
+	quantized_values = arrays->quantized_values;
+	value_offsets = arrays->value_offsets;
+	value_scales = arrays->value_scales;
+	checkpoints = arrays->checkpoints;
+	storage = std::move(arrays);
+}
+
+void WeatherGrid::assign_planes(WeatherVariables loaded_variables) {
+	variables = loaded_variables;
+	size_t plane = 0;
+	for (size_t variable = 0; variable < planes.size(); ++variable) {
+		planes[variable] = variables.test(variable) ? plane++ : planes.size();
+	}
+}
+
+WeatherGrid::Cell WeatherGrid::locate(double time, double weather_station) const {
+	return make_cell(find_interval(times, time), find_interval(stations, weather_station), time, weather_station);
+}
+
+WeatherGrid::Cell WeatherGrid::locate(double time, double weather_station, const Cell& hint) const {
+	return make_cell(walk_interval(times, time, hint.time_index),
+		walk_interval(stations, weather_station, hint.station_index), time, weather_station);
+}
+
+void WeatherGrid::interpolate_batch(std::span<const double> query_times, std::span<const double> query_stations,
+	const std::array<double*, NUM_WEATHER_VARIABLES>& out) const {
+	const size_t count = query_times.size();
+	if (count == 0) {
+		return;
+	}
+	const size_t n = times.size();
+
+	// Queries are handled in blocks small enough for the scratch arrays to stay in L1
+	constexpr size_t block_size = 256;
+	std::array<size_t, block_size> offsets;
+	std::array<size_t, block_size> time_indices;
+	// the corner weights are the same products interpolate() forms, so the sums below match it bit for bit
+	std::array<std::array<double, block_size>, 4> weights;
+	// the corner loads are gathers, so they get a loop of their own and the blend runs over contiguous arrays
+	std::array<std::array<double, block_size>, 4> corners;
+
+	Cell cell = locate(query_times[0], query_stations[0]);
+	for (size_t block_start = 0; block_start < count; block_start += block_size) {
+		const size_t block_count = std::min(block_size, count - block_start);
+
+		for (size_t query = 0; query < block_count; ++query) {
+			cell = locate(query_times[block_start + query], query_stations[block_start + query], cell);
+			offsets[query] = cell.station_index * n + cell.time_index;
+			time_indices[query] = cell.time_index;
+			weights[0][query] = (1.0 - cell.t) * (1.0 - cell.u);
+			weights[1][query] = cell.t * (1.0 - cell.u);
+			weights[2][query] = cell.t * cell.u;
+			weights[3][query] = (1.0 - cell.t) * cell.u;
+		}
+
+		for (int variable = 0; variable < NUM_WEATHER_VARIABLES; ++variable) {
+			if (!has_variable(variable)) {
+				continue;
+			}
+			const size_t plane = plane_of(variable);
+			if (is_quantized()) {
+				const std::uint16_t* levels = &quantized_values[plane * stations.size() * n];
+				const double* plane_offsets = &value_offsets[plane * n];
+				const double* plane_scales = &value_scales[plane * n];
+				for (size_t query = 0; query < block_count; ++query) {
+					const std::uint16_t* corner = levels + offsets[query];
+					const size_t time = time_indices[query];
+					corners[0][query] = plane_offsets[time] + plane_scales[time] * corner[0];
+					corners[1][query] = plane_offsets[time + 1] + plane_scales[time + 1] * corner[1];
+					corners[2][query] = plane_offsets[time + 1] + plane_scales[time + 1] * corner[n + 1];
+					corners[3][query] = plane_offsets[time] + plane_scales[time] * corner[n];
+				}
+			} else {
+				const double* corner_values = &values[plane * stations.size() * n];
+				for (size_t query = 0; query < block_count; ++query) {
+					const double* corner = corner_values + offsets[query];
+					corners[0][query] = corner[0];
+					corners[1][query] = corner[1];
+					corners[2][query] = corner[n + 1];
+					corners[3][query] = corner[n];
+				}
+			}
+
+			double* result = out[static_cast<size_t>(variable)] + block_start;
+			for (size_t query = 0; query < block_count; ++query) {
+				result[query] = weights[0][query] * corners[0][query] + weights[1][query] * corners[1][query] +
+								weights[2][query] * corners[2][query] + weights[3][query] * corners[3][query];
+			}
+		}
+	}
+}
+
+WeatherGrid::Cell WeatherGrid::make_cell(
+	size_t time_index, size_t station_index, double time, double weather_station) const {
+	const double dt = 1.0 / (times[time_index + 1] - times[time_index]);
+	const double du = 1.0 / (stations[station_index + 1] - stations[station_index]);
+	return {
+		.time_index = time_index,
+		.station_index = station_index,
+		.t = (time - times[time_index]) * dt,
+		.u = (weather_station - stations[station_index]) * du,
+	};
+}
+
+void WeatherGrid::build_integrals(Arrays& arrays, size_t first_time_index) {
+	const auto& times = arrays.times;
+	const auto& values = arrays.values;
+	auto& integrals = arrays.integrals;
+	const size_t n = times.size();
+	integrals.resize(values.size());
+	for (size_t row = 0; row < values.size(); row += n) {
+		if (first_time_index == 0) {
+			integrals[row] = 0.0;
+		}
+		for (size_t time = std::max<size_t>(first_time_index, 1); time < n; ++time) {
+			integrals[row + time] =
+				integrals[row + time - 1] + (times[time] - times[time - 1]) * (values[row + time - 1] + values[row + time]) / 2.0;
+		}
+	}
+}
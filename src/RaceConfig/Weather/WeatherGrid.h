@@ -0,0 +1,261 @@
+#ifndef MINISIM_WEATHERGRID_H
+#define MINISIM_WEATHERGRID_H
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+
+#include "RaceConfig/RaceConfigConstants.h"
+#include "alglib/interpolation.h"
+
+/// @brief One forecast row: every interpolated weather variable of one weather station at one time
+struct WeatherForecastRow {
+	double weather_station;
+	double time;
+	/// indexed by the race_config::weather::CO_* column order
+	std::array<double, race_config::weather::NUM_WEATHER_VARIABLES> values;
+};
+
+/// @brief A set of weather variables, indexed by the race_config::weather::CO_* column order
+using WeatherVariables = std::bitset<race_config::weather::NUM_WEATHER_VARIABLES>;
+
+/// every weather variable
+constexpr WeatherVariables ALL_WEATHER_VARIABLES{(1ULL << race_config::weather::NUM_WEATHER_VARIABLES) - 1};
+
+/// the weather variables the race physics reads: irradiance, wind and air density
+constexpr WeatherVariables RACE_WEATHER_VARIABLES{(1ULL << race_config::weather::CO_GHI) |
+												 (1ULL << race_config::weather::CO_WIND_VELOCITY_NS) |
+												 (1ULL << race_config::weather::CO_WIND_VELOCITY_EW) |
+												 (1ULL << race_config::weather::CO_AIR_DENSITY)};
+
+/// @brief How a WeatherGrid stores its values
+enum class WeatherStorage : std::uint8_t {
+	/// doubles, and running integrals at every grid time (16 bytes per value)
+	FULL,
+	/// 16 bit integers scaled to the range of each variable at each grid time, and running integrals every few grid
+	/// times (about 2.25 bytes per value, plus 16 bytes per variable and grid time). See WeatherGrid::quantized().
+	QUANTIZED,
+};
+
+/// @brief The bilinear (time x weather station) grid holding the weather variables of one weather file.
+///
+/// Evaluation reproduces alglib's bilinear spline2d bit for bit, but the grid values are owned here so they can be
+/// updated cell by cell without rebuilding an alglib interpolant. Only the weather variables the grid was built with
+/// are stored; the variable arguments of its methods must be among them (see has_variable()).
+///
+/// A grid is immutable once built, so copies share its arrays. The arrays may also live in a read-only shared memory
+/// mapping (see write() and view()).
+class WeatherGrid {
+   public:
+	/// @brief The bilinear cell containing a (time, weather station) query, and the position inside of it
+	struct Cell {
+		size_t time_index;
+		size_t station_index;
+		/// position between times[time_index] and times[time_index + 1], in [0, 1] inside the grid
+		double t;
+		/// position between stations[station_index] and stations[station_index + 1], in [0, 1] inside the grid
+		double u;
+	};
+
+	WeatherGrid() = default;
+
+	/// @brief Copies the grid out of an alglib bilinear vector spline (time as x, weather station as y)
+	static WeatherGrid from_spline(
+		const alglib::spline2dinterpolant& spline, WeatherVariables variables = ALL_WEATHER_VARIABLES);
+
+	/// @brief Builds a grid from forecast rows covering every (weather station, time) pair exactly once
+	static WeatherGrid from_rows(
+		std::span<const WeatherForecastRow> rows, WeatherVariables variables = ALL_WEATHER_VARIABLES);
+
+	/// @brief Builds a grid from values that are already laid out like the grid
+	/// @param values [variable][station][time], with only the variables in @p variables, in CO_* order
+	static WeatherGrid from_columns(std::vector<double> times, std::vector<double> stations,
+		WeatherVariables variables, std::vector<double> values);
+
+	bool has_variable(int variable) const {
+		return variables.test(static_cast<size_t>(variable));
+	}
+	WeatherVariables get_variables() const {
+		return variables;
+	}
+
+	/// @brief Writes the grid in the layout view() reads: a header, then every array, each padded to 8 bytes
+	void write(std::ostream& out) const;
+
+	/// @brief A grid over arrays written by write() that already are in memory, without copying them
+	/// @param bytes starts at a grid written by write(); advanced past it
+	/// @param storage keeps the memory @p bytes points into alive for as long as the grid (and its copies) exist
+	/// @throws std::invalid_argument if @p bytes does not hold a whole, consistent grid
+	static WeatherGrid view(std::span<const std::byte>& bytes, std::shared_ptr<const void> storage);
+
+	/// @brief Merges forecast rows covering every weather station of this grid into a copy of it. The rows replace
+	/// every existing time from their first time to their last, so the grid there holds exactly the times of the rows.
+	/// A quantized grid stays quantized: only the times of the rows are quantized, the other times keep their levels,
+	/// so repeated updates never add to the error of the values they leave alone.
+	WeatherGrid merged_with(std::span<const WeatherForecastRow> rows) const;
+
+	/// @brief A copy of the grid storing every variable as 16 bit integers: value = offset + scale * q, with an offset
+	/// and scale for each variable at each grid time spanning its range across the weather stations at that time.
+	///
+	/// Every stored value, and so every interpolated value, is off by at most max_quantization_error(), which is
+	/// (max - min) / 131070 of the variable at the grid time it varies most across the weather stations (at most
+	/// 0.011 W/m^2 for irradiance between 0 and 1400 W/m^2). The exact time averages add no error of their own beyond
+	/// that. Since every grid time has its own scale, the values at one time can be replaced without requantizing the
+	/// others (see merged_with()).
+	WeatherGrid quantized() const;
+	/// @brief A copy of a quantized grid storing doubles again
+	WeatherGrid expanded() const;
+
+	bool is_quantized() const {
+		return !quantized_values.empty();
+	}
+	/// @return the largest difference between a stored value of the variable and the value it was built from
+	double max_quantization_error(int variable) const;
+
+	Cell locate(double time, double weather_station) const;
+
+	/// @brief Same as locate(), but walks from the cell of a previous nearby query instead of searching both axes
+	Cell locate(double time, double weather_station, const Cell& hint) const;
+
+	/// @brief Bilinearly interpolates a variable (race_config::weather::CO_*) inside a cell
+	double interpolate(int variable, const Cell& cell) const {
+		const size_t n = times.size();
+		const size_t plane = plane_of(variable);
+		const size_t row = plane * stations.size() * n + cell.station_index * n + cell.time_index;
+		const size_t time = cell.time_index;
+		const double y1 = value_at(plane, row, time);
+		const double y2 = value_at(plane, row + 1, time + 1);
+		const double y3 = value_at(plane, row + n + 1, time + 1);
+		const double y4 = value_at(plane, row + n, time);
+		const double t = cell.t;
+		const double u = cell.u;
+		return (1.0 - t) * (1.0 - u) * y1 + t * (1.0 - u) * y2 + t * u * y3 + (1.0 - t) * u * y4;
+	}
+
+	/// @brief The integral over time of a variable (race_config::weather::CO_*) at the weather station of a cell, from the
+	/// first grid time to the time of the cell. The difference of two of these is the exact integral of the bilinear
+	/// interpolant between two times.
+	double antiderivative(int variable, const Cell& cell) const {
+		const size_t n = times.size();
+		const size_t plane = plane_of(variable);
+		const size_t row = plane * stations.size() * n + cell.station_index * n + cell.time_index;
+		const double elapsed = cell.t * (times[cell.time_index + 1] - times[cell.time_index]);
+		const auto along_station = [&](size_t station_row) {
+			const double y1 = value_at(plane, station_row, cell.time_index);
+			const double y2 = value_at(plane, station_row + 1, cell.time_index + 1);
+			const double integral = is_quantized() ? checkpointed_integral(plane, station_row) : integrals[station_row];
+			return integral + elapsed * (y1 + ((1.0 - cell.t) * y1 + cell.t * y2)) / 2.0;
+		};
+		return (1.0 - cell.u) * along_station(row) + cell.u * along_station(row + n);
+	}
+
+	/// @brief Interpolates every weather variable at many queries. Queries sorted by time walk the grid like a
+	/// cursor; the blend runs variable by variable over contiguous arrays so it vectorizes.
+	/// Results are bit-identical to interpolate().
+	/// @param out one array per variable (race_config::weather::CO_*), each with room for every query; the arrays of
+	/// variables the grid does not have are left alone (and may be null)
+	void interpolate_batch(std::span<const double> query_times, std::span<const double> query_stations,
+		const std::array<double*, race_config::weather::NUM_WEATHER_VARIABLES>& out) const;
+
+	double get_start_time() const {
+		return times.front();
+	}
+	double get_end_time() const {
+		return times.back();
+	}
+	std::span<const double> get_times() const {
+		return times;
+	}
+	std::span<const double> get_stations() const {
+		return stations;
+	}
+
+	/// @brief The value stored at a grid node
+	double at(int variable, size_t station_index, size_t time_index) const {
+		const size_t plane = plane_of(variable);
+		return value_at(plane, (plane * stations.size() + station_index) * times.size() + time_index, time_index);
+	}
+
+   private:
+	/// @return where the variable is stored among the variables of the grid
+	size_t plane_of(int variable) const {
+		return planes[static_cast<size_t>(variable)];
+	}
+	/// @brief Fills planes in from variables
+	void assign_planes(WeatherVariables loaded_variables);
+
+	/// @return the value at a flat [plane][station][time] index, whose time index is @p time
+	double value_at(size_t plane, size_t index, size_t time) const {
+		if (!is_quantized()) {
+			return values[index];
+		}
+		const size_t scale = plane * times.size() + time;
+		return value_offsets[scale] + value_scales[scale] * quantized_values[index];
+	}
+
+	/// @return the running integral at a flat [plane][station][time] index of a quantized grid: the checkpoint before
+	/// it plus the trapezoids since
+	double checkpointed_integral(size_t plane, size_t index) const;
+
+	Cell make_cell(size_t time_index, size_t station_index, double time, double weather_station) const;
+
+	/// The arrays of a grid built in this process
+	struct Arrays {
+		std::vector<double> times;
+		std::vector<double> stations;
+		std::vector<double> values;
+		std::vector<double> integrals;
+		std::vector<std::uint16_t> quantized_values;
+		std::vector<double> value_offsets;
+		std::vector<double> value_scales;
+		std::vector<double> checkpoints;
+	};
+
+	/// @brief Points the grid at arrays built in this process, and keeps them alive
+	void adopt(std::shared_ptr<const Arrays> arrays);
+
+	/// @brief Recomputes the running integrals from a time index onwards (everything before it is unchanged)
+	static void build_integrals(Arrays& arrays, size_t first_time_index);
+
+	/// @brief Quantizes @p count consecutive times of a full precision grid with the same weather stations and
+	/// variables into the quantized arrays, from time index @p first_time of the arrays onwards
+	static void quantize_times(Arrays& arrays, size_t first_time, const WeatherGrid& source, size_t source_first_time,
+		size_t count);
+	/// @brief Recomputes the running integral checkpoints of quantized arrays from their levels, so they agree with
+	/// the interpolant
+	static void build_checkpoints(Arrays& arrays);
+
+	/// the grid abscissas (Unix time), strictly increasing
+	std::span<const double> times;
+	/// the grid ordinates (weather station ids), strictly increasing
+	std::span<const double> stations;
+	/// the weather variables stored in the grid
+	WeatherVariables variables;
+	/// the plane of every stored variable, indexed by CO_*
+	std::array<size_t, race_config::weather::NUM_WEATHER_VARIABLES> planes = {};
+	/// layout: [plane][station][time]
+	std::span<const double> values;
+	/// the integral of each station row over time from times[0] to every grid time (trapezoids), same layout as values
+	std::span<const double> integrals;
+
+	/// the grid times between two running integral checkpoints of a quantized grid
+	static constexpr size_t CHECKPOINT_INTERVAL = 32;
+	/// replace values and integrals in a quantized grid: layout [plane][station][time]
+	std::span<const std::uint16_t> quantized_values;
+	/// value = offset + scale * quantized value, with the offset and scale at the grid time of the value; layout
+	/// [plane][time]
+	std::span<const double> value_offsets;
+	std::span<const double> value_scales;
+	/// the running integral at every CHECKPOINT_INTERVAL-th grid time, layout [plane][station][checkpoint]
+	std::span<const double> checkpoints;
+
+	/// what the arrays above point into: an Arrays, or a shared memory mapping
+	std::shared_ptr<const void> storage;
+};
+
+#endif  // MINISIM_WEATHERGRID_H
@@ -0,0 +1,718 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "RaceConfig/RaceConfigConstants.h"
+#include "RaceConfig/RaceSchedule/RaceSchedule.h"
+#include "Weather.h"
+#include "WeatherCursor.h"
+
+using Catch::Matchers::WithinAbs;
+
+using namespace race_config::weather;
+
+namespace {
+	constexpr double EPSILON = 1e-9;
+	constexpr double START_TIME = 1187913600.0;
+	constexpr double HOUR = 3600.0;
+	constexpr int NUM_STATIONS = 23;
+
+	/// A weather variable that is linear in both station and time, so bilinear interpolation is exact
+	double linear_value(int variable, double weather_station, double time, double offset = 0.0) {
+		return 100.0 * variable + 10.0 * weather_station + (time - START_TIME) / HOUR + offset;
+	}
+
+	std::vector<WeatherForecastRow> make_slab(int first_hour, int last_hour, double offset = 0.0) {
+		std::vector<WeatherForecastRow> rows;
+		for (int station = 1; station <= NUM_STATIONS; ++station) {
+			for (int hour = first_hour; hour <= last_hour; ++hour) {
+				WeatherForecastRow row = {};
+				row.weather_station = station;
+				row.time = START_TIME + hour * HOUR;
+				for (int variable = 0; variable < NUM_WEATHER_VARIABLES; ++variable) {
+					row.values[static_cast<size_t>(variable)] = linear_value(variable, station, row.time, offset);
+				}
+				rows.push_back(row);
+			}
+		}
+		return rows;
+	}
+
+	/// Writes forecast rows as a weather file, grouped by weather station like the real ones
+	void write_weather_file(const std::filesystem::path& path, const std::vector<WeatherForecastRow>& rows) {
+		std::ofstream csv(path);
+		csv << CN_WEATHER_STATION << ',' << CN_UNIX_PERIOD << ',' << CN_DHI << ',' << CN_DNI << ',' << CN_GHI << ','
+			<< CN_WIND_VELOCITY_NS << ',' << CN_WIND_VELOCITY_EW << ',' << CN_AIR_TEMPERATURE_2M << ','
+			<< CN_SURFACE_PRESSURE << ',' << CN_AIR_DENSITY << '\n';
+		csv.precision(17);
+		for (const auto& row : rows) {
+			csv << row.weather_station << ',' << row.time;
+			for (const double value : row.values) {
+				csv << ',' << value;
+			}
+			csv << '\n';
+		}
+	}
+}  // namespace
+
+TEST_CASE("Weather: update", "[Weather]") {
+	Weather weather;
+	REQUIRE(weather.update(make_slab(0, 23)) == 1);
+
+	SECTION("Interpolates the initial slab") {
+		const double time = START_TIME + 5.5 * HOUR;
+		const WeatherDataPoint data = weather.get_weather_at(4.25, time);
+		REQUIRE_THAT(data.irradiance, WithinAbs(linear_value(CO_GHI, 4.25, time), EPSILON));
+		REQUIRE_THAT(data.air_density, WithinAbs(linear_value(CO_AIR_DENSITY, 4.25, time), EPSILON));
+		REQUIRE_THAT(data.wind.get_east_west(), WithinAbs(linear_value(CO_WIND_VELOCITY_EW, 4.25, time), EPSILON));
+	}
+
+	SECTION("Appends a slab after the end") {
+		REQUIRE(weather.update(make_slab(24, 30)) == 2);
+		const double time = START_TIME + 27.25 * HOUR;
+		REQUIRE_THAT(weather.get_weather_at(12.0, time).irradiance, WithinAbs(linear_value(CO_GHI, 12.0, time), EPSILON));
+	}
+
+	SECTION("Overwrites an existing slab and leaves the rest alone") {
+		const Weather before = weather;
+		constexpr double offset = 50.0;
+		weather.update(make_slab(10, 12, offset));
+
+		const double inside = START_TIME + 11.0 * HOUR;
+		const double outside = START_TIME + 3.0 * HOUR;
+		REQUIRE_THAT(
+			weather.get_weather_at(7.0, inside).pressure, WithinAbs(linear_value(CO_SURFACE_PRESSURE, 7.0, inside, offset), EPSILON));
+		REQUIRE(weather.get_weather_at(7.0, outside).pressure == before.get_weather_at(7.0, outside).pressure);
+		REQUIRE(before.get_version() == 1);
+		REQUIRE(weather.get_version() == 2);
+	}
+
+	SECTION("Replaces every existing time inside of a coarser slab") {
+		constexpr double offset = 50.0;
+		// Only every other hour: the old hours in between must not survive the update
+		auto slab = make_slab(10, 14, offset);
+		std::erase_if(slab, [](const WeatherForecastRow& row) {
+			return static_cast<int>(std::lround((row.time - START_TIME) / HOUR)) % 2 == 1;
+		});
+		weather.update(slab);
+
+		for (const double hour : {10.0, 11.0, 12.5, 13.0, 14.0}) {
+			const double time = START_TIME + hour * HOUR;
+			REQUIRE_THAT(weather.get_weather_at(7.0, time).irradiance,
+				WithinAbs(linear_value(CO_GHI, 7.0, time, offset), EPSILON));
+		}
+		const double after = START_TIME + 15.0 * HOUR;
+		REQUIRE_THAT(
+			weather.get_weather_at(7.0, after).irradiance, WithinAbs(linear_value(CO_GHI, 7.0, after), EPSILON));
+	}
+
+	SECTION("Rejects incomplete slabs") {
+		auto slab = make_slab(24, 26);
+		slab.pop_back();
+		REQUIRE_THROWS_AS(weather.update(slab), std::invalid_argument);
+		REQUIRE(weather.get_version() == 1);
+	}
+
+	SECTION("Queries keep working while updates are published") {
+		std::atomic<bool> done = false;
+		std::atomic<int> wrong_answers = 0;
+		std::vector<std::thread> readers;
+		for (int reader = 0; reader < 4; ++reader) {
+			readers.emplace_back([&] {
+				const double time = START_TIME + 2.5 * HOUR;
+				while (!done.load()) {
+					const double irradiance = weather.get_weather_at(3.0, time).irradiance;
+					if (std::abs(irradiance - linear_value(CO_GHI, 3.0, time)) > EPSILON) {
+						wrong_answers++;
+					}
+				}
+			});
+		}
+		for (int hour = 24; hour < 64; ++hour) {
+			weather.update(make_slab(hour, hour + 1));
+		}
+		done = true;
+		for (auto& reader : readers) {
+			reader.join();
+		}
+		REQUIRE(wrong_answers == 0);
+		REQUIRE(weather.get_version() == 41);
+	}
+}
+
+TEST_CASE("Weather: update across weather files", "[Weather]") {
+	const std::filesystem::path first_file = std::filesystem::temp_directory_path() / "weather_update_first_test.csv";
+	const std::filesystem::path second_file = std::filesystem::temp_directory_path() / "weather_update_second_test.csv";
+	write_weather_file(first_file, make_slab(10, 23));
+	write_weather_file(second_file, make_slab(30, 47));
+	const std::vector<std::string> weather_files = {first_file.string(), second_file.string()};
+	const WeatherStations weather_stations(std::vector<GeographicalCoordinate>(static_cast<size_t>(NUM_STATIONS)));
+	Weather weather(weather_files, weather_stations);
+	constexpr double offset = 50.0;
+
+	SECTION("Merges a slab starting before the first file into it") {
+		weather.update(make_slab(5, 12, offset));
+		for (const double hour : {5.0, 8.5, 12.0}) {
+			const double time = START_TIME + hour * HOUR;
+			REQUIRE_THAT(weather.get_weather_at(7.0, time).irradiance,
+				WithinAbs(linear_value(CO_GHI, 7.0, time, offset), EPSILON));
+		}
+		const double after = START_TIME + 20.0 * HOUR;
+		REQUIRE_THAT(
+			weather.get_weather_at(7.0, after).irradiance, WithinAbs(linear_value(CO_GHI, 7.0, after), EPSILON));
+	}
+
+	SECTION("Merges a slab between the files into the earlier one") {
+		weather.update(make_slab(25, 28, offset));
+		const double time = START_TIME + 26.0 * HOUR;
+		REQUIRE_THAT(weather.get_weather_at(7.0, time).irradiance,
+			WithinAbs(linear_value(CO_GHI, 7.0, time, offset), EPSILON));
+	}
+
+	SECTION("Rejects a slab crossing into the next file") {
+		const uint64_t version = weather.get_version();
+		REQUIRE_THROWS_AS(weather.update(make_slab(5, 30)), std::invalid_argument);
+		REQUIRE_THROWS_AS(weather.update(make_slab(20, 35)), std::invalid_argument);
+		REQUIRE(weather.get_version() == version);
+	}
+
+	std::filesystem::remove(first_file.string() + ".cache");
+	std::filesystem::remove(second_file.string() + ".cache");
+	std::filesystem::remove(first_file);
+	std::filesystem::remove(second_file);
+}
+
+TEST_CASE("WeatherCursor: matches Weather", "[Weather]") {
+	Weather weather;
+	weather.update(make_slab(0, 47));
+	WeatherCursor cursor(weather);
+
+	const auto require_same = [&](double weather_station, double time) {
+		const WeatherDataPoint expected = weather.get_weather_at(weather_station, time);
+		const WeatherDataPoint actual = cursor.get_weather_at(weather_station, time);
+		REQUIRE(actual.irradiance == expected.irradiance);
+		REQUIRE(actual.air_temp == expected.air_temp);
+		REQUIRE(actual.pressure == expected.pressure);
+		REQUIRE(actual.air_density == expected.air_density);
+		REQUIRE(actual.wind.get_north_south() == expected.wind.get_north_south());
+		REQUIRE(actual.wind.get_east_west() == expected.wind.get_east_west());
+	};
+
+	SECTION("Walking forward in time") {
+		for (double time = START_TIME; time < START_TIME + 49 * HOUR; time += 300.0) {
+			require_same(1.0 + (time - START_TIME) / (48 * HOUR) * (NUM_STATIONS - 1), time);
+		}
+	}
+
+	SECTION("Jumping around") {
+		std::mt19937 generator(7);
+		std::uniform_real_distribution<double> station(0.0, NUM_STATIONS + 1.0);
+		std::uniform_real_distribution<double> time(START_TIME, START_TIME + 50 * HOUR);
+		for (int query = 0; query < 1000; ++query) {
+			require_same(station(generator), time(generator));
+		}
+	}
+
+	SECTION("Keeps the version it was created with") {
+		weather.update(make_slab(10, 12, 50.0));
+		const double time = START_TIME + 11.0 * HOUR;
+		REQUIRE_THAT(cursor.get_weather_at(5.0, time).irradiance, WithinAbs(linear_value(CO_GHI, 5.0, time), EPSILON));
+	}
+}
+
+TEST_CASE("Weather: get_weather_batch", "[Weather]") {
+	Weather weather;
+	weather.update(make_slab(0, 47));
+
+	std::mt19937 generator(11);
+	std::uniform_real_distribution<double> station(0.0, NUM_STATIONS + 1.0);
+	std::uniform_real_distribution<double> time(START_TIME, START_TIME + 50 * HOUR);
+	std::vector<double> stations(5000);
+	std::vector<double> times(stations.size());
+	for (size_t query = 0; query < stations.size(); ++query) {
+		stations[query] = station(generator);
+		times[query] = time(generator);
+	}
+
+	const auto require_same = [&](const WeatherBatchOut& out) {
+		for (size_t query = 0; query < stations.size(); ++query) {
+			const WeatherDataPoint expected = weather.get_weather_at(stations[query], times[query]);
+			REQUIRE(out.get(CO_GHI)[query] == expected.irradiance);
+			REQUIRE(out.get(CO_AIR_TEMPERATURE_2M)[query] == expected.air_temp);
+			REQUIRE(out.get(CO_SURFACE_PRESSURE)[query] == expected.pressure);
+			REQUIRE(out.get(CO_AIR_DENSITY)[query] == expected.air_density);
+			REQUIRE(out.get(CO_WIND_VELOCITY_NS)[query] == expected.wind.get_north_south());
+			REQUIRE(out.get(CO_WIND_VELOCITY_EW)[query] == expected.wind.get_east_west());
+		}
+	};
+
+	SECTION("Unsorted queries") {
+		WeatherBatchOut out;
+		weather.get_weather_batch(stations, times, out);
+		REQUIRE(out.get(CO_DHI).size() == stations.size());
+		require_same(out);
+	}
+
+	SECTION("Sorted queries") {
+		std::sort(times.begin(), times.end());
+		WeatherBatchOut out;
+		weather.get_weather_batch(stations, times, out);
+		require_same(out);
+	}
+
+	SECTION("Rejects mismatched queries") {
+		WeatherBatchOut out;
+		times.pop_back();
+		REQUIRE_THROWS_AS(weather.get_weather_batch(stations, times, out), std::invalid_argument);
+	}
+}
+
+TEST_CASE("Weather: exact get_weather_during", "[Weather]") {
+	Weather weather;
+	weather.update(make_slab(0, 47));
+
+	SECTION("The mean of a linear forecast is its value in the middle") {
+		const double start_time = START_TIME + 3.2 * HOUR;
+		const double end_time = START_TIME + 17.9 * HOUR;
+		const WeatherDataPoint mean = weather.get_weather_during(6.5, start_time, end_time, WeatherAveraging::EXACT);
+		const double middle = (start_time + end_time) / 2;
+		REQUIRE_THAT(mean.irradiance, WithinAbs(linear_value(CO_GHI, 6.5, middle), EPSILON));
+		REQUIRE_THAT(mean.air_temp, WithinAbs(linear_value(CO_AIR_TEMPERATURE_2M, 6.5, middle), EPSILON));
+		REQUIRE_THAT(mean.wind.get_north_south(), WithinAbs(linear_value(CO_WIND_VELOCITY_NS, 6.5, middle), EPSILON));
+	}
+
+	SECTION("Matches fine sampling of a bumpy forecast, also after an update") {
+		auto slab = make_slab(10, 20);
+		for (auto& row : slab) {
+			const bool odd_hour = static_cast<long>((row.time - START_TIME) / HOUR) % 2 == 1;
+			row.values[CO_GHI] += odd_hour ? 300.0 * row.weather_station : 0.0;
+		}
+		weather.update(slab);
+
+		// Endpoint means over steps that land on every grid time are exact for a piecewise linear forecast
+		const double start_time = START_TIME + 5.0 * HOUR;
+		const double end_time = START_TIME + 25.0 * HOUR;
+		constexpr double step = 300.0;
+		double sampled = 0.0;
+		for (double time = start_time; time < end_time; time += step) {
+			sampled += weather.get_weather_during(9.3, time, time + step).irradiance * step;
+		}
+		sampled /= end_time - start_time;
+
+		WeatherCursor cursor(weather);
+		REQUIRE_THAT(weather.get_weather_during(9.3, start_time, end_time, WeatherAveraging::EXACT).irradiance,
+			WithinAbs(sampled, 1e-6));
+		REQUIRE_THAT(cursor.get_weather_during(9.3, start_time, end_time, WeatherAveraging::EXACT).irradiance,
+			WithinAbs(sampled, 1e-6));
+	}
+
+	SECTION("An empty interval is a point query") {
+		const double time = START_TIME + 7.7 * HOUR;
+		REQUIRE(weather.get_weather_during(2.2, time, time, WeatherAveraging::EXACT).pressure ==
+				weather.get_weather_at(2.2, time).pressure);
+	}
+}
+
+TEST_CASE("Weather: column projection", "[Weather]") {
+	const std::filesystem::path weather_file = std::filesystem::temp_directory_path() / "weather_projection_test.csv";
+	const std::filesystem::path cache_file = weather_file.string() + ".cache";
+	std::filesystem::remove(cache_file);
+	write_weather_file(weather_file, make_slab(0, 23));
+	const WeatherStations weather_stations(std::vector<GeographicalCoordinate>(static_cast<size_t>(NUM_STATIONS)));
+	const double time = START_TIME + 9.6 * HOUR;
+
+	const auto require_projected = [&](const Weather& weather) {
+		REQUIRE(weather.get_variables() == RACE_WEATHER_VARIABLES);
+		const WeatherDataPoint data = weather.get_weather_at(8.5, time);
+		REQUIRE_THAT(data.irradiance, WithinAbs(linear_value(CO_GHI, 8.5, time), EPSILON));
+		REQUIRE_THAT(data.air_density, WithinAbs(linear_value(CO_AIR_DENSITY, 8.5, time), EPSILON));
+		REQUIRE_THAT(data.wind.get_east_west(), WithinAbs(linear_value(CO_WIND_VELOCITY_EW, 8.5, time), EPSILON));
+		REQUIRE(std::isnan(data.air_temp));
+		REQUIRE(std::isnan(data.pressure));
+		REQUIRE_THROWS_AS(weather.get_variable_at(CO_DNI, 8.5, time), std::invalid_argument);
+
+		WeatherBatchOut out;
+		weather.get_weather_batch(std::vector<double>{8.5}, std::vector<double>{time}, out);
+		REQUIRE(out.get(CO_GHI)[0] == data.irradiance);
+		REQUIRE_THROWS_AS(out.get(CO_AIR_TEMPERATURE_2M), std::invalid_argument);
+	};
+
+	SECTION("Parses only the projected columns") {
+		const Weather weather(weather_file.string(), weather_stations, RACE_WEATHER_VARIABLES);
+		require_projected(weather);
+		REQUIRE_FALSE(std::filesystem::exists(cache_file));
+	}
+
+	SECTION("Matches a full load") {
+		const Weather full(weather_file.string(), weather_stations);
+		REQUIRE(std::filesystem::exists(cache_file));
+		const Weather weather(weather_file.string(), weather_stations, RACE_WEATHER_VARIABLES);
+		require_projected(weather);
+		REQUIRE(weather.get_variable_at(CO_GHI, 8.5, time) == full.get_variable_at(CO_GHI, 8.5, time));
+	}
+
+	std::filesystem::remove(cache_file);
+	std::filesystem::remove(weather_file);
+}
+
+TEST_CASE("Weather: time window", "[Weather]") {
+	const std::filesystem::path weather_file = std::filesystem::temp_directory_path() / "weather_window_test.csv";
+	auto rows = make_slab(0, 47);
+	for (auto& row : rows) {
+		// make the forecast bumpy in time, so a missing grid time would change the interpolation
+		const bool odd_hour = static_cast<long>((row.time - START_TIME) / HOUR) % 2 == 1;
+		row.values[CO_GHI] += odd_hour ? 250.0 : 0.0;
+	}
+	write_weather_file(weather_file, rows);
+	const WeatherStations weather_stations(std::vector<GeographicalCoordinate>(static_cast<size_t>(NUM_STATIONS)));
+
+	const WeatherTimeWindow morning = {.start_time = START_TIME + 10.5 * HOUR, .end_time = START_TIME + 12.0 * HOUR};
+	const WeatherTimeWindow evening = {.start_time = START_TIME + 18.0 * HOUR, .end_time = START_TIME + 20.25 * HOUR};
+	const WeatherTimeWindow window = morning.covering(evening);
+	REQUIRE(window.start_time == morning.start_time);
+	REQUIRE(window.end_time == evening.end_time);
+	REQUIRE(WeatherTimeWindow{}.is_unbounded());
+	REQUIRE_FALSE(window.is_unbounded());
+
+	const Weather windowed(weather_file.string(), weather_stations, window);
+	const Weather full(weather_file.string(), weather_stations, RACE_WEATHER_VARIABLES);
+	for (double time = window.start_time; time <= window.end_time; time += 600.0) {
+		for (double station = 1.0; station <= NUM_STATIONS; station += 0.75) {
+			REQUIRE(windowed.get_weather_at(station, time).irradiance == full.get_weather_at(station, time).irradiance);
+		}
+	}
+	REQUIRE_THAT(windowed.get_weather_during(3.0, window.start_time, window.end_time, WeatherAveraging::EXACT).irradiance,
+		WithinAbs(full.get_weather_during(3.0, window.start_time, window.end_time, WeatherAveraging::EXACT).irradiance,
+			EPSILON));
+	// Far outside of the window the windowed weather only extrapolates
+	const double outside = START_TIME + 30.5 * HOUR;
+	REQUIRE(windowed.get_weather_at(3.0, outside).irradiance != full.get_weather_at(3.0, outside).irradiance);
+	REQUIRE_FALSE(std::filesystem::exists(weather_file.string() + ".cache"));
+
+	SECTION("Windows outside of the file keep the two times nearest to them") {
+		const Weather before(weather_file.string(), weather_stations,
+			{.start_time = START_TIME - 30.0 * HOUR, .end_time = START_TIME - 20.0 * HOUR});
+		const double first_hour = START_TIME + 0.5 * HOUR;
+		REQUIRE(before.get_weather_at(3.0, first_hour).irradiance == full.get_weather_at(3.0, first_hour).irradiance);
+
+		const Weather after(weather_file.string(), weather_stations,
+			{.start_time = START_TIME + 60.0 * HOUR, .end_time = START_TIME + 70.0 * HOUR});
+		for (const double time : {START_TIME + 46.5 * HOUR, START_TIME + 70.0 * HOUR}) {
+			REQUIRE(after.get_weather_at(3.0, time).irradiance == full.get_weather_at(3.0, time).irradiance);
+		}
+	}
+
+	SECTION("Rejects windows that end before they start") {
+		const WeatherTimeWindow backwards = {.start_time = window.end_time, .end_time = window.start_time};
+		REQUIRE_THROWS_AS(Weather(weather_file.string(), weather_stations, backwards), std::invalid_argument);
+		// an empty schedule has no window
+		const WeatherTimeWindow no_window = WeatherTimeWindow::from_schedule(RaceSchedule());
+		REQUIRE_THROWS_AS(Weather(weather_file.string(), weather_stations, no_window), std::invalid_argument);
+	}
+
+	std::filesystem::remove(weather_file);
+}
+
+TEST_CASE("Weather: quantized storage", "[Weather]") {
+	const std::filesystem::path weather_file = std::filesystem::temp_directory_path() / "weather_quantized_test.csv";
+	auto rows = make_slab(0, 99);
+	std::mt19937 generator(7);
+	std::uniform_real_distribution<double> noise(-50.0, 50.0);
+	for (auto& row : rows) {
+		for (double& value : row.values) {
+			value += noise(generator);
+		}
+	}
+	write_weather_file(weather_file, rows);
+	const WeatherStations weather_stations(std::vector<GeographicalCoordinate>(static_cast<size_t>(NUM_STATIONS)));
+
+	const Weather full(weather_file.string(), weather_stations);
+	Weather quantized(
+		weather_file.string(), weather_stations, WeatherTimeWindow{}, ALL_WEATHER_VARIABLES, WeatherStorage::QUANTIZED);
+	REQUIRE(quantized.get_storage() == WeatherStorage::QUANTIZED);
+	REQUIRE(full.get_max_quantization_error(CO_GHI) == 0.0);
+
+	SECTION("Every query is within the documented error") {
+		for (int variable = 0; variable < NUM_WEATHER_VARIABLES; ++variable) {
+			const double max_error = quantized.get_max_quantization_error(variable);
+			REQUIRE(max_error > 0.0);
+			REQUIRE(max_error < 0.01);
+			for (double time = START_TIME; time <= START_TIME + 99.0 * HOUR; time += 1234.5) {
+				for (double station = 1.0; station <= NUM_STATIONS; station += 1.3) {
+					REQUIRE_THAT(quantized.get_variable_at(variable, station, time),
+						WithinAbs(full.get_variable_at(variable, station, time), max_error + EPSILON));
+				}
+			}
+		}
+
+		// The running integrals are checkpointed, so check intervals that end far past a checkpoint
+		const double max_error = quantized.get_max_quantization_error(CO_GHI);
+		const double start_time = START_TIME + 0.2 * HOUR;
+		for (double end_time = START_TIME + 0.5 * HOUR; end_time <= START_TIME + 99.0 * HOUR; end_time += 7.3 * HOUR) {
+			REQUIRE_THAT(quantized.get_weather_during(4.4, start_time, end_time, WeatherAveraging::EXACT).irradiance,
+				WithinAbs(full.get_weather_during(4.4, start_time, end_time, WeatherAveraging::EXACT).irradiance,
+					max_error + EPSILON));
+		}
+	}
+
+	SECTION("Batches match point queries") {
+		std::vector<double> stations;
+		std::vector<double> times;
+		for (int query = 0; query < 1000; ++query) {
+			stations.push_back(1.0 + (query * 7 % 220) / 10.0);
+			times.push_back(START_TIME + query * 331.0);
+		}
+		WeatherBatchOut out;
+		quantized.get_weather_batch(stations, times, out);
+		for (size_t query = 0; query < stations.size(); ++query) {
+			REQUIRE(out.get(CO_GHI)[query] == quantized.get_weather_at(stations[query], times[query]).irradiance);
+		}
+	}
+
+	SECTION("Updates stay quantized") {
+		quantized.update(make_slab(40, 60, 2000.0));
+		REQUIRE(quantized.get_storage() == WeatherStorage::QUANTIZED);
+		const double time = START_TIME + 50.5 * HOUR;
+		REQUIRE_THAT(quantized.get_variable_at(CO_GHI, 5.0, time),
+			WithinAbs(linear_value(CO_GHI, 5.0, time, 2000.0), quantized.get_max_quantization_error(CO_GHI) + EPSILON));
+	}
+
+	SECTION("Updates that widen the range leave the error of the other values alone") {
+		std::array<double, NUM_WEATHER_VARIABLES> max_errors = {};
+		for (int variable = 0; variable < NUM_WEATHER_VARIABLES; ++variable) {
+			max_errors[static_cast<size_t>(variable)] = quantized.get_max_quantization_error(variable);
+		}
+		quantized.update(make_slab(40, 45, 2000.0));
+		quantized.update(make_slab(50, 52, -3000.0));
+		quantized.update(make_slab(20, 21, 10000.0));
+		quantized.update(make_slab(41, 44, -8000.0));
+
+		for (const auto& row : rows) {
+			const double hour = (row.time - START_TIME) / HOUR;
+			if ((hour >= 20.0 && hour <= 21.0) || (hour >= 40.0 && hour <= 45.0) || (hour >= 50.0 && hour <= 52.0)) {
+				continue;
+			}
+			for (int variable = 0; variable < NUM_WEATHER_VARIABLES; ++variable) {
+				const auto index = static_cast<size_t>(variable);
+				REQUIRE_THAT(quantized.get_variable_at(variable, row.weather_station, row.time),
+					WithinAbs(row.values[index], max_errors[index] + EPSILON));
+			}
+		}
+		const double time = START_TIME + 42.0 * HOUR;
+		const double max_error = quantized.get_max_quantization_error(CO_GHI);
+		REQUIRE_THAT(quantized.get_variable_at(CO_GHI, 5.0, time),
+			WithinAbs(linear_value(CO_GHI, 5.0, time, -8000.0), max_error + EPSILON));
+	}
+
+	std::filesystem::remove(weather_file.string() + ".cache");
+	std::filesystem::remove(weather_file);
+}
+
+TEST_CASE("Weather: shared memory", "[Weather]") {
+	const std::filesystem::path shared_file = std::filesystem::temp_directory_path() / "weather_shared_test.bin";
+	Weather weather;
+	weather.update(make_slab(0, 47));
+	weather.update(make_slab(10, 20, 3.0));
+	weather.write_shared(shared_file.string());
+
+	SECTION("Attached weather answers exactly like the original") {
+		const Weather attached = Weather::attach_shared(shared_file.string());
+		REQUIRE(attached.get_variables() == weather.get_variables());
+		for (double time = START_TIME; time <= START_TIME + 47.0 * HOUR; time += 1000.0) {
+			REQUIRE(attached.get_weather_at(7.25, time).irradiance == weather.get_weather_at(7.25, time).irradiance);
+			REQUIRE(attached.get_weather_during(7.25, START_TIME, time, WeatherAveraging::EXACT).pressure ==
+					weather.get_weather_during(7.25, START_TIME, time, WeatherAveraging::EXACT).pressure);
+		}
+	}
+
+	SECTION("Attached weather outlives the file and can be updated") {
+		Weather attached = Weather::attach_shared(shared_file.string());
+		std::filesystem::remove(shared_file);
+		const double time = START_TIME + 30.5 * HOUR;
+		attached.update(make_slab(30, 31, 1.0));
+		REQUIRE_THAT(attached.get_weather_at(4.0, time).irradiance,
+			WithinAbs(linear_value(CO_GHI, 4.0, time, 1.0), EPSILON));
+		REQUIRE(weather.get_weather_at(4.0, time).irradiance != attached.get_weather_at(4.0, time).irradiance);
+	}
+
+	SECTION("Truncated files are rejected") {
+		std::filesystem::resize_file(shared_file, std::filesystem::file_size(shared_file) / 2);
+		REQUIRE_THROWS_AS(Weather::attach_shared(shared_file.string()), std::invalid_argument);
+		REQUIRE_THROWS_AS(Weather::attach_shared(shared_file.string() + ".missing"), std::runtime_error);
+	}
+
+	SECTION("Headers that do not match the weather data are rejected") {
+		const auto patch_header = [&](std::streamoff offset, std::uint64_t value) {
+			std::fstream file(shared_file, std::ios::binary | std::ios::in | std::ios::out);
+			file.seekp(offset);
+			file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+		};
+		// the header is the magic, then the format version, number of grids, weather groups, variables and storage
+		constexpr std::streamoff num_weather_groups_offset = 24;
+		constexpr std::streamoff variables_offset = 32;
+		constexpr std::streamoff storage_offset = 40;
+		const std::vector<std::pair<std::streamoff, std::uint64_t>> patches = {
+			{num_weather_groups_offset, NUM_STATIONS + 1},
+			{variables_offset, RACE_WEATHER_VARIABLES.to_ullong()},
+			{storage_offset, static_cast<std::uint64_t>(WeatherStorage::QUANTIZED)},
+		};
+		for (const auto& [offset, value] : patches) {
+			weather.write_shared(shared_file.string());
+			patch_header(offset, value);
+			REQUIRE_THROWS_AS(Weather::attach_shared(shared_file.string()), std::invalid_argument);
+		}
+	}
+
+	SECTION("Attaches only to weather data loaded from the same source") {
+		const std::filesystem::path weather_file = std::filesystem::temp_directory_path() / "weather_source_test.csv";
+		write_weather_file(weather_file, make_slab(0, 3));
+		const WeatherTimeWindow window = {.start_time = START_TIME, .end_time = START_TIME + HOUR};
+		const WeatherSource source = WeatherSource::of(weather_file.string(), window);
+		weather.write_shared(shared_file.string(), source);
+
+		const std::optional<Weather> attached = Weather::attach_shared(shared_file.string(), source);
+		REQUIRE(attached.has_value());
+		const double time = START_TIME + 0.5 * HOUR;
+		REQUIRE(attached->get_variable_at(CO_GHI, 7.25, time) == weather.get_variable_at(CO_GHI, 7.25, time));
+		const WeatherSource other_window = WeatherSource::of(weather_file.string(), WeatherTimeWindow{});
+		REQUIRE_FALSE(Weather::attach_shared(shared_file.string(), other_window).has_value());
+		// the weather file changed since the shared weather was written
+		const auto modified = std::filesystem::last_write_time(weather_file) + std::chrono::seconds(1);
+		std::filesystem::last_write_time(weather_file, modified);
+		const WeatherSource newer_file = WeatherSource::of(weather_file.string(), window);
+		REQUIRE_FALSE(Weather::attach_shared(shared_file.string(), newer_file).has_value());
+
+		// a file that cannot be attached is as stale as one of another source
+		REQUIRE_FALSE(Weather::attach_shared(shared_file.string() + ".missing", source).has_value());
+		std::filesystem::resize_file(shared_file, std::filesystem::file_size(shared_file) / 2);
+		REQUIRE_FALSE(Weather::attach_shared(shared_file.string(), source).has_value());
+		weather.write_shared(shared_file.string(), source);
+		{
+			// the format version follows the magic
+			std::fstream file(shared_file, std::ios::binary | std::ios::in | std::ios::out);
+			file.seekp(8);
+			const std::uint64_t old_format_version = 1;
+			file.write(reinterpret_cast<const char*>(&old_format_version), sizeof(old_format_version));
+		}
+		REQUIRE_FALSE(Weather::attach_shared(shared_file.string(), source).has_value());
+		std::filesystem::remove(weather_file);
+	}
+
+	std::filesystem::remove(shared_file);
+}
+
+TEST_CASE("Weather: concurrent queries", "[Weather]") {
+	// Build with -DENABLE_TSAN=ON to also check this for data races
+	Weather weather;
+	weather.update(make_slab(0, 47));
+	Weather other = weather;
+	other.update(make_slab(0, 47, 5.0));
+
+	std::vector<double> stations;
+	std::vector<double> times;
+	std::mt19937 generator(11);
+	std::uniform_real_distribution<double> station_distribution(1.0, NUM_STATIONS);
+	std::uniform_real_distribution<double> time_distribution(START_TIME, START_TIME + 47.0 * HOUR);
+	for (int query = 0; query < 2000; ++query) {
+		stations.push_back(station_distribution(generator));
+		times.push_back(time_distribution(generator));
+	}
+
+	struct Results {
+		std::vector<double> irradiance;
+		std::vector<double> other_irradiance;
+		std::vector<double> mean_pressure;
+		WeatherBatchOut batch;
+	};
+	const auto run_queries = [&](Results& results) {
+		for (size_t query = 0; query < times.size(); ++query) {
+			// alternating between two Weathers evicts and refills the per-thread snapshot caches
+			results.irradiance.push_back(weather.get_weather_at(stations[query], times[query]).irradiance);
+			results.other_irradiance.push_back(other.get_weather_at(stations[query], times[query]).irradiance);
+			results.mean_pressure.push_back(
+				weather.get_weather_during(stations[query], START_TIME, times[query], WeatherAveraging::EXACT).pressure);
+		}
+		weather.get_weather_batch(stations, times, results.batch);
+	};
+
+	Results serial;
+	run_queries(serial);
+
+	constexpr int num_threads = 8;
+	std::vector<Results> concurrent(num_threads);
+	std::vector<std::thread> threads;
+	for (int thread = 0; thread < num_threads; ++thread) {
+		threads.emplace_back(run_queries, std::ref(concurrent[static_cast<size_t>(thread)]));
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	for (const auto& results : concurrent) {
+		REQUIRE(results.irradiance == serial.irradiance);
+		REQUIRE(results.other_irradiance == serial.other_irradiance);
+		REQUIRE(results.mean_pressure == serial.mean_pressure);
+		for (int variable = 0; variable < NUM_WEATHER_VARIABLES; ++variable) {
+			REQUIRE(std::equal(results.batch.get(variable).begin(), results.batch.get(variable).end(),
+				serial.batch.get(variable).begin(), serial.batch.get(variable).end()));
+		}
+	}
+}
+
+TEST_CASE("Weather: per-thread snapshot caches", "[Weather]") {
+	SECTION("Answer right when more Weathers are queried in turn than the cache holds") {
+		constexpr int num_weathers = 20;
+		std::vector<Weather> weathers(num_weathers);
+		for (int index = 0; index < num_weathers; ++index) {
+			weathers[static_cast<size_t>(index)].update(make_slab(0, 3, index));
+		}
+		const double time = START_TIME + 1.5 * HOUR;
+		for (int round = 0; round < 3; ++round) {
+			for (int index = 0; index < num_weathers; ++index) {
+				REQUIRE_THAT(weathers[static_cast<size_t>(index)].get_variable_at(CO_GHI, 2.0, time),
+					WithinAbs(linear_value(CO_GHI, 2.0, time, index), EPSILON));
+			}
+		}
+	}
+
+	SECTION("Release the weather data of destroyed Weathers") {
+		const std::filesystem::path shared_file = std::filesystem::temp_directory_path() / "weather_release_test.bin";
+		const auto is_mapped = [&shared_file] {
+			std::ifstream maps("/proc/self/maps");
+			std::string line;
+			while (std::getline(maps, line)) {
+				if (line.find(shared_file.filename().string()) != std::string::npos) {
+					return true;
+				}
+			}
+			return false;
+		};
+		Weather weather;
+		weather.update(make_slab(0, 3));
+		weather.write_shared(shared_file.string());
+		{
+			const Weather attached = Weather::attach_shared(shared_file.string());
+			attached.get_weather_at(2.0, START_TIME);
+			REQUIRE(is_mapped());
+		}
+		// the next query of this thread releases the snapshot it cached of the attached weather
+		weather.get_weather_at(2.0, START_TIME);
+		REQUIRE_FALSE(is_mapped());
+		std::filesystem::remove(shared_file);
+	}
+}
@@ -2,39 +2,39 @@
 
 #include "RaceSegmentRunner/RaceSegmentRunner.h"
 #include "SolarCar/Battery/BatteryState.h"
+#include "Tools/Metrics.h"
+#include "Tools/PerfCounters.h"
+#include "Tools/Trace.h"
 
-constexpr double STATIC_CHARGING_TIME_INCREMENT = 300.0;   
 constexpr double CHECKPOINT_DURATION = 1800.0;             
 
 namespace RaceRunner {
 
 double calculate_static_charging_gain(
 	const SolarCar& car, const Weather& weather, double weather_station, double start_time, double end_time) {
+	WeatherCursor weather_cursor(weather);
+	return calculate_static_charging_gain(car, weather_cursor, weather_station, start_time, end_time);
+}
 
-	double total_energy = 0.0;   
-
-	 
-	for (double current_time = start_time; current_time < end_time; current_time += STATIC_CHARGING_TIME_INCREMENT) {
-		double time_end = std::min(current_time + STATIC_CHARGING_TIME_INCREMENT, end_time);
-		double time_delta = time_end - current_time;
-
-		 
-		WeatherDataPoint weather_data = weather.get_weather_during(weather_station, current_time, time_end);
-
-		 
-		 
-		double power = car.array.power_in(weather_data.irradiance);
-
-		 
-		double energy = power * time_delta / 3600.0;
-		total_energy += energy;
+double calculate_static_charging_gain(
+	const SolarCar& car, WeatherCursor& weather, double weather_station, double start_time, double end_time) {
+	MINISIM_TIME_SCOPE("race_runner.calculate_static_charging_gain");
+	if (end_time <= start_time) {
+		return 0.0;
 	}
 
-	return total_energy;
+	// The array power is linear in irradiance, so the mean irradiance over the whole window gives the exact energy
+	const WeatherDataPoint weather_data =
+		weather.get_weather_during(weather_station, start_time, end_time, WeatherAveraging::EXACT);
+	const double power = car.array.power_in(weather_data.irradiance);
+	return power * (end_time - start_time) / 3600.0;
 }
 
 std::optional<double> calculate_racetime(
 	const SolarCar& car, const Route& route, const Weather& weather, const RaceSchedule& schedule, double speed) {
+	MINISIM_TIME_SCOPE("race_runner.calculate_racetime");
+	MINISIM_TRACE_SCOPE_ARG("race_runner.calculate_racetime", "speed", speed);
+	MINISIM_PERF_REGION(perf_region, "race_runner.calculate_racetime");
 
 	 
 	BatteryState battery_state(car.battery.get_capacity());   
@@ -42,6 +42,9 @@ std::optional<double> calculate_racetime(
 	 
 	RaceSegmentRunner runner(car);
 
+	// The race only moves forward in time, so every weather query starts from the cell of the previous one
+	WeatherCursor weather_cursor(weather);
+
 	double total_racetime = 0.0;   
 	size_t current_segment_index = 0;
 	const size_t total_segments = route.get_num_segments();
@@ -51,6 +54,7 @@ std::optional<double> calculate_racetime(
 	size_t current_day = 0;
 	const SingleDaySchedule& day_schedule = schedule[current_day];
 	double current_time = day_schedule.race_start_time;
+	MINISIM_TRACE_SPAN(day_span, "race_runner.day", "day", current_day);
 
 	while (current_segment_index < total_segments) {
 		const RouteSegment& segment = route.get_segment(current_segment_index);
@@ -64,10 +68,11 @@ std::optional<double> calculate_racetime(
 		if (current_time >= today.race_end_time) {
 			 
 			double evening_charging_gain = calculate_static_charging_gain(
-				car, weather, segment.weather_station,
+				car, weather_cursor, segment.weather_station,
 				today.evening_charging_start_time, today.evening_charging_end_time
 			);
 			battery_state.update_energy_remaining(evening_charging_gain);
+			MINISIM_PERF_WORK(perf_region, 0, 1);
 
 			 
 			current_day++;
@@ -75,15 +80,17 @@ std::optional<double> calculate_racetime(
 				 
 				return std::nullopt;
 			}
+			MINISIM_TRACE_NEXT(day_span, current_day);
 
 			const SingleDaySchedule& tomorrow = schedule[current_day];
 
 			 
 			double morning_charging_gain = calculate_static_charging_gain(
-				car, weather, segment.weather_station,
+				car, weather_cursor, segment.weather_station,
 				tomorrow.morning_charging_start_time, tomorrow.morning_charging_end_time
 			);
 			battery_state.update_energy_remaining(morning_charging_gain);
+			MINISIM_PERF_WORK(perf_region, 0, 1);
 
 			 
 			current_time = tomorrow.race_start_time;
@@ -106,9 +113,10 @@ std::optional<double> calculate_racetime(
 		}
 
 		 
-		WeatherDataPoint weather_data = weather.get_weather_during(
+		WeatherDataPoint weather_data = weather_cursor.get_weather_during(
 			segment.weather_station, current_time, segment_end_time
 		);
+		MINISIM_PERF_WORK(perf_region, 1, 1);
 
 		 
 		double state_of_charge = car.battery.state_of_charge(battery_state.get_energy_remaining());
@@ -148,10 +156,11 @@ std::optional<double> calculate_racetime(
 				double checkpoint_end = current_time + CHECKPOINT_DURATION;
 
 				double checkpoint_energy = calculate_static_charging_gain(
-					car, weather, segment.weather_station,
+					car, weather_cursor, segment.weather_station,
 					checkpoint_start, checkpoint_end
 				);
 				battery_state.update_energy_remaining(checkpoint_energy);
+				MINISIM_PERF_WORK(perf_region, 0, 1);
 
 				total_racetime += CHECKPOINT_DURATION;
 				current_time = checkpoint_end;
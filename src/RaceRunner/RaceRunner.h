@@ -6,6 +6,7 @@
 #include "RaceConfig/RaceSchedule/RaceSchedule.h"
 #include "RaceConfig/Route/Route.h"
 #include "RaceConfig/Weather/Weather.h"
+#include "RaceConfig/Weather/WeatherCursor.h"
 #include "SolarCar/SolarCar.h"
 
 namespace RaceRunner {
@@ -15,8 +16,8 @@ namespace RaceRunner {
 	/// This is going to be used when we reach a checkpoint, are charging at the beginning of the day (before racing
 	/// begins), or are charging at the end of the day (after racing ends).
 	///
-	/// @note This should use time increments of 5 minutes (or 300 seconds). Every 300 seconds,
-	/// weather data will be resampled to stretch calculations.
+	/// @note The irradiance is averaged exactly over the whole charging window (WeatherAveraging::EXACT), so the cost
+	/// does not depend on how long the window is.
 	///
 	/// @requires start_time < end_time.
 	///
@@ -29,6 +30,10 @@ namespace RaceRunner {
 	double calculate_static_charging_gain(
 		const SolarCar& car, const Weather& weather, double weather_station, double start_time, double end_time);
 
+	/// @brief Same as above, but reads the weather through a cursor that the caller keeps between calls
+	double calculate_static_charging_gain(
+		const SolarCar& car, WeatherCursor& weather, double weather_station, double start_time, double end_time);
+
 	/// @brief Calculates the total racetime of a race with the given parameters, traveling at a constant speed.
 	///
 	/// Each Race Day is divided into up to four stages:
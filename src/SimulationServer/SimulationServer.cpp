@@ -0,0 +1,610 @@
+#include "SimulationServer.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ConfigFile/ConfigSchema.h"
+#include "Optimizer/Optimizer.h"
+#include "RaceConfig/RaceSchedule/RaceSchedule.h"
+#include "RaceConfig/Route/Route.h"
+#include "RaceConfig/Weather/Weather.h"
+#include "RaceConfig/WeatherStations/WeatherStations.h"
+#include "SolarCar/SolarCar.h"
+#include "Tools/Json.h"
+#include "Tools/Trace.h"
+
+namespace {
+	constexpr auto RELOAD_INTERVAL = std::chrono::seconds(1);
+	/// how often the serving thread checks for a stop signal that another thread received
+	constexpr auto STOP_CHECK_INTERVAL = std::chrono::milliseconds(200);
+	/// a connection sending a longer line than this is closed
+	constexpr size_t MAX_REQUEST_BYTES = size_t{1} << 20;
+	/// a client that does not read its answers for this long is disconnected
+	constexpr timeval SEND_TIMEOUT = {.tv_sec = 10, .tv_usec = 0};
+	constexpr int LISTEN_BACKLOG = 64;
+
+	volatile std::sig_atomic_t stop_requested = 0;
+
+	void request_stop(int /*signal*/) {
+		stop_requested = 1;
+	}
+
+	std::optional<std::filesystem::file_time_type> modified_time(const std::string& file) {
+		std::error_code error;
+		const auto time = std::filesystem::last_write_time(file, error);
+		return error ? std::nullopt : std::make_optional(time);
+	}
+
+	/// @return what @p load returns
+	/// @throws std::invalid_argument naming the file, if @p load throws
+	template <typename Load>
+	auto load_file(const std::string& file, const Load& load) {
+		try {
+			return load();
+		} catch (const std::exception& error) {
+			throw std::invalid_argument(file + ": " + error.what());
+		}
+	}
+
+	/// @brief Replaces numbers of a car config by the numbers of a request's "car" object
+	void override_numbers(toml::table& table, const json::Value::Object& overrides, const std::string& prefix) {
+		for (const auto& [key, value] : overrides) {
+			toml::table* parent = &table;
+			std::string path = prefix;
+			std::string_view rest = key;
+			while (true) {
+				const size_t dot = rest.find('.');
+				const std::string_view part = rest.substr(0, dot);
+				path += path.empty() ? "" : ".";
+				path += part;
+				toml::node* node = parent->get(part);
+				if (node == nullptr) {
+					throw std::invalid_argument("the car has no " + path);
+				}
+				if (dot != std::string_view::npos) {
+					parent = node->as_table();
+					if (parent == nullptr) {
+						throw std::invalid_argument("car " + path + " is not a table");
+					}
+					rest = rest.substr(dot + 1);
+					continue;
+				}
+
+				if (const auto* members = value.get_if<json::Value::Object>()) {
+					toml::table* child = node->as_table();
+					if (child == nullptr) {
+						throw std::invalid_argument("car " + path + " is not a table");
+					}
+					override_numbers(*child, *members, path);
+				} else if (const double* number = value.get_if<double>()) {
+					if (!node->is_number()) {
+						throw std::invalid_argument("car " + path + " is not a number");
+					}
+					parent->insert_or_assign(part, *number);
+				} else {
+					throw std::invalid_argument("car " + path + " must be overridden by a number or an object");
+				}
+				break;
+			}
+		}
+	}
+
+	/// @brief A client: requests are read from it on the serving thread, and answered from the pool
+	class Connection {
+	   public:
+		explicit Connection(int fd) : fd(fd) {}
+		~Connection() {
+			close(fd);
+		}
+		Connection(const Connection&) = delete;
+		Connection& operator=(const Connection&) = delete;
+
+		int get_fd() const {
+			return fd;
+		}
+
+		/// @brief Sends a line, whole even when several threads answer the same client
+		void send_line(std::string line) {
+			line += '\n';
+			const std::lock_guard lock(send_mutex);
+			for (size_t sent = 0; sent < line.size();) {
+				const ssize_t count = send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+				if (count < 0 && errno == EINTR) {
+					continue;
+				}
+				if (count < 0) {
+					// gone or not reading: hang up, so the serving thread drops it too
+					shutdown(fd, SHUT_RDWR);
+					return;
+				}
+				sent += static_cast<size_t>(count);
+			}
+		}
+
+		/// @brief Reads what the client sent, and hands over every complete line
+		/// @return false once the client hung up, or sent a line too long to be a request
+		template <typename OnLine>
+		bool receive(const OnLine& on_line) {
+			std::array<char, 4096> buffer = {};
+			const ssize_t count = recv(fd, buffer.data(), buffer.size(), 0);
+			if (count < 0) {
+				return errno == EINTR || errno == EAGAIN;
+			}
+			if (count == 0) {
+				return false;
+			}
+			unfinished_line.append(buffer.data(), static_cast<size_t>(count));
+
+			size_t start = 0;
+			for (size_t end = 0; (end = unfinished_line.find('\n', start)) != std::string::npos; start = end + 1) {
+				const std::string_view line(unfinished_line.data() + start, end - start);
+				if (line.find_first_not_of(" \t\r") != std::string_view::npos) {
+					on_line(std::string(line));
+				}
+			}
+			unfinished_line.erase(0, start);
+			if (unfinished_line.size() > MAX_REQUEST_BYTES) {
+				send_line(R"({"id": null, "status": "error", "error": "request too long"})");
+				return false;
+			}
+			return true;
+		}
+
+	   private:
+		const int fd;
+		std::mutex send_mutex;
+		/// only used by the serving thread
+		std::string unfinished_line;
+	};
+
+	struct Request {
+		std::shared_ptr<Connection> connection;
+		std::string line;
+	};
+
+	class RequestQueue {
+	   public:
+		void push(Request request) {
+			{
+				const std::lock_guard lock(mutex);
+				requests.push_back(std::move(request));
+			}
+			ready.notify_one();
+		}
+
+		/// @return the next request, or nothing once @p stop is requested
+		std::optional<Request> pop(std::stop_token stop) {
+			std::unique_lock lock(mutex);
+			if (!ready.wait(lock, stop, [&] { return !requests.empty(); })) {
+				return std::nullopt;
+			}
+			Request request = std::move(requests.front());
+			requests.pop_front();
+			return request;
+		}
+
+	   private:
+		std::mutex mutex;
+		std::condition_variable_any ready;
+		std::deque<Request> requests;
+	};
+
+	/// @return a listening socket, replacing a socket file left behind by a server that is gone
+	int listen_on(const std::string& path) {
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+			throw std::runtime_error("invalid socket path " + path);
+		}
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		const auto* socket_address = reinterpret_cast<const sockaddr*>(&address);
+
+		const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd < 0) {
+			throw std::runtime_error("could not create a socket: " + std::string(std::strerror(errno)));
+		}
+		std::error_code error;
+		if (std::filesystem::is_socket(path, error)) {
+			if (connect(fd, socket_address, sizeof(address)) == 0) {
+				close(fd);
+				throw std::runtime_error("a server is already listening on " + path);
+			}
+			std::filesystem::remove(path, error);
+		}
+		if (bind(fd, socket_address, sizeof(address)) != 0 || listen(fd, LISTEN_BACKLOG) != 0) {
+			const int bind_error = errno;
+			close(fd);
+			throw std::runtime_error("could not listen on " + path + ": " + std::strerror(bind_error));
+		}
+		return fd;
+	}
+}  // namespace
+
+struct SimulationServer::Resident {
+	std::shared_ptr<const ConfigFile> car_config;
+	std::shared_ptr<const SolarCar> car;
+	std::shared_ptr<const WeatherStations> weather_stations;
+	std::shared_ptr<const Route> route;
+	std::shared_ptr<const Weather> weather;
+	/// by name
+	std::map<std::string, std::shared_ptr<const RaceSchedule>> schedules;
+	/// when each file was last modified, as of its last (re)load
+	std::map<std::string, std::filesystem::file_time_type> loaded_times;
+	/// when each file was last modified, as of the last reload that failed with it changed
+	std::map<std::string, std::filesystem::file_time_type> failed_times;
+
+	/// whether a file of the set being loaded changed
+	using Changed = std::function<bool(const std::string& file)>;
+
+	/// @brief Loads what changed since @p previous was loaded, or everything if there is no @p previous
+	/// @return whether anything was (re)loaded
+	/// @throws std::invalid_argument naming the file, if an input fails to load and there is no @p previous
+	bool load_changed(const ServerConfig& config, const Resident* previous) {
+		bool reloaded = load_all_or_nothing(previous, {config.car_file}, [&](const Changed& /*changed*/) {
+			load_file(config.car_file, [&] {
+				auto new_config = std::make_shared<const ConfigFile>(read_config(config.car_file));
+				car = std::make_shared<const SolarCar>(*new_config);
+				car_config = std::move(new_config);
+			});
+		});
+
+		// The route and the weather are made for the stations, and the weather covers every schedule: they are
+		// reloaded together, so a request never sees a route and weather of different stations, or a schedule
+		// without its weather
+		std::vector<std::string> race_files = {config.weather_stations_file, config.route_file, config.weather_file};
+		for (const auto& [name, file] : config.schedule_files) {
+			race_files.push_back(file);
+		}
+		reloaded |= load_all_or_nothing(previous, race_files, [&](const Changed& changed) {
+			const bool stations_changed = changed(config.weather_stations_file);
+			if (stations_changed) {
+				weather_stations = load_file(config.weather_stations_file,
+					[&] { return std::make_shared<const WeatherStations>(config.weather_stations_file); });
+			}
+			if (stations_changed || changed(config.route_file)) {
+				route = load_file(config.route_file,
+					[&] { return std::make_shared<const Route>(config.route_file, *weather_stations); });
+			}
+			bool schedules_changed = false;
+			for (const auto& [name, file] : config.schedule_files) {
+				if (changed(file)) {
+					schedules[name] = load_file(
+						file, [&, &file = file] { return std::make_shared<const RaceSchedule>(read_config(file)); });
+					schedules_changed = true;
+				}
+			}
+			if (stations_changed || schedules_changed || changed(config.weather_file)) {
+				std::vector<const RaceSchedule*> loaded_schedules;
+				for (const auto& [name, schedule] : schedules) {
+					loaded_schedules.push_back(schedule.get());
+				}
+				weather = load_file(config.weather_file, [&] {
+					return std::make_shared<const Weather>(
+						config.weather_file, *weather_stations, WeatherTimeWindow::from_schedules(loaded_schedules));
+				});
+			}
+		});
+		return reloaded;
+	}
+
+   private:
+	/// @brief Reloads a set of inputs that are made from each other if any of their files changed, all or nothing:
+	/// if one fails, the whole set is kept as it was, and retried once one of its files changes again
+	/// @param load loads the inputs of the files that changed, and what is made from them, into this
+	/// @return whether the set was reloaded
+	bool load_all_or_nothing(const Resident* previous, const std::vector<std::string>& files,
+		const std::function<void(const Changed&)>& load) {
+		std::map<std::string, std::filesystem::file_time_type> changed_times;
+		bool retry = previous == nullptr;
+		for (const std::string& file : files) {
+			const auto time = modified_time(file);
+			if (previous == nullptr) {
+				if (time) {
+					changed_times[file] = *time;
+				}
+				continue;
+			}
+			// A file that is gone (e.g. while it is being replaced) is kept as it was
+			const auto loaded_time = loaded_times.find(file);
+			if (!time || (loaded_time != loaded_times.end() && loaded_time->second == *time)) {
+				continue;
+			}
+			changed_times[file] = *time;
+			const auto failed_time = failed_times.find(file);
+			retry |= failed_time == failed_times.end() || failed_time->second != *time;
+		}
+		if (!retry) {
+			return false;
+		}
+
+		const Resident kept = *this;
+		try {
+			load([&](const std::string& file) { return previous == nullptr || changed_times.contains(file); });
+		} catch (const std::exception& error) {
+			if (previous == nullptr) {
+				throw;
+			}
+			std::cerr << "[SERVE] Could not reload " << error.what() << ", keeping the last version\n";
+			*this = kept;
+			for (const auto& [file, time] : changed_times) {
+				failed_times[file] = time;
+			}
+			return false;
+		}
+		for (const auto& [file, time] : changed_times) {
+			loaded_times[file] = time;
+			failed_times.erase(file);
+		}
+		return true;
+	}
+};
+
+ServerConfig ServerConfig::from_config(const ConfigFile& config, std::string_view config_directory) {
+	const std::filesystem::path directory(config_directory);
+	std::vector<std::string> problems;
+	const auto read = [&](std::string_view key, bool is_path) {
+		const std::optional<std::string> value = config.get<std::string>(key);
+		if (!value) {
+			problems.push_back("missing key " + std::string(key));
+			return std::string();
+		}
+		return is_path ? (directory / *value).lexically_normal().string() : *value;
+	};
+
+	ServerConfig server;
+	server.socket_path = read("socket", true);
+	server.threads = static_cast<size_t>(std::max<int64_t>(0, config.get<int64_t>("threads").value_or(0)));
+	server.car_file = read("car", true);
+	server.weather_file = read("weather", true);
+	server.weather_stations_file = read("stations", true);
+	server.route_file = read("route", true);
+	server.optimizer_type = config.get<std::string>("optimizer").value_or(server.optimizer_type);
+
+	const toml::table* schedules = config.get_toml_force().get_as<toml::table>("schedules");
+	if (schedules != nullptr) {
+		for (const auto& [name, file] : *schedules) {
+			if (const std::optional<std::string> path = file.value<std::string>()) {
+				server.schedule_files.emplace(std::string(name.str()), (directory / *path).lexically_normal().string());
+			} else {
+				problems.push_back("schedules." + std::string(name.str()) + " is not a string");
+			}
+		}
+	}
+	if (server.schedule_files.empty()) {
+		problems.emplace_back("missing key schedules: at least one schedule is needed");
+	}
+	if (!problems.empty()) {
+		throw ConfigSchemaError(std::move(problems));
+	}
+	return server;
+}
+
+ServerConfig ServerConfig::from_path(std::string_view config_file) {
+	const std::optional<ConfigFile> config = ConfigFile::from_path(config_file);
+	if (!config) {
+		throw std::invalid_argument("could not read server config " + std::string(config_file));
+	}
+	return from_config(*config, std::filesystem::path(config_file).parent_path().string());
+}
+
+SimulationServer::SimulationServer(ServerConfig config) : config(std::move(config)) {
+	auto loaded = std::make_shared<Resident>();
+	loaded->load_changed(this->config, nullptr);
+	resident = std::move(loaded);
+}
+
+SimulationServer::~SimulationServer() = default;
+
+std::shared_ptr<const SimulationServer::Resident> SimulationServer::get_resident() const {
+	const std::lock_guard lock(resident_mutex);
+	return resident;
+}
+
+bool SimulationServer::reload_changed() {
+	const std::lock_guard reloading(reload_mutex);
+	const std::shared_ptr<const Resident> previous = get_resident();
+	auto next = std::make_shared<Resident>(*previous);
+	const bool reloaded = next->load_changed(config, previous.get());
+	if (reloaded || next->failed_times != previous->failed_times) {
+		const std::lock_guard lock(resident_mutex);
+		resident = std::move(next);
+	}
+	return reloaded;
+}
+
+std::string SimulationServer::answer(std::string_view request) const {
+	MINISIM_TRACE_SCOPE("simulation_server.answer");
+	json::Value id;
+	std::optional<Optimizer::OptimizationOutput> solution;
+	std::string error;
+	try {
+		const json::Value parsed = json::parse(request);
+		if (parsed.get_if<json::Value::Object>() == nullptr) {
+			throw std::invalid_argument("a request must be a JSON object");
+		}
+		if (const json::Value* request_id = parsed.find("id")) {
+			id = *request_id;
+		}
+		const auto get_string = [&](std::string_view key) -> const std::string* {
+			const json::Value* value = parsed.find(key);
+			if (value != nullptr && value->get_if<std::string>() == nullptr) {
+				throw std::invalid_argument(std::string(key) + " must be a string");
+			}
+			return value != nullptr ? value->get_if<std::string>() : nullptr;
+		};
+
+		// The inputs stay alive until the answer is done, even if they are reloaded meanwhile
+		const std::shared_ptr<const Resident> inputs = get_resident();
+
+		const std::string* schedule_name = get_string("schedule");
+		if (schedule_name == nullptr && inputs->schedules.size() != 1) {
+			throw std::invalid_argument("schedule must be given when the server has several");
+		}
+		const auto schedule =
+			schedule_name != nullptr ? inputs->schedules.find(*schedule_name) : inputs->schedules.begin();
+		if (schedule == inputs->schedules.end()) {
+			throw std::invalid_argument("unknown schedule " + *schedule_name);
+		}
+
+		const std::string* optimizer_type = get_string("optimizer");
+
+		const SolarCar* car = inputs->car.get();
+		std::optional<SolarCar> overridden_car;
+		if (const json::Value* overrides = parsed.find("car")) {
+			const auto* members = overrides->get_if<json::Value::Object>();
+			if (members == nullptr) {
+				throw std::invalid_argument("car must be an object");
+			}
+			toml::table car_table = inputs->car_config->get_toml_force();
+			override_numbers(car_table, *members, "");
+			overridden_car.emplace(ConfigFile(std::move(car_table)));
+			car = &*overridden_car;
+		}
+
+		const std::string& type = optimizer_type != nullptr ? *optimizer_type : config.optimizer_type;
+		try {
+			const std::unique_ptr<const Optimizer> optimizer =
+				Optimizer::create_optimizer(type, *car, *inputs->weather, *inputs->route, *schedule->second);
+			solution = optimizer->optimize_race();
+		} catch (const std::exception& exception) {
+			throw std::runtime_error("optimizer " + type + ": " + exception.what());
+		}
+	} catch (const std::exception& exception) {
+		error = exception.what();
+	}
+
+	std::string line = "{\"id\": ";
+	if (const auto* text = id.get_if<std::string>()) {
+		json::append_string(line, *text);
+	} else if (const double* number = id.get_if<double>()) {
+		json::append_number(line, *number);
+	} else {
+		line += "null";
+	}
+	if (!error.empty()) {
+		line += ", \"status\": \"error\", \"error\": ";
+		json::append_string(line, error);
+	} else if (!solution) {
+		line += ", \"status\": \"unfinished\"";
+	} else {
+		line += ", \"status\": \"finished\", \"race_time\": ";
+		json::append_number(line, solution->racetime);
+		line += ", \"speed\": ";
+		json::append_number(line, solution->speed);
+	}
+	line += '}';
+	return line;
+}
+
+void SimulationServer::serve() {
+	const int listener = listen_on(config.socket_path);
+
+	// Without SA_RESTART, so the signals wake up poll()
+	struct sigaction stop_action = {};
+	stop_action.sa_handler = request_stop;
+	sigemptyset(&stop_action.sa_mask);
+	struct sigaction previous_interrupt = {};
+	struct sigaction previous_terminate = {};
+	stop_requested = 0;
+	sigaction(SIGINT, &stop_action, &previous_interrupt);
+	sigaction(SIGTERM, &stop_action, &previous_terminate);
+
+	RequestQueue queue;
+	const size_t num_threads =
+		config.threads != 0 ? config.threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+	std::vector<std::jthread> workers;
+	workers.reserve(num_threads);
+	for (size_t index = 0; index < num_threads; ++index) {
+		workers.emplace_back([&](std::stop_token stop) {
+			while (std::optional<Request> request = queue.pop(stop)) {
+				request->connection->send_line(answer(request->line));
+			}
+		});
+	}
+
+	// Reloads take as long as loading the weather, so they run on their own thread: requests keep being read and
+	// answered with the last inputs meanwhile
+	std::jthread reloader([this](std::stop_token stop) {
+		std::mutex mutex;
+		std::condition_variable_any stopped;
+		std::unique_lock lock(mutex);
+		while (!stopped.wait_for(lock, stop, RELOAD_INTERVAL, [&] { return stop.stop_requested(); })) {
+			if (reload_changed()) {
+				std::cout << "[SERVE] Reloaded changed inputs\n" << std::flush;
+			}
+		}
+	});
+
+	std::cout << "[SERVE] Listening on " << config.socket_path << " with " << num_threads << " threads\n"
+			  << std::flush;
+	std::vector<std::shared_ptr<Connection>> connections;
+	std::vector<pollfd> polled;
+	while (stop_requested == 0) {
+		polled.assign(1, {.fd = listener, .events = POLLIN, .revents = 0});
+		for (const auto& connection : connections) {
+			polled.push_back({.fd = connection->get_fd(), .events = POLLIN, .revents = 0});
+		}
+		const int num_ready = poll(polled.data(), polled.size(), static_cast<int>(STOP_CHECK_INTERVAL.count()));
+		if (num_ready < 0 && errno != EINTR) {
+			std::cerr << "[SERVE] Could not wait for requests: " << std::strerror(errno) << "\n";
+			break;
+		}
+		if (num_ready <= 0) {
+			continue;
+		}
+
+		// Backwards, so hung up connections can be erased on the way
+		for (size_t index = connections.size(); index-- > 0;) {
+			if (polled[index + 1].revents == 0) {
+				continue;
+			}
+			const std::shared_ptr<Connection>& connection = connections[index];
+			const bool open = connection->receive([&](std::string line) {
+				queue.push({.connection = connection, .line = std::move(line)});
+			});
+			if (!open) {
+				// Closed once its queued requests are answered
+				connections.erase(connections.begin() + static_cast<std::ptrdiff_t>(index));
+			}
+		}
+		if ((polled[0].revents & POLLIN) != 0) {
+			const int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+			if (fd >= 0) {
+				setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &SEND_TIMEOUT, sizeof(SEND_TIMEOUT));
+				connections.push_back(std::make_shared<Connection>(fd));
+			}
+		}
+	}
+
+	reloader = std::jthread();
+	workers.clear();
+	connections.clear();
+	close(listener);
+	std::error_code error;
+	std::filesystem::remove(config.socket_path, error);
+	sigaction(SIGINT, &previous_interrupt, nullptr);
+	sigaction(SIGTERM, &previous_terminate, nullptr);
+	std::cout << "[SERVE] Stopped\n";
+}
@@ -0,0 +1,93 @@
+#ifndef MINISIM_SIMULATIONSERVER_H
+#define MINISIM_SIMULATIONSERVER_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "ConfigFile/ConfigFile.h"
+
+/// @brief What a simulation server keeps loaded (minisim serve server.toml):
+///
+///     socket = "/tmp/minisim.sock"
+///     threads = 4              # optional, default: one per hardware thread
+///     car = "data/Cars/mini-car.toml"
+///     stations = "data/Stations/australia_stations.csv"
+///     route = "data/Route/route.csv"
+///     weather = "data/Weather/Australia/August/2007.csv"
+///     optimizer = "binary"     # optional: for requests that do not name one
+///
+///     [schedules]              # the schedules requests choose from, by name
+///     2007 = "data/Schedule/August/Schedule2007.toml"
+///
+/// Relative paths are relative to the directory of the file.
+struct ServerConfig {
+	std::string socket_path;
+	/// 0 for one per hardware thread
+	size_t threads = 0;
+	std::string car_file;
+	std::string weather_file;
+	std::string weather_stations_file;
+	std::string route_file;
+	std::map<std::string, std::string> schedule_files;
+	std::string optimizer_type = "binary";
+
+	/// @throws ConfigSchemaError listing every key that is missing or not a string
+	static ServerConfig from_config(const ConfigFile& config, std::string_view config_directory);
+	/// @throws std::invalid_argument if the file cannot be read, or see from_config()
+	static ServerConfig from_path(std::string_view config_file);
+};
+
+/// @brief Keeps the route, weather, stations, schedules and car of a ServerConfig loaded, and answers race questions
+/// about them in milliseconds instead of paying for the loading on every run.
+///
+/// A request is one line of JSON; every field is optional:
+///
+///     {"id": 7, "schedule": "2007", "optimizer": "linear", "car": {"mass": 250, "battery.capacity": 5000}}
+///
+/// "schedule" may be left out when there is only one. "car" overrides numbers of the car config, by dotted path or
+/// by nested object. The answer is one line of JSON with the same "id":
+///
+///     {"id": 7, "status": "finished", "race_time": 123.4, "speed": 25.1}
+///
+/// The status is "finished", "unfinished" (the car could not finish the race) or "error" (with an "error" message).
+class SimulationServer {
+   public:
+	/// @brief Loads every input of the config
+	/// @throws the error of the first input that cannot be loaded
+	explicit SimulationServer(ServerConfig config);
+	~SimulationServer();
+
+	/// @return the answer to one request line, without its newline. Safe to call from several threads at once.
+	std::string answer(std::string_view request) const;
+
+	/// @brief Reloads the inputs whose files were modified since they were loaded, and what depends on them (the
+	/// route and weather on the stations, the weather on the schedules). The car, and the stations, route, weather
+	/// and schedules, are reloaded all or nothing: if one input fails to reload, the inputs it goes with are kept as
+	/// they were too, and retried once one of their files changes again. Requests being answered finish with the
+	/// inputs they started with. One reload runs at a time.
+	/// @return whether any input was reloaded
+	bool reload_changed();
+
+	/// @brief Answers requests on the Unix domain socket of the config until SIGINT or SIGTERM. Each connection may
+	/// send any number of requests, one per line; they are answered concurrently on a pool of threads, so answers can
+	/// come back in a different order (match them by "id"). Changed input files are checked for once a second and
+	/// reloaded on a thread of their own, so requests are answered with the last inputs meanwhile.
+	/// @throws std::runtime_error if the socket cannot be set up
+	void serve();
+
+   private:
+	/// Everything loaded, replaced as a whole on reload so a request sees one consistent set
+	struct Resident;
+
+	std::shared_ptr<const Resident> get_resident() const;
+
+	ServerConfig config;
+	std::mutex reload_mutex;
+	mutable std::mutex resident_mutex;
+	std::shared_ptr<const Resident> resident;
+};
+
+#endif  // MINISIM_SIMULATIONSERVER_H
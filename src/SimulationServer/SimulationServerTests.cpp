@@ -0,0 +1,176 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "SimulationServer.h"
+#include "TestSupport/TestSupport.h"
+#include "Tools/RootDirectory.h"
+
+using test_support::read_file;
+using test_support::text_of;
+
+namespace {
+	/// 2007-08-15T00:00:00Z, two days before the 2007-7 schedule starts
+	constexpr double WEATHER_START_TIME = 1187136000.0;
+
+	/// @brief Writes a file, modified later than any write before it, even within the resolution of the file times
+	void rewrite(const std::string& path, const std::string& contents) {
+		static auto modified_time = std::filesystem::file_time_type::clock::now();
+		modified_time += std::chrono::seconds(10);
+		std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+		std::filesystem::last_write_time(path, modified_time);
+	}
+
+	/// @brief The inputs of a server: the race files, and copies of the car and of the 2007 and 2007-7 schedules
+	struct ServerFiles {
+		test_support::RaceFiles race_files{"minisim-simulation-server", WEATHER_START_TIME, 20};
+		ServerConfig config = {
+			.socket_path = (race_files.directory / "minisim.sock").string(),
+			.threads = 1,
+			.car_file = (race_files.directory / "car.toml").string(),
+			.weather_file = race_files.weather_file,
+			.weather_stations_file = race_files.stations_file,
+			.route_file = race_files.route_file,
+			.schedule_files = {{"2007", (race_files.directory / "2007.toml").string()},
+				{"2007-7", (race_files.directory / "2007-7.toml").string()}},
+			.optimizer_type = "binary",
+		};
+
+		ServerFiles() {
+			const std::string data_directory = get_root_directory() + "/data";
+			rewrite(config.car_file, read_file(data_directory + "/Cars/mini-car.toml"));
+			rewrite(config.schedule_files.at("2007"), read_file(data_directory + "/Schedule/August/Schedule2007.toml"));
+			rewrite(
+				config.schedule_files.at("2007-7"), read_file(data_directory + "/Schedule/August/Schedule2007-7.toml"));
+		}
+	};
+}  // namespace
+
+TEST_CASE("SimulationServer: answer", "[SimulationServer]") {
+	const ServerFiles files;
+	const SimulationServer server(files.config);
+
+	SECTION("Echoes the id of the request") {
+		const std::string answer = server.answer(R"({"id": 7, "schedule": "2007"})");
+		CHECK(answer.starts_with(R"({"id": 7, "status": "finished", "race_time": )"));
+		CHECK(server.answer(R"({"id": "seven", "schedule": "2007"})").starts_with(R"({"id": "seven", "status": )"));
+		CHECK(server.answer(R"({"schedule": "2007"})").starts_with(R"({"id": null, "status": )"));
+	}
+
+	SECTION("Answers with the schedule of the request") {
+		const std::string answer = server.answer(R"({"schedule": "2007"})");
+		const std::string earlier_answer = server.answer(R"({"schedule": "2007-7"})");
+		CHECK(text_of(answer, "status") == "finished");
+		CHECK(text_of(earlier_answer, "status") == "finished");
+		CHECK(answer != earlier_answer);
+		CHECK(server.answer(R"({"schedule": "2007"})") == answer);
+		CHECK(server.answer(R"({"schedule": "2007", "optimizer": "binary"})") == answer);
+	}
+
+	SECTION("Takes the only schedule when none is named") {
+		ServerConfig config = files.config;
+		config.schedule_files.erase("2007-7");
+		const SimulationServer single_schedule_server(config);
+		CHECK(single_schedule_server.answer("{}") == server.answer(R"({"schedule": "2007"})"));
+	}
+
+	SECTION("Reports what is wrong with a request") {
+		CHECK(server.answer("not json").starts_with(R"({"id": null, "status": "error", "error": )"));
+		CHECK(text_of(server.answer("[1, 2]"), "error") == "a request must be a JSON object");
+		CHECK(text_of(server.answer(R"({"id": 1})"), "error") == "schedule must be given when the server has several");
+		CHECK(text_of(server.answer(R"({"id": 1, "schedule": 2007})"), "error") == "schedule must be a string");
+		CHECK(text_of(server.answer(R"({"id": 1, "schedule": "2008"})"), "error") == "unknown schedule 2008");
+		CHECK(text_of(server.answer(R"({"schedule": "2007", "optimizer": "fastest"})"), "error")
+				  .starts_with("optimizer fastest"));
+
+		const std::string answer = server.answer(R"({"id": "bad", "schedule": "2008"})");
+		CHECK(answer.starts_with(R"({"id": "bad", "status": "error", )"));
+	}
+}
+
+TEST_CASE("SimulationServer: car overrides", "[SimulationServer]") {
+	const ServerFiles files;
+	const SimulationServer server(files.config);
+	const auto answer = [&](const std::string& car) {
+		return server.answer(R"({"schedule": "2007", "car": )" + car + "}");
+	};
+
+	SECTION("Overrides numbers by dotted path or by nested object") {
+		const std::string dotted = answer(R"({"battery.capacity": 1000, "mass": 300})");
+		CHECK(text_of(dotted, "status") == "finished");
+		CHECK(dotted != server.answer(R"({"schedule": "2007"})"));
+		CHECK(answer(R"({"battery": {"capacity": 1000}, "mass": 300})") == dotted);
+		CHECK(answer(R"({"mass": 300, "battery": {"capacity": 1000.0}})") == dotted);
+		CHECK(answer("{}") == server.answer(R"({"schedule": "2007"})"));
+	}
+
+	SECTION("Rejects what is not a number of the car") {
+		CHECK(text_of(answer("5"), "error") == "car must be an object");
+		CHECK(text_of(answer(R"({"wings": 2})"), "error") == "the car has no wings");
+		CHECK(text_of(answer(R"({"battery.wings": 2})"), "error") == "the car has no battery.wings");
+		const std::string not_overridable = "car mass must be overridden by a number or an object";
+		CHECK(text_of(answer(R"({"mass": "heavy"})"), "error") == not_overridable);
+		CHECK(text_of(answer(R"({"mass": null})"), "error") == not_overridable);
+		CHECK(text_of(answer(R"({"battery": 2})"), "error") == "car battery is not a number");
+		CHECK(text_of(answer(R"({"tire": {"name": 2}})"), "error") == "car tire.name is not a number");
+		CHECK(text_of(answer(R"({"mass.grams": 2})"), "error") == "car mass is not a table");
+		CHECK(text_of(answer(R"({"mass": {"grams": 2}})"), "error") == "car mass is not a table");
+	}
+}
+
+TEST_CASE("SimulationServer: reload_changed", "[SimulationServer]") {
+	const ServerFiles files;
+	SimulationServer server(files.config);
+	const std::string request = R"({"schedule": "2007"})";
+	const std::string first_answer = server.answer(request);
+	CHECK_FALSE(server.reload_changed());
+
+	SECTION("Reloads a changed file") {
+		const std::string car = read_file(files.config.car_file);
+		rewrite(files.config.car_file, "mass = 300\n" + car.substr(car.find('\n') + 1));
+		CHECK(server.reload_changed());
+		CHECK_FALSE(server.reload_changed());
+		const std::string heavier_answer = server.answer(request);
+		CHECK(text_of(heavier_answer, "status") == "finished");
+		CHECK(heavier_answer != first_answer);
+		CHECK(heavier_answer == server.answer(R"({"schedule": "2007", "car": {"mass": 300}})"));
+	}
+
+	SECTION("Keeps the last version of a car that fails to reload") {
+		const std::string car = read_file(files.config.car_file);
+		rewrite(files.config.car_file, "mass = [");
+		CHECK_FALSE(server.reload_changed());
+		CHECK(server.answer(request) == first_answer);
+		// Not retried until the file changes again
+		CHECK_FALSE(server.reload_changed());
+
+		rewrite(files.config.car_file, car);
+		CHECK(server.reload_changed());
+		CHECK(server.answer(request) == first_answer);
+	}
+
+	SECTION("Keeps the stations, route, weather and schedules together when one fails to reload") {
+		const std::string stations = read_file(files.config.weather_stations_file);
+		const std::string schedule = read_file(files.config.schedule_files.at("2007"));
+		const std::string earlier_schedule = read_file(files.config.schedule_files.at("2007-7"));
+		rewrite(files.config.weather_stations_file, stations);
+		rewrite(files.config.schedule_files.at("2007"), earlier_schedule);
+		rewrite(files.config.schedule_files.at("2007-7"), "[[schedule]");
+		CHECK_FALSE(server.reload_changed());
+		CHECK(server.answer(request) == first_answer);
+		CHECK_FALSE(server.reload_changed());
+
+		// Once the broken schedule is fixed, the other changed files are reloaded with it
+		rewrite(files.config.schedule_files.at("2007-7"), earlier_schedule);
+		CHECK(server.reload_changed());
+		CHECK(server.answer(request) == server.answer(R"({"schedule": "2007-7"})"));
+		CHECK(server.answer(request) != first_answer);
+
+		rewrite(files.config.schedule_files.at("2007"), schedule);
+		CHECK(server.reload_changed());
+		CHECK(server.answer(request) == first_answer);
+	}
+}
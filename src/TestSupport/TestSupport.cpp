@@ -0,0 +1,57 @@
+#include "TestSupport.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "DataClasses/GeographicalCoordinate.h"
+#include "RaceConfig/Synthetic/SyntheticInputs.h"
+#include "RaceConfig/WeatherStations/WeatherStations.h"
+#include "Tools/RootDirectory.h"
+
+namespace {
+	constexpr double DAY = 86400.0;
+}  // namespace
+
+std::string test_support::temporary_path(const std::string& name) {
+	return (std::filesystem::temp_directory_path() / (name + "." + std::to_string(getpid()))).string();
+}
+
+std::string test_support::read_file(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+test_support::RaceFiles::RaceFiles(const std::string& name, double weather_start_time, int weather_days)
+	: directory(temporary_path(name)),
+	  route_file((directory / "route.csv").string()),
+	  stations_file((directory / "stations.csv").string()),
+	  weather_file((directory / "weather.csv").string()) {
+	std::filesystem::create_directories(directory);
+	const std::string data_directory = get_root_directory() + "/data";
+	std::filesystem::copy_file(data_directory + "/Route/route.csv", route_file);
+	std::filesystem::copy_file(data_directory + "/Stations/australia_stations.csv", stations_file);
+
+	const WeatherStations stations(stations_file);
+	std::vector<GeographicalCoordinate> coordinates;
+	for (size_t index = 0; index < stations.size(); ++index) {
+		coordinates.push_back(stations[index]);
+	}
+	synthetic::write_weather(weather_file, coordinates,
+		{.start_time = weather_start_time, .end_time = weather_start_time + weather_days * DAY});
+}
+
+test_support::RaceFiles::~RaceFiles() {
+	std::filesystem::remove_all(directory);
+}
+
+std::string test_support::text_of(const json::Value& object, std::string_view key) {
+	const json::Value* value = object.find(key);
+	return value != nullptr && value->get_if<std::string>() != nullptr ? *value->get_if<std::string>() : "";
+}
+
+std::string test_support::text_of(std::string_view json_text, std::string_view key) {
+	return text_of(json::parse(json_text), key);
+}
@@ -0,0 +1,41 @@
+#ifndef MINISIM_TESTSUPPORT_H
+#define MINISIM_TESTSUPPORT_H
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include "Tools/Json.h"
+
+/// Files and lookups the tests of several modules need
+namespace test_support {
+	/// @return a path in the temporary directory, made unique to this process so test runs in parallel do not collide
+	std::string temporary_path(const std::string& name);
+
+	/// @return the contents of a file, empty if it cannot be read
+	std::string read_file(const std::string& path);
+
+	/// @brief Copies of the route and weather stations in data/, and synthetic weather at those weather stations, in
+	/// a temporary directory removed with it
+	struct RaceFiles {
+		std::filesystem::path directory;
+		std::string route_file;
+		std::string stations_file;
+		std::string weather_file;
+
+		/// @param name of the directory, passed to temporary_path()
+		/// @param weather_start_time (Epoch Time) the first forecast
+		/// @param weather_days how many days of hourly forecasts there are
+		RaceFiles(const std::string& name, double weather_start_time, int weather_days);
+		~RaceFiles();
+		RaceFiles(const RaceFiles&) = delete;
+		RaceFiles& operator=(const RaceFiles&) = delete;
+	};
+
+	/// @return the string member @p key of a JSON object, empty if there is none
+	std::string text_of(const json::Value& object, std::string_view key);
+	/// @brief Same as text_of(json::parse(json_text), key)
+	std::string text_of(std::string_view json_text, std::string_view key);
+}  // namespace test_support
+
+#endif  // MINISIM_TESTSUPPORT_H
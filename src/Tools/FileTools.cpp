@@ -1,7 +1,13 @@
 #include "FileTools.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <filesystem>
+#include <stdexcept>
 #include <string>
 
 #include "Tools/RootDirectory.h"
@@ -39,4 +45,24 @@ std::vector<std::string> file_tools::get_files_in_directory(std::string_view dir
 		files.push_back(path.string());
 	}
 	return files;
-}
\ No newline at end of file
+}
+
+file_tools::MappedFile file_tools::map_file(const std::string& path) {
+	const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0) {
+		throw std::runtime_error("could not open " + path);
+	}
+	struct stat file_status = {};
+	const bool has_size = fstat(file, &file_status) == 0 && file_status.st_size > 0;
+	const auto size = has_size ? static_cast<size_t>(file_status.st_size) : 0;
+	void* address = has_size ? mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0) : MAP_FAILED;
+	close(file);
+	if (address == MAP_FAILED) {
+		throw std::runtime_error("could not map " + path);
+	}
+	return {
+		.bytes = std::span<const std::byte>(static_cast<const std::byte*>(address), size),
+		.mapping = std::shared_ptr<const void>(
+			address, [size](const void* mapped) { munmap(const_cast<void*>(mapped), size); }),
+	};
+}
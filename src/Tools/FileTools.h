@@ -1,14 +1,28 @@
 #ifndef MINISIM_FILETOOLS_H
 #define MINISIM_FILETOOLS_H
 
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
 #include <string_view>
 #include <vector>
 
 namespace file_tools {
+	/// @brief A whole file mapped read-only into memory
+	struct MappedFile {
+		std::span<const std::byte> bytes;
+		/// unmaps the file once the last copy of it is gone
+		std::shared_ptr<const void> mapping;
+	};
+
 	std::string get_file_extension(std::string_view file_name);
 	bool has_extension(std::string_view file_name, std::string_view extension);
 	/// @brief Gets all the files in a directory with a certain extension
 	std::vector<std::string> get_files_in_directory(std::string_view directory, std::string_view extension);
+	/// @brief Maps a file read-only and shared, so processes mapping the same file share its pages
+	/// @throws std::runtime_error if the file cannot be opened or mapped, or is empty
+	MappedFile map_file(const std::string& path);
 
 }  // namespace file_tools
 
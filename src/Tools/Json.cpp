@@ -0,0 +1,318 @@
+#include "Json.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+	/// arrays and objects nested deeper than this are rejected, so hostile input cannot exhaust the stack
+	constexpr size_t MAX_DEPTH = 64;
+
+	class Parser {
+	   public:
+		explicit Parser(std::string_view text) : text(text) {}
+
+		json::Value parse_document() {
+			json::Value value = parse_value(0);
+			skip_whitespace();
+			if (position != text.size()) {
+				fail("trailing characters");
+			}
+			return value;
+		}
+
+	   private:
+		[[noreturn]] void fail(std::string_view problem) const {
+			throw std::invalid_argument(
+				"invalid JSON at offset " + std::to_string(position) + ": " + std::string(problem));
+		}
+
+		void skip_whitespace() {
+			while (position < text.size() &&
+				   (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' ||
+					   text[position] == '\r')) {
+				++position;
+			}
+		}
+
+		bool consume(char c) {
+			skip_whitespace();
+			if (position < text.size() && text[position] == c) {
+				++position;
+				return true;
+			}
+			return false;
+		}
+
+		void expect(char c) {
+			if (!consume(c)) {
+				fail(std::string("expected '") + c + "'");
+			}
+		}
+
+		void expect_word(std::string_view word) {
+			if (text.substr(position, word.size()) != word) {
+				fail("unexpected character");
+			}
+			position += word.size();
+		}
+
+		json::Value parse_value(size_t depth) {
+			skip_whitespace();
+			if (position == text.size()) {
+				fail("unexpected end");
+			}
+			switch (text[position]) {
+				case '{':
+					return parse_object(depth + 1);
+				case '[':
+					return parse_array(depth + 1);
+				case '"':
+					return json::Value(parse_string());
+				case 't':
+					expect_word("true");
+					return json::Value(true);
+				case 'f':
+					expect_word("false");
+					return json::Value(false);
+				case 'n':
+					expect_word("null");
+					return {};
+				default:
+					return json::Value(parse_number());
+			}
+		}
+
+		json::Value parse_object(size_t depth) {
+			if (depth > MAX_DEPTH) {
+				fail("nested too deeply");
+			}
+			++position;
+			json::Value::Object members;
+			if (consume('}')) {
+				return json::Value(std::move(members));
+			}
+			do {
+				skip_whitespace();
+				if (position == text.size() || text[position] != '"') {
+					fail("expected a key");
+				}
+				std::string key = parse_string();
+				expect(':');
+				members.emplace_back(std::move(key), parse_value(depth));
+			} while (consume(','));
+			expect('}');
+			return json::Value(std::move(members));
+		}
+
+		json::Value parse_array(size_t depth) {
+			if (depth > MAX_DEPTH) {
+				fail("nested too deeply");
+			}
+			++position;
+			json::Value::Array elements;
+			if (consume(']')) {
+				return json::Value(std::move(elements));
+			}
+			do {
+				elements.push_back(parse_value(depth));
+			} while (consume(','));
+			expect(']');
+			return json::Value(std::move(elements));
+		}
+
+		uint32_t parse_hex4() {
+			uint32_t code = 0;
+			const char* first = text.data() + position;
+			const auto result = std::from_chars(first, first + std::min<size_t>(4, text.size() - position), code, 16);
+			if (result.ec != std::errc() || result.ptr != first + 4) {
+				fail("invalid \\u escape");
+			}
+			position += 4;
+			return code;
+		}
+
+		static void append_utf8(std::string& out, uint32_t code) {
+			if (code < 0x80) {
+				out += static_cast<char>(code);
+			} else if (code < 0x800) {
+				out += static_cast<char>(0xC0 | (code >> 6));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			} else if (code < 0x10000) {
+				out += static_cast<char>(0xE0 | (code >> 12));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			} else {
+				out += static_cast<char>(0xF0 | (code >> 18));
+				out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+		}
+
+		std::string parse_string() {
+			++position;
+			std::string out;
+			while (true) {
+				if (position == text.size()) {
+					fail("unterminated string");
+				}
+				const char c = text[position++];
+				if (c == '"') {
+					return out;
+				}
+				if (static_cast<unsigned char>(c) < 0x20) {
+					fail("control character in string");
+				}
+				if (c != '\\') {
+					out += c;
+					continue;
+				}
+				if (position == text.size()) {
+					fail("unterminated string");
+				}
+				switch (text[position++]) {
+					case '"':
+						out += '"';
+						break;
+					case '\\':
+						out += '\\';
+						break;
+					case '/':
+						out += '/';
+						break;
+					case 'b':
+						out += '\b';
+						break;
+					case 'f':
+						out += '\f';
+						break;
+					case 'n':
+						out += '\n';
+						break;
+					case 'r':
+						out += '\r';
+						break;
+					case 't':
+						out += '\t';
+						break;
+					case 'u': {
+						uint32_t code = parse_hex4();
+						if (code >= 0xD800 && code < 0xDC00) {
+							// a UTF-16 surrogate pair
+							expect_word("\\u");
+							const uint32_t low = parse_hex4();
+							if (low < 0xDC00 || low >= 0xE000) {
+								fail("invalid surrogate pair");
+							}
+							code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+						} else if (code >= 0xDC00 && code < 0xE000) {
+							fail("invalid surrogate pair");
+						}
+						append_utf8(out, code);
+						break;
+					}
+					default:
+						--position;
+						fail("invalid escape");
+				}
+			}
+		}
+
+		double parse_number() {
+			// from_chars also takes "inf", "nan" and leading zeros, so check the JSON grammar first
+			const size_t start = position;
+			const auto digits = [&] {
+				const size_t first = position;
+				while (position < text.size() && text[position] >= '0' && text[position] <= '9') {
+					++position;
+				}
+				return position - first;
+			};
+			if (position < text.size() && text[position] == '-') {
+				++position;
+			}
+			const size_t integer_start = position;
+			const size_t integer_digits = digits();
+			if (integer_digits == 0 || (integer_digits > 1 && text[integer_start] == '0')) {
+				position = start;
+				fail("invalid number");
+			}
+			if (position < text.size() && text[position] == '.') {
+				++position;
+				if (digits() == 0) {
+					fail("invalid number");
+				}
+			}
+			if (position < text.size() && (text[position] == 'e' || text[position] == 'E')) {
+				++position;
+				if (position < text.size() && (text[position] == '+' || text[position] == '-')) {
+					++position;
+				}
+				if (digits() == 0) {
+					fail("invalid number");
+				}
+			}
+
+			double number = 0.0;
+			const auto result = std::from_chars(text.data() + start, text.data() + position, number);
+			if (result.ec != std::errc()) {
+				position = start;
+				fail("number out of range");
+			}
+			return number;
+		}
+
+		std::string_view text;
+		size_t position = 0;
+	};
+}  // namespace
+
+const json::Value* json::Value::find(std::string_view key) const noexcept {
+	const Object* object = get_if<Object>();
+	if (object == nullptr) {
+		return nullptr;
+	}
+	for (auto member = object->rbegin(); member != object->rend(); ++member) {
+		if (member->first == key) {
+			return &member->second;
+		}
+	}
+	return nullptr;
+}
+
+json::Value json::parse(std::string_view text) {
+	return Parser(text).parse_document();
+}
+
+void json::append_string(std::string& out, std::string_view text) {
+	out += '"';
+	for (const char c : text) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if (static_cast<unsigned char>(c) < 0x20) {
+			std::array<char, 8> escaped = {};
+			std::snprintf(escaped.data(), escaped.size(), "\\u%04x", static_cast<unsigned int>(c));
+			out += escaped.data();
+		} else {
+			out += c;
+		}
+	}
+	out += '"';
+}
+
+void json::append_number(std::string& out, double number) {
+	if (!std::isfinite(number)) {
+		out += "null";
+		return;
+	}
+	std::array<char, 32> digits = {};
+	const auto result = std::to_chars(digits.data(), digits.data() + digits.size(), number);
+	out.append(digits.data(), result.ptr);
+}
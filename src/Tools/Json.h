@@ -0,0 +1,54 @@
+#ifndef MINISIM_JSON_H
+#define MINISIM_JSON_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace json {
+	/// @brief A parsed JSON value: null, a boolean, a number, a string, an array or an object
+	class Value {
+	   public:
+		using Array = std::vector<Value>;
+		/// the members of an object, in the order they were written
+		using Object = std::vector<std::pair<std::string, Value>>;
+
+		/// @brief null
+		Value() = default;
+		explicit Value(bool boolean) : data(boolean) {}
+		explicit Value(double number) : data(number) {}
+		explicit Value(std::string string) : data(std::move(string)) {}
+		explicit Value(Array array) : data(std::move(array)) {}
+		explicit Value(Object object) : data(std::move(object)) {}
+
+		bool is_null() const noexcept {
+			return std::holds_alternative<std::nullptr_t>(data);
+		}
+
+		/// @return the value if it is of type T (bool, double, std::string, Array or Object), nullptr otherwise
+		template <typename T>
+		const T* get_if() const noexcept {
+			return std::get_if<T>(&data);
+		}
+
+		/// @return the last member of an object with this key, nullptr if there is none or this is not an object
+		const Value* find(std::string_view key) const noexcept;
+
+	   private:
+		std::variant<std::nullptr_t, bool, double, std::string, Array, Object> data = nullptr;
+	};
+
+	/// @brief Parses one JSON document (RFC 8259), with only whitespace around it
+	/// @throws std::invalid_argument with the offset of the first error
+	Value parse(std::string_view text);
+
+	/// @brief Appends a string as a quoted, escaped JSON string
+	void append_string(std::string& out, std::string_view text);
+	/// @brief Appends the shortest JSON number that reads back as @p number (null if it is not finite)
+	void append_number(std::string& out, double number);
+}  // namespace json
+
+#endif  // MINISIM_JSON_H
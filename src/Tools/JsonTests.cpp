@@ -0,0 +1,66 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "Json.h"
+
+TEST_CASE("json: parse", "[Json]") {
+	SECTION("Reads every kind of value") {
+		const json::Value value = json::parse(
+			R"( {"id": 7, "name": "a \"b\"\n\u00e9\ud83d\ude00", "ok": true, "no": false, "none": null,
+				 "list": [1.5, -2e3, []], "car": {"mass": 0.25}, "id": 8} )");
+
+		REQUIRE(value.get_if<json::Value::Object>() != nullptr);
+		CHECK(*value.find("id")->get_if<double>() == 8.0);
+		CHECK(*value.find("name")->get_if<std::string>() == "a \"b\"\n\xC3\xA9\xF0\x9F\x98\x80");
+		CHECK(*value.find("ok")->get_if<bool>());
+		CHECK_FALSE(*value.find("no")->get_if<bool>());
+		CHECK(value.find("none")->is_null());
+		CHECK(value.find("missing") == nullptr);
+
+		const auto& list = *value.find("list")->get_if<json::Value::Array>();
+		REQUIRE(list.size() == 3);
+		CHECK(*list[0].get_if<double>() == 1.5);
+		CHECK(*list[1].get_if<double>() == -2000.0);
+		CHECK(list[2].get_if<json::Value::Array>()->empty());
+		CHECK(*value.find("car")->find("mass")->get_if<double>() == 0.25);
+		CHECK(value.find("car")->find("mass")->find("x") == nullptr);
+	}
+
+	SECTION("Rejects what is not JSON") {
+		for (const char* text : {"", "{", "{\"a\" 1}", "{\"a\": 1,}", "[1 2]", "01", "1.", "-", ".5", "+1", "1e", "nan",
+				 "inf", "tru", "\"\\x\"", "\"\\ud83d\"", "\"a\nb\"", "{} {}", "1e999"}) {
+			CAPTURE(text);
+			CHECK_THROWS_AS(json::parse(text), std::invalid_argument);
+		}
+		CHECK_THROWS_AS(json::parse(std::string(100, '[') + std::string(100, ']')), std::invalid_argument);
+		CHECK(json::parse(std::string(50, '[') + std::string(50, ']')).get_if<json::Value::Array>() != nullptr);
+	}
+}
+
+TEST_CASE("json: append_string", "[Json]") {
+	SECTION("Escapes quotes, backslashes and control characters") {
+		std::string out;
+		json::append_string(out, "a\"\\\x01");
+		CHECK(out == R"("a\"\\\u0001")");
+	}
+
+	SECTION("Reads back as the same string") {
+		const std::string text = "caf\xC3\xA9 \"\t\"";
+		std::string quoted;
+		json::append_string(quoted, text);
+		CHECK(*json::parse(quoted).get_if<std::string>() == text);
+	}
+}
+
+TEST_CASE("json: append_number", "[Json]") {
+	SECTION("Writes the shortest number that reads back, or null if it is not finite") {
+		std::string out;
+		json::append_number(out, 0.1);
+		out += ' ';
+		json::append_number(out, std::numeric_limits<double>::infinity());
+		CHECK(out == "0.1 null");
+	}
+}
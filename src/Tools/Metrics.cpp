@@ -0,0 +1,47 @@
+#include "Metrics.h"
+
+#include <map>
+#include <string>
+
+#include "Json.h"
+
+namespace {
+	process_totals::Registry<metrics::Counter> counters;
+}  // namespace
+
+metrics::Counter::Counter(const char* name) : name(name) {
+	counters.add(*this);
+#ifdef MINISIM_METRICS
+	// Counters are never destroyed, so they can still be read by then
+	process_totals::write_at_exit("MINISIM_METRICS_FILE", "METRICS", write_json);
+#endif
+}
+
+void metrics::write_json(std::ostream& out) {
+	struct Total {
+		std::uint64_t count = 0;
+		std::uint64_t nanoseconds = 0;
+	};
+	std::map<std::string, Total> totals;
+	counters.for_each([&](const Counter& counter) {
+		Total& total = totals[counter.get_name()];
+		total.count += counter.get_count();
+		total.nanoseconds += counter.get_nanoseconds();
+	});
+
+	std::string line = "{";
+	for (const auto& [name, total] : totals) {
+		if (line.size() > 1) {
+			line += ", ";
+		}
+		json::append_string(line, name);
+		line += ": {\"count\": " + std::to_string(total.count);
+		if (total.nanoseconds > 0) {
+			line += ", \"seconds\": ";
+			json::append_number(line, static_cast<double>(total.nanoseconds) / 1e9);
+		}
+		line += '}';
+	}
+	line += "}\n";
+	out << line << std::flush;
+}
@@ -0,0 +1,98 @@
+#ifndef MINISIM_METRICS_H
+#define MINISIM_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "ProcessTotals.h"
+
+/// @brief Phase timers and event counters, totalled over the whole process.
+///
+/// Code is instrumented with the macros, which compile to nothing unless the build enables them (cmake
+/// -DENABLE_METRICS=ON defines MINISIM_METRICS):
+///
+///     MINISIM_TIME_SCOPE("route.read_csv");          // times the rest of the enclosing scope
+///     MINISIM_COUNT("weather.get_weather_at");       // counts an event
+///
+/// In such a build, the totals are written as JSON when the process exits, to the file named by the
+/// MINISIM_METRICS_FILE environment variable, or to stderr:
+///
+///     {"route.read_csv": {"count": 1, "seconds": 0.0071}, "weather.get_weather_at": {"count": 5230}}
+namespace metrics {
+	/// @brief Writes the totals of every counter as one JSON object, by name (counters with the same name are added
+	/// up). Seconds are only written for counters that timed something.
+	void write_json(std::ostream& out);
+
+	/// @brief A named total: how many times something happened and, for timers, how long it took. Counters live as
+	/// long as the process, and are only ever updated with relaxed atomics.
+	class alignas(64) Counter {
+	   public:
+		explicit Counter(const char* name);
+		Counter(const Counter&) = delete;
+		Counter& operator=(const Counter&) = delete;
+
+		void add(std::uint64_t events = 1) noexcept {
+			count.fetch_add(events, std::memory_order_relaxed);
+		}
+		void add_time(std::chrono::nanoseconds time) noexcept {
+			count.fetch_add(1, std::memory_order_relaxed);
+			nanoseconds.fetch_add(static_cast<std::uint64_t>(time.count()), std::memory_order_relaxed);
+		}
+
+		const char* get_name() const noexcept {
+			return name;
+		}
+		std::uint64_t get_count() const noexcept {
+			return count.load(std::memory_order_relaxed);
+		}
+		std::uint64_t get_nanoseconds() const noexcept {
+			return nanoseconds.load(std::memory_order_relaxed);
+		}
+
+	   private:
+		friend class process_totals::Registry<Counter>;
+
+		const char* name;
+		std::atomic<std::uint64_t> count = 0;
+		std::atomic<std::uint64_t> nanoseconds = 0;
+		/// the counter registered before this one
+		Counter* next = nullptr;
+	};
+
+	/// @brief Adds the time from its construction to its destruction to a counter
+	class ScopedTimer {
+	   public:
+		explicit ScopedTimer(Counter& counter) noexcept
+			: counter(counter), start(std::chrono::steady_clock::now()) {}
+		~ScopedTimer() {
+			counter.add_time(std::chrono::steady_clock::now() - start);
+		}
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	   private:
+		Counter& counter;
+		std::chrono::steady_clock::time_point start;
+	};
+}  // namespace metrics
+
+#ifdef MINISIM_METRICS
+#define MINISIM_METRICS_CONCAT_(a, b) a##b
+#define MINISIM_METRICS_CONCAT(a, b) MINISIM_METRICS_CONCAT_(a, b)
+/// the counter of one instrumented place, registered the first time it is reached
+#define MINISIM_METRICS_COUNTER(name)            \
+	([]() -> ::metrics::Counter& {               \
+		static ::metrics::Counter counter(name); \
+		return counter;                          \
+	}())
+#define MINISIM_COUNT(name) MINISIM_METRICS_COUNTER(name).add()
+#define MINISIM_TIME_SCOPE(name) \
+	const ::metrics::ScopedTimer MINISIM_METRICS_CONCAT(metrics_timer_, __LINE__)(MINISIM_METRICS_COUNTER(name))
+#else
+#define MINISIM_COUNT(name) static_cast<void>(0)
+#define MINISIM_TIME_SCOPE(name) static_cast<void>(0)
+#endif
+
+#endif  // MINISIM_METRICS_H
@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The macros are tested whether or not the build enables them
+#ifndef MINISIM_METRICS
+#define MINISIM_METRICS
+#endif
+#include "Json.h"
+#include "Metrics.h"
+
+namespace {
+	void count_twice() {
+		MINISIM_COUNT("test.macro_count");
+		MINISIM_COUNT("test.macro_count");
+	}
+
+	void timed() {
+		MINISIM_TIME_SCOPE("test.macro_timer");
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+}  // namespace
+
+TEST_CASE("metrics::Counter: add", "[Metrics]") {
+	SECTION("Adds up across threads") {
+		static metrics::Counter counter("test.threads");
+		std::vector<std::jthread> threads;
+		for (int thread = 0; thread < 4; ++thread) {
+			threads.emplace_back([] {
+				for (int event = 0; event < 10000; ++event) {
+					counter.add();
+				}
+			});
+		}
+		threads.clear();
+		CHECK(counter.get_count() == 40000);
+		CHECK(counter.get_nanoseconds() == 0);
+	}
+}
+
+TEST_CASE("metrics: write_json", "[Metrics]") {
+	SECTION("Totals counters by name") {
+		count_twice();
+		count_twice();
+		timed();
+		static metrics::Counter same_name("test.macro_count");
+		same_name.add(3);
+
+		std::ostringstream out;
+		metrics::write_json(out);
+		const json::Value totals = json::parse(out.str());
+		REQUIRE(totals.find("test.macro_count") != nullptr);
+		CHECK(*totals.find("test.macro_count")->find("count")->get_if<double>() == 7.0);
+		CHECK(totals.find("test.macro_count")->find("seconds") == nullptr);
+
+		const json::Value* timer = totals.find("test.macro_timer");
+		REQUIRE(timer != nullptr);
+		CHECK(*timer->find("count")->get_if<double>() == 1.0);
+		CHECK(*timer->find("seconds")->get_if<double>() >= 0.002);
+	}
+}
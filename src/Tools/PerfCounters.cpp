@@ -0,0 +1,221 @@
+#include "PerfCounters.h"
+
+#include <cerrno>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <system_error>
+
+#include "Json.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	process_totals::Registry<perf::Region> regions;
+
+	std::mutex reason_mutex;
+	/// why events could not be counted, by event
+	std::map<std::string, std::string> unavailable_reasons;
+
+	void set_unavailable(perf::Event event, const std::string& reason) {
+		const std::lock_guard lock(reason_mutex);
+		unavailable_reasons.try_emplace(perf::EVENT_NAMES[event], reason);
+	}
+
+#ifdef __linux__
+	/// @return a hint at why perf_event_open() failed with @p error
+	std::string explain(int error) {
+		if (error == EACCES || error == EPERM) {
+			return " (see /proc/sys/kernel/perf_event_paranoid)";
+		}
+		if (error == ENOENT || error == EOPNOTSUPP) {
+			return " (not counted by this CPU, or it is virtual)";
+		}
+		return "";
+	}
+
+	constexpr std::array<std::uint64_t, perf::NUM_EVENTS> EVENT_CONFIGS = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+	/// @brief The counters of one thread, opened as one group so they are scheduled (and multiplexed) together
+	class ThreadCounters {
+	   public:
+		ThreadCounters() {
+			for (std::uint8_t event = 0; event < perf::NUM_EVENTS; ++event) {
+				perf_event_attr attributes = {};
+				attributes.type = PERF_TYPE_HARDWARE;
+				attributes.size = sizeof(attributes);
+				attributes.config = EVENT_CONFIGS[event];
+				attributes.exclude_kernel = 1;
+				attributes.exclude_hv = 1;
+				attributes.read_format =
+					PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+				// This thread, on any CPU
+				const int leader_fd = num_members == 0 ? -1 : fds[0];
+				const long fd = syscall(SYS_perf_event_open, &attributes, 0, -1, leader_fd, 0);
+				if (fd < 0) {
+					const int error = errno;
+					set_unavailable(
+						static_cast<perf::Event>(event), std::generic_category().message(error) + explain(error));
+					continue;
+				}
+				fds[num_members] = static_cast<int>(fd);
+				group_events[num_members++] = static_cast<perf::Event>(event);
+			}
+		}
+		~ThreadCounters() {
+			// The leader last
+			for (std::size_t member = num_members; member-- > 0;) {
+				close(fds[member]);
+			}
+		}
+		ThreadCounters(const ThreadCounters&) = delete;
+		ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+		bool read(perf::Reading& reading) const noexcept {
+			if (num_members == 0) {
+				return false;
+			}
+			// nr, time_enabled, time_running, then one value per member
+			std::array<std::uint64_t, 3 + perf::NUM_EVENTS> buffer = {};
+			const auto size = static_cast<ssize_t>((3 + num_members) * sizeof(std::uint64_t));
+			if (::read(fds[0], buffer.data(), static_cast<std::size_t>(size)) != size || buffer[2] == 0) {
+				return false;
+			}
+			// Scale up counts the group was not scheduled for, if the PMU was multiplexed between groups
+			const double scale = static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]);
+			reading = {};
+			for (std::size_t member = 0; member < num_members; ++member) {
+				reading.values[group_events[member]] = static_cast<std::uint64_t>(
+					static_cast<double>(buffer[3 + member]) * scale);
+				reading.counted[group_events[member]] = true;
+			}
+			return true;
+		}
+
+	   private:
+		/// the file descriptor of each member of the group; the first is its leader
+		std::array<int, perf::NUM_EVENTS> fds = {};
+		/// the event of each member, in the order they are read
+		std::array<perf::Event, perf::NUM_EVENTS> group_events = {};
+		std::size_t num_members = 0;
+	};
+#endif
+
+}  // namespace
+
+bool perf::read(Reading& reading) noexcept {
+#ifdef __linux__
+	thread_local const ThreadCounters counters;
+	return counters.read(reading);
+#else
+	static std::once_flag reported;
+	std::call_once(reported, [] {
+		for (std::uint8_t event = 0; event < NUM_EVENTS; ++event) {
+			set_unavailable(static_cast<Event>(event), "hardware counters are only read on Linux");
+		}
+	});
+	static_cast<void>(reading);
+	return false;
+#endif
+}
+
+std::string perf::get_unavailable_reason() {
+	const std::lock_guard lock(reason_mutex);
+	// The events failing for the same reason, by reason
+	std::map<std::string, std::string> events;
+	for (const auto& [event, reason] : unavailable_reasons) {
+		std::string& same_reason = events[reason];
+		same_reason += (same_reason.empty() ? "" : ", ") + event;
+	}
+	std::string reasons;
+	for (const auto& [reason, same_reason] : events) {
+		reasons += (reasons.empty() ? "" : "; ") + same_reason + ": " + reason;
+	}
+	return reasons;
+}
+
+perf::Region::Region(const char* name) : name(name) {
+	regions.add(*this);
+#ifdef MINISIM_PERF_COUNTERS
+	// Regions are never destroyed, so they can still be read by then
+	process_totals::write_at_exit("MINISIM_PERF_FILE", "PERF", write_json);
+#endif
+}
+
+void perf::Region::add_run(
+	const Reading& start, const Reading& end, std::uint64_t num_segments, std::uint64_t num_weather_queries) noexcept {
+	runs.fetch_add(1, std::memory_order_relaxed);
+	segments.fetch_add(num_segments, std::memory_order_relaxed);
+	weather_queries.fetch_add(num_weather_queries, std::memory_order_relaxed);
+	for (std::uint8_t event = 0; event < NUM_EVENTS; ++event) {
+		if (start.counted[event] && end.counted[event] && end.values[event] >= start.values[event]) {
+			counts[event].fetch_add(end.values[event] - start.values[event], std::memory_order_relaxed);
+			counted_runs[event].fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+void perf::write_json(std::ostream& out) {
+	struct Total {
+		std::uint64_t runs = 0;
+		std::uint64_t segments = 0;
+		std::uint64_t weather_queries = 0;
+		std::array<std::uint64_t, NUM_EVENTS> counts = {};
+		std::array<std::uint64_t, NUM_EVENTS> counted_runs = {};
+	};
+	std::map<std::string, Total> totals;
+	regions.for_each([&](const Region& region) {
+		Total& total = totals[region.get_name()];
+		total.runs += region.runs.load(std::memory_order_relaxed);
+		total.segments += region.segments.load(std::memory_order_relaxed);
+		total.weather_queries += region.weather_queries.load(std::memory_order_relaxed);
+		for (std::uint8_t event = 0; event < NUM_EVENTS; ++event) {
+			total.counts[event] += region.counts[event].load(std::memory_order_relaxed);
+			total.counted_runs[event] += region.counted_runs[event].load(std::memory_order_relaxed);
+		}
+	});
+
+	const std::string reason = get_unavailable_reason();
+	std::string line = "{\"available\": ";
+	line += reason.empty() ? "true" : "false";
+	if (!reason.empty()) {
+		line += ", \"reason\": ";
+		json::append_string(line, reason);
+	}
+	line += ", \"regions\": {";
+	bool first_region = true;
+	for (const auto& [name, total] : totals) {
+		if (!first_region) {
+			line += ", ";
+		}
+		first_region = false;
+		json::append_string(line, name);
+		line += ": {\"runs\": " + std::to_string(total.runs) + ", \"segments\": " + std::to_string(total.segments) +
+				", \"weather_queries\": " + std::to_string(total.weather_queries);
+
+		// An event only counted in some of the runs would be normalized by work it did not see, so it is null
+		const auto append_counts = [&](double divisor) {
+			for (std::uint8_t event = 0; event < NUM_EVENTS; ++event) {
+				line += event == 0 ? "" : ", ";
+				json::append_string(line, EVENT_NAMES[event]);
+				line += ": ";
+				const bool counted = total.runs > 0 && total.counted_runs[event] == total.runs;
+				json::append_number(line, counted ? static_cast<double>(total.counts[event]) / divisor : NAN);
+			}
+		};
+		line += ", ";
+		append_counts(1.0);
+		line += ", \"per_segment\": {";
+		append_counts(static_cast<double>(total.segments));
+		line += "}, \"per_weather_query\": {";
+		append_counts(static_cast<double>(total.weather_queries));
+		line += "}}";
+	}
+	line += "}}\n";
+	out << line << std::flush;
+}
@@ -0,0 +1,126 @@
+#ifndef MINISIM_PERFCOUNTERS_H
+#define MINISIM_PERFCOUNTERS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "ProcessTotals.h"
+
+/// @brief Hardware performance counters (Linux perf_event_open) around named regions of code, normalized per
+/// simulated segment and per weather query.
+///
+/// A region is marked with MINISIM_PERF_REGION and told what it simulated with MINISIM_PERF_WORK:
+///
+///     MINISIM_PERF_REGION(region, "race_runner.calculate_racetime");  // counts the rest of the enclosing scope
+///     MINISIM_PERF_WORK(region, num_segments, num_weather_queries);   // what it simulated, to normalize by
+///
+/// Both are no-ops unless minisim is configured with -DENABLE_PERF_COUNTERS=ON (which defines
+/// MINISIM_PERF_COUNTERS). Then at exit, every region is reported as one JSON object, in MINISIM_PERF_FILE if that
+/// is set and on stderr if not:
+///
+///     {"available": true, "regions": {"race_runner.calculate_racetime": {"runs": 40, "segments": 10320,
+///      "weather_queries": 20960, "cycles": 1.2e8, ..., "per_segment": {"cycles": 11600, ...},
+///      "per_weather_query": {...}}}}
+///
+/// Only the user-space work of the thread running a region is counted. Each end of a region costs a system call of
+/// about a microsecond, so a region should cover something big, like a whole race. If the kernel does not allow perf
+/// events (see /proc/sys/kernel/perf_event_paranoid; containers often block the syscall) or the CPU lacks an event,
+/// nothing else changes: the counts that are missing are written as null, along with why.
+namespace perf {
+	enum Event : std::uint8_t { CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, NUM_EVENTS };
+
+	/// the name each Event is written as
+	constexpr std::array<const char*, NUM_EVENTS> EVENT_NAMES = {
+		"cycles", "instructions", "cache_misses", "branch_misses"};
+
+	/// @brief The counts of every event on the calling thread so far
+	struct Reading {
+		std::array<std::uint64_t, NUM_EVENTS> values = {};
+		/// which events could be counted
+		std::array<bool, NUM_EVENTS> counted = {};
+	};
+
+	/// @brief Reads the counters of the calling thread, opening them the first time
+	/// @return whether any event could be counted; if not, @p reading is left alone
+	bool read(Reading& reading) noexcept;
+
+	/// @return why some (or all) events cannot be counted, or "" if they all can
+	std::string get_unavailable_reason();
+
+	/// @brief Writes the totals of every region as one JSON object, by name (regions with the same name are added up)
+	void write_json(std::ostream& out);
+
+	/// @brief A named total of the counts of every run of a region of code, and of the work those runs did. Regions
+	/// live as long as the process, and are only ever updated with relaxed atomics.
+	class alignas(64) Region {
+	   public:
+		explicit Region(const char* name);
+		Region(const Region&) = delete;
+		Region& operator=(const Region&) = delete;
+
+		void add_run(const Reading& start, const Reading& end, std::uint64_t segments,
+			std::uint64_t weather_queries) noexcept;
+
+		const char* get_name() const noexcept {
+			return name;
+		}
+
+	   private:
+		friend void write_json(std::ostream& out);
+		friend class process_totals::Registry<Region>;
+
+		const char* name;
+		std::atomic<std::uint64_t> runs = 0;
+		std::atomic<std::uint64_t> segments = 0;
+		std::atomic<std::uint64_t> weather_queries = 0;
+		std::array<std::atomic<std::uint64_t>, NUM_EVENTS> counts = {};
+		/// the runs each event was counted in
+		std::array<std::atomic<std::uint64_t>, NUM_EVENTS> counted_runs = {};
+		/// the region registered before this one
+		Region* next = nullptr;
+	};
+
+	/// @brief Adds the counts from its construction to its destruction to a region
+	class ScopedRegion {
+	   public:
+		explicit ScopedRegion(Region& region) noexcept : region(region), counting(read(start)) {}
+		~ScopedRegion() {
+			Reading end;
+			if (counting && read(end)) {
+				region.add_run(start, end, segments, weather_queries);
+			}
+		}
+		ScopedRegion(const ScopedRegion&) = delete;
+		ScopedRegion& operator=(const ScopedRegion&) = delete;
+
+		/// @brief Records work done in the region, which the counts are normalized by
+		void add_work(std::uint64_t num_segments, std::uint64_t num_weather_queries) noexcept {
+			segments += num_segments;
+			weather_queries += num_weather_queries;
+		}
+
+	   private:
+		Region& region;
+		Reading start;
+		bool counting;
+		std::uint64_t segments = 0;
+		std::uint64_t weather_queries = 0;
+	};
+}  // namespace perf
+
+#ifdef MINISIM_PERF_COUNTERS
+#define MINISIM_PERF_REGION(variable, name)                 \
+	::perf::ScopedRegion variable([]() -> ::perf::Region& { \
+		static ::perf::Region region(name);                 \
+		return region;                                      \
+	}())
+#define MINISIM_PERF_WORK(variable, segments, weather_queries) variable.add_work(segments, weather_queries)
+#else
+#define MINISIM_PERF_REGION(variable, name) static_cast<void>(0)
+#define MINISIM_PERF_WORK(variable, segments, weather_queries) static_cast<void>(0)
+#endif
+
+#endif  // MINISIM_PERFCOUNTERS_H
@@ -0,0 +1,56 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "Json.h"
+#include "PerfCounters.h"
+
+TEST_CASE("perf: write_json", "[PerfCounters]") {
+	SECTION("Writes regions with counts or the reason there are none") {
+		static perf::Region region("test.region");
+		volatile double sum = 0.0;
+		for (int run = 0; run < 3; ++run) {
+			perf::ScopedRegion scope(region);
+			for (int step = 0; step < 100000; ++step) {
+				sum = sum + std::sqrt(static_cast<double>(step));
+			}
+			scope.add_work(10, 20);
+		}
+
+		std::ostringstream out;
+		perf::write_json(out);
+		const json::Value totals = json::parse(out.str());
+		const bool* available = totals.find("available")->get_if<bool>();
+		REQUIRE(available != nullptr);
+		CAPTURE(perf::get_unavailable_reason());
+		CHECK(*available == perf::get_unavailable_reason().empty());
+
+		const json::Value* written = totals.find("regions")->find("test.region");
+		perf::Reading reading;
+		if (!perf::read(reading)) {
+			// Perf events are not permitted here: the runs were not counted, and nothing else failed
+			CHECK_FALSE(*available);
+			CHECK(totals.find("reason") != nullptr);
+			REQUIRE(written != nullptr);
+			CHECK(*written->find("runs")->get_if<double>() == 0.0);
+			CHECK(written->find("cycles")->is_null());
+			CHECK(written->find("per_segment")->find("cycles")->is_null());
+			return;
+		}
+
+		REQUIRE(written != nullptr);
+		CHECK(*written->find("runs")->get_if<double>() == 3.0);
+		CHECK(*written->find("segments")->get_if<double>() == 30.0);
+		CHECK(*written->find("weather_queries")->get_if<double>() == 60.0);
+		if (reading.counted[perf::INSTRUCTIONS]) {
+			const double instructions = *written->find("instructions")->get_if<double>();
+			CHECK(instructions > 300000.0);
+			CHECK(*written->find("per_segment")->find("instructions")->get_if<double>() == instructions / 30.0);
+			CHECK(*written->find("per_weather_query")->find("instructions")->get_if<double>() == instructions / 60.0);
+		} else {
+			CHECK(written->find("instructions")->is_null());
+		}
+	}
+}
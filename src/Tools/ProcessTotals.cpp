@@ -0,0 +1,51 @@
+#include "ProcessTotals.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace {
+	struct ExitWriter {
+		const char* file_variable;
+		const char* label;
+		void (*write)(std::ostream& out);
+	};
+
+	std::mutex writers_mutex;
+
+	/// Constructed before the exit handler is registered, so it is still alive when the handler runs
+	std::vector<ExitWriter>& get_writers() {
+		static std::vector<ExitWriter> writers;
+		return writers;
+	}
+
+	void write_all_at_exit() {
+		const std::lock_guard lock(writers_mutex);
+		for (const ExitWriter& writer : get_writers()) {
+			const char* file = std::getenv(writer.file_variable);
+			if (file == nullptr || *file == '\0') {
+				writer.write(std::cerr);
+				continue;
+			}
+			std::ofstream out(file);
+			writer.write(out);
+			if (!out) {
+				std::cerr << "[" << writer.label << "] Could not write " << file << "\n";
+			}
+		}
+	}
+}  // namespace
+
+void process_totals::write_at_exit(const char* file_variable, const char* label, void (*write)(std::ostream& out)) {
+	const std::lock_guard lock(writers_mutex);
+	std::vector<ExitWriter>& writers = get_writers();
+	if (std::any_of(writers.begin(), writers.end(), [&](const ExitWriter& writer) { return writer.write == write; })) {
+		return;
+	}
+	writers.push_back({.file_variable = file_variable, .label = label, .write = write});
+	static std::once_flag registered;
+	std::call_once(registered, [] { std::atexit(write_all_at_exit); });
+}
@@ -0,0 +1,40 @@
+#ifndef MINISIM_PROCESSTOTALS_H
+#define MINISIM_PROCESSTOTALS_H
+
+#include <atomic>
+#include <ostream>
+
+/// What metrics and perf share: totals kept for the whole process, and writing them out when it exits
+namespace process_totals {
+	/// @brief A list that only ever grows, of objects that live as long as the process (the function-local statics
+	/// of the instrumentation macros). Adding to it is lock-free, so it is safe from any thread at any time.
+	/// @tparam T has a `T* next` member the registry can reach, which it links to the object added before
+	template <typename T>
+	class Registry {
+	   public:
+		void add(T& node) noexcept {
+			node.next = last.load(std::memory_order_relaxed);
+			while (
+				!last.compare_exchange_weak(node.next, &node, std::memory_order_release, std::memory_order_relaxed)) {
+			}
+		}
+
+		/// @brief Calls @p visit with every object added so far, the last one first
+		template <typename Visit>
+		void for_each(Visit visit) const {
+			for (const T* node = last.load(std::memory_order_acquire); node != nullptr; node = node->next) {
+				visit(*node);
+			}
+		}
+
+	   private:
+		std::atomic<T*> last = nullptr;
+	};
+
+	/// @brief Has @p write called once the process exits, with the file named by the environment variable
+	/// @p file_variable, or with stderr if it is not set. Registering the same @p write again does nothing.
+	/// @param label what a failure to write the file is reported as, e.g. "METRICS"
+	void write_at_exit(const char* file_variable, const char* label, void (*write)(std::ostream& out));
+}  // namespace process_totals
+
+#endif  // MINISIM_PROCESSTOTALS_H
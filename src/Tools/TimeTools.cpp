@@ -1,71 +1,118 @@
 #include "TimeTools.h"
 
+#include <charconv>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
 namespace {
-	 
-	date::sys_time<std::chrono::milliseconds> parse(const std::string s) {
-		std::istringstream ss(s);
-		std::istream& is(ss);
-		std::string save;
-		is >> save;
-		std::istringstream in{save};
-		date::sys_time<std::chrono::milliseconds> tp;
-		in >> date::parse("%FT%TZ", tp);
-		if (in.fail()) {
-			in.clear();
-			in.exceptions(std::ios::failbit);
-			in.str(save);
-			in >> date::parse("%FT%T%Ez", tp);
+	/// @brief Reads a field of @p min_width to @p max_width digits at @p pos of @p s, and advances past it
+	/// @throws std::invalid_argument if there are too few digits, or the field is outside [min, max]
+	int read_field(const std::string_view s, size_t& pos, const size_t min_width, const size_t max_width, const int min,
+		const int max) {
+		size_t width = 0;
+		while (width < max_width && pos + width < s.size() && s[pos + width] >= '0' && s[pos + width] <= '9') {
+			++width;
+		}
+		if (width < min_width) {
+			throw std::invalid_argument("Invalid time field in: " + std::string(s));
+		}
+		int value = 0;
+		const char* const first = s.data() + pos;
+		std::from_chars(first, first + width, value);
+		if (value < min || value > max) {
+			throw std::invalid_argument("Time field out of range in: " + std::string(s));
+		}
+		pos += width;
+		return value;
+	}
+
+	/// @brief Skips the separator @p c at @p pos of @p s
+	/// @throws std::invalid_argument if it is not there
+	void expect(const std::string_view s, size_t& pos, const char c) {
+		if (pos >= s.size() || s[pos] != c) {
+			throw std::invalid_argument("Expected '" + std::string(1, c) + "' in time: " + std::string(s));
 		}
-		return tp;
+		++pos;
+	}
+
+	bool is_leap_year(const int year) {
+		return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+	}
+
+	int days_in_month(const int year, const int month) {
+		constexpr int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+		return month == 2 && is_leap_year(year) ? 29 : days[month - 1];
 	}
 
-	 
 	std::string to_format(const int number) {
 		std::stringstream ss;
 		ss << std::setw(2) << std::setfill('0') << number;
 		return ss.str();
 	}
-}   
-
-int parse_time(const std::string s) {
-	auto time = parse(s);
-	auto duration = time.time_since_epoch() / std::chrono::milliseconds(1);
-
-	 
-	duration /= 1000;
-	int64_t seconds = duration;
-
-	return seconds;
 }
 
- 
-SplitTime split_time(double time) {
-	return split_time(time_t(time));
-}
+int64_t parse_time(std::string_view s) {
+	// only the first whitespace separated token is the time
+	constexpr std::string_view whitespace = " \t\n\v\f\r";
+	const size_t start = s.find_first_not_of(whitespace);
+	s = start == std::string_view::npos ? std::string_view() : s.substr(start);
+	s = s.substr(0, s.find_first_of(whitespace));
 
- 
-SplitTime split_time(time_t t) {
-	SplitTime ret;
-	 
+	size_t pos = 0;
+	SplitTime split = {};
+	split.year = read_field(s, pos, 4, 4, 0, 9999);
+	expect(s, pos, '-');
+	split.month = read_field(s, pos, 1, 2, 1, 12);
+	expect(s, pos, '-');
+	split.day = read_field(s, pos, 1, 2, 1, days_in_month(split.year, split.month));
+	expect(s, pos, 'T');
+	split.hour = read_field(s, pos, 1, 2, 0, 23);
+	expect(s, pos, ':');
+	split.minute = read_field(s, pos, 1, 2, 0, 59);
+	expect(s, pos, ':');
+	split.second = read_field(s, pos, 1, 2, 0, 59);
 
-	tm ltm;               
-	gmtime_r(&t, &ltm);   
-	 
-	ret.year = ltm.tm_year + 1900;
-	 
-	ret.month = ltm.tm_mon + 1;
-	ret.day = ltm.tm_mday;
-	ret.hour = ltm.tm_hour;
-	ret.minute = ltm.tm_min;
-	ret.second = ltm.tm_sec;
+	// fractional seconds are truncated
+	if (pos < s.size() && s[pos] == '.') {
+		++pos;
+		const size_t digits = pos;
+		while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') {
+			++pos;
+		}
+		if (pos == digits) {
+			throw std::invalid_argument("Missing fractional seconds in time: " + std::string(s));
+		}
+	}
 
-	return ret;
+	int64_t offset = 0;
+	if (pos < s.size() && s[pos] == 'Z') {
+		++pos;
+	} else if (pos < s.size() && (s[pos] == '+' || s[pos] == '-')) {
+		const int sign = s[pos] == '-' ? -1 : 1;
+		++pos;
+		const int offset_hours = read_field(s, pos, 2, 2, 0, 23);
+		int offset_minutes = 0;
+		if (pos < s.size()) {
+			if (s[pos] == ':') {
+				++pos;
+			}
+			offset_minutes = read_field(s, pos, 2, 2, 0, 59);
+		}
+		offset = sign * (offset_hours * 3600 + offset_minutes * 60);
+	} else {
+		throw std::invalid_argument("Time has no UTC offset or 'Z': " + std::string(s));
+	}
+	if (pos != s.size()) {
+		throw std::invalid_argument("Trailing characters in time: " + std::string(s));
+	}
+
+	return unix_time(split) - offset;
 }
 
 std::string format_time_for_file(SplitTime s) {
-	 
 	std::stringstream formatted_time;
 	formatted_time << std::to_string(s.year) << "-" << to_format(s.month) << "-" << to_format(s.day) << "_"
 				   << to_format(s.hour) << "." << to_format(s.minute) << "." << to_format(s.second);
 	return formatted_time.str();
-}
\ No newline at end of file
+}
@@ -1,15 +1,16 @@
 #ifndef MINISIM_TIMETOOLS_H
 #define MINISIM_TIMETOOLS_H
-#include <chrono>
-#include <ctime>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
-#include "date/date.h"
-
-int parse_time(const std::string s);
+/// @brief Parses an ISO 8601 date-time, "YYYY-MM-DDTHH:MM:SS" with optional fractional seconds (truncated), ending in
+/// "Z" or a UTC offset ("+09:30", "+0930" or "+09"). The month, day and time fields may also have one digit
+/// ("2007-8-24T8:30:00Z"). Leading whitespace and anything after the first whitespace that
+/// follows are ignored.
+/// @return (Epoch Time) whole seconds
+/// @throws std::invalid_argument if the string is not such a date-time
+int64_t parse_time(std::string_view s);
 
 struct SplitTime final {
 	int year;
@@ -21,10 +22,67 @@ struct SplitTime final {
 	int nanosecond;
 };
 
-SplitTime split_time(double t);
+/// @brief Days since 1970-01-01 of a date of the proleptic Gregorian calendar (Howard Hinnant's days_from_civil)
+/// @param month 1 to 12
+/// @param day 1 to 31
+constexpr int64_t days_from_civil(int64_t year, int month, int day) {
+	year -= month <= 2 ? 1 : 0;
+	const int64_t era = (year >= 0 ? year : year - 399) / 400;
+	const int64_t year_of_era = year - era * 400;
+	const int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	const int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+	return era * 146097 + day_of_era - 719468;
+}
+
+/// @brief The date of a number of days since 1970-01-01 (Howard Hinnant's civil_from_days). Only the date fields of
+/// the result are set.
+constexpr SplitTime civil_from_days(int64_t days) {
+	days += 719468;
+	const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+	const int64_t day_of_era = days - era * 146097;
+	const int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	const int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	const int64_t shifted_month = (5 * day_of_year + 2) / 153;
+	const int64_t day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+	const int64_t month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+	const int64_t year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+	return {
+		.year = static_cast<int>(year),
+		.month = static_cast<int>(month),
+		.day = static_cast<int>(day),
+		.hour = 0,
+		.minute = 0,
+		.second = 0,
+		.nanosecond = 0,
+	};
+}
+
+/// @brief Splits Unix seconds into a UTC date and time, without going through gmtime
+constexpr SplitTime split_time(int64_t t) {
+	constexpr int64_t seconds_per_day = 86400;
+	const int64_t days = (t >= 0 ? t : t - (seconds_per_day - 1)) / seconds_per_day;
+	const int64_t seconds_of_day = t - days * seconds_per_day;
+	SplitTime split = civil_from_days(days);
+	split.hour = static_cast<int>(seconds_of_day / 3600);
+	split.minute = static_cast<int>(seconds_of_day % 3600 / 60);
+	split.second = static_cast<int>(seconds_of_day % 60);
+	return split;
+}
+
+/// @brief Same as above, with the fraction of a second in the nanosecond field
+constexpr SplitTime split_time(double t) {
+	// floor, as a constant expression
+	const auto whole_seconds = static_cast<int64_t>(t) - (static_cast<double>(static_cast<int64_t>(t)) > t ? 1 : 0);
+	SplitTime split = split_time(whole_seconds);
+	split.nanosecond = static_cast<int>((t - static_cast<double>(whole_seconds)) * 1e9);
+	return split;
+}
 
-SplitTime split_time(time_t t);
+/// @brief The Unix seconds of a UTC date and time (the nanosecond field is ignored), the inverse of split_time()
+constexpr int64_t unix_time(const SplitTime& s) {
+	return days_from_civil(s.year, s.month, s.day) * 86400 + s.hour * 3600 + s.minute * 60 + s.second;
+}
 
 std::string format_time_for_file(SplitTime s);
 
-#endif
\ No newline at end of file
+#endif
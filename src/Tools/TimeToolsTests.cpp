@@ -0,0 +1,56 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <ctime>
+#include <random>
+#include <stdexcept>
+
+#include "TimeTools.h"
+
+static_assert(days_from_civil(1970, 1, 1) == 0);
+static_assert(unix_time(split_time(int64_t{-1})) == -1);
+static_assert(split_time(int64_t{951782400}).month == 2 && split_time(int64_t{951782400}).day == 29);
+
+TEST_CASE("split_time matches gmtime", "[time]") {
+	std::mt19937_64 random(37);
+	std::uniform_int_distribution<int64_t> seconds(-4'000'000'000, 8'000'000'000);
+	for (int i = 0; i < 100000; ++i) {
+		const int64_t t = seconds(random);
+		const time_t time = t;
+		tm expected = {};
+		gmtime_r(&time, &expected);
+		const SplitTime split = split_time(t);
+		REQUIRE(split.year == expected.tm_year + 1900);
+		REQUIRE(split.month == expected.tm_mon + 1);
+		REQUIRE(split.day == expected.tm_mday);
+		REQUIRE(split.hour == expected.tm_hour);
+		REQUIRE(split.minute == expected.tm_min);
+		REQUIRE(split.second == expected.tm_sec);
+		REQUIRE(unix_time(split) == t);
+	}
+
+	const SplitTime fraction = split_time(-0.25);
+	CHECK(fraction.year == 1969);
+	CHECK(fraction.second == 59);
+	CHECK(fraction.nanosecond == 750000000);
+}
+
+TEST_CASE("parse_time", "[time]") {
+	CHECK(parse_time("2023-10-22T08:30:00Z") == 1697963400);
+	CHECK(parse_time("  2023-10-22T08:30:00.999Z trailing words") == 1697963400);
+	CHECK(parse_time("2023-10-22T18:00:00+09:30") == 1697963400);
+	CHECK(parse_time("2023-10-22T18:00:00+0930") == 1697963400);
+	CHECK(parse_time("2023-10-22T05:30:00-03") == 1697963400);
+	CHECK(parse_time("2024-02-29T00:00:00Z") == 1709164800);
+	CHECK(parse_time("2007-8-24T8:30:00+09:30") == 1187910000);
+
+	CHECK_THROWS_AS(parse_time(""), std::invalid_argument);
+	CHECK_THROWS_AS(parse_time("2023-10-22T08:30:00"), std::invalid_argument);
+	CHECK_THROWS_AS(parse_time("2023-02-29T08:30:00Z"), std::invalid_argument);
+	CHECK_THROWS_AS(parse_time("2023-10-22T24:00:00Z"), std::invalid_argument);
+	CHECK_THROWS_AS(parse_time("2023-10-22 08:30:00Z"), std::invalid_argument);
+	CHECK_THROWS_AS(parse_time("23-10-22T08:30:00Z"), std::invalid_argument);
+	CHECK_THROWS_AS(parse_time("2023-010-22T08:30:00Z"), std::invalid_argument);
+	CHECK_THROWS_AS(parse_time("2023-10-22T+8:30:00Z"), std::invalid_argument);
+	CHECK_THROWS_AS(parse_time("2023-10-22T08:30:00+09:3"), std::invalid_argument);
+	CHECK_THROWS_AS(parse_time("2023-10-22T08:30:00Zulu"), std::invalid_argument);
+}
@@ -0,0 +1,157 @@
+#include "Trace.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Json.h"
+
+namespace {
+	struct Event {
+		const char* name;
+		const char* arg_name;
+		double arg;
+		/// (ns) on the steady clock
+		std::int64_t start;
+		std::int64_t end;
+	};
+
+	/// @brief The spans of one thread. Only that thread writes them; they are read once it is done.
+	struct ThreadBuffer {
+		explicit ThreadBuffer(std::uint32_t thread_number)
+			: events(trace::TRACE_EVENTS_PER_THREAD), thread_number(thread_number) {}
+
+		std::vector<Event> events;
+		/// how many spans were recorded; span i is at events[i % TRACE_EVENTS_PER_THREAD]
+		std::atomic<std::uint64_t> num_recorded = 0;
+		const std::uint32_t thread_number;
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	};
+
+	/// Never destroyed, so threads still running while the process exits can keep recording
+	Registry& get_registry() {
+		static Registry* const registry = new Registry();
+		return *registry;
+	}
+
+	/// the buffer of the calling thread, made the first time it records a span
+	thread_local ThreadBuffer* thread_buffer = nullptr;
+
+	ThreadBuffer& get_thread_buffer() {
+		if (thread_buffer == nullptr) {
+			Registry& registry = get_registry();
+			const std::lock_guard lock(registry.mutex);
+			registry.buffers.push_back(
+				std::make_unique<ThreadBuffer>(static_cast<std::uint32_t>(registry.buffers.size() + 1)));
+			thread_buffer = registry.buffers.back().get();
+		}
+		return *thread_buffer;
+	}
+
+	void write_at_exit() {
+		const char* file = std::getenv("MINISIM_TRACE_FILE");
+		std::ofstream out(file);
+		trace::write_json(out);
+		if (!out) {
+			std::cerr << "[TRACE] Could not write " << file << "\n";
+		}
+	}
+
+	bool read_is_enabled() {
+		const char* file = std::getenv("MINISIM_TRACE_FILE");
+		if (file == nullptr || *file == '\0') {
+			return false;
+		}
+		std::atexit(write_at_exit);
+		return true;
+	}
+
+	void append_microseconds(std::string& line, std::int64_t nanoseconds) {
+		json::append_number(line, static_cast<double>(nanoseconds) / 1000.0);
+	}
+}  // namespace
+
+bool trace::is_enabled() noexcept {
+	static const bool enabled = read_is_enabled();
+	return enabled;
+}
+
+void trace::Span::record(std::int64_t end) noexcept {
+	ThreadBuffer& buffer = get_thread_buffer();
+	const std::uint64_t index = buffer.num_recorded.load(std::memory_order_relaxed);
+	buffer.events[index % TRACE_EVENTS_PER_THREAD] =
+		{.name = name, .arg_name = arg_name, .arg = arg, .start = start, .end = end};
+	buffer.num_recorded.store(index + 1, std::memory_order_release);
+}
+
+void trace::write_json(std::ostream& out) {
+	Registry& registry = get_registry();
+	const std::lock_guard lock(registry.mutex);
+
+	std::int64_t origin = std::numeric_limits<std::int64_t>::max();
+	std::uint64_t num_dropped = 0;
+	for (const auto& buffer : registry.buffers) {
+		const std::uint64_t num_recorded = buffer->num_recorded.load(std::memory_order_acquire);
+		const std::uint64_t num_kept = std::min(num_recorded, TRACE_EVENTS_PER_THREAD);
+		num_dropped += num_recorded - num_kept;
+		for (std::uint64_t index = num_recorded - num_kept; index < num_recorded; ++index) {
+			origin = std::min(origin, buffer->events[index % TRACE_EVENTS_PER_THREAD].start);
+		}
+	}
+
+	const std::string process = std::to_string(getpid());
+	std::string line = "{\"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_spans\": " +
+					   std::to_string(num_dropped) + "}, \"traceEvents\": [\n";
+	out << line;
+	line.clear();
+	bool first = true;
+	const auto begin_event = [&] {
+		if (!first) {
+			line += ",\n";
+		}
+		first = false;
+	};
+	for (const auto& buffer : registry.buffers) {
+		const std::string thread = std::to_string(buffer->thread_number);
+		begin_event();
+		line += R"({"name": "thread_name", "ph": "M", "pid": )" + process + ", \"tid\": " + thread +
+				", \"args\": {\"name\": \"thread " + thread + "\"}}";
+
+		const std::uint64_t num_recorded = buffer->num_recorded.load(std::memory_order_acquire);
+		const std::uint64_t num_kept = std::min(num_recorded, TRACE_EVENTS_PER_THREAD);
+		for (std::uint64_t index = num_recorded - num_kept; index < num_recorded; ++index) {
+			const Event& event = buffer->events[index % TRACE_EVENTS_PER_THREAD];
+			begin_event();
+			line += "{\"name\": ";
+			json::append_string(line, event.name);
+			line += ", \"ph\": \"X\", \"pid\": " + process + ", \"tid\": " + thread + ", \"ts\": ";
+			append_microseconds(line, event.start - origin);
+			line += ", \"dur\": ";
+			append_microseconds(line, event.end - event.start);
+			if (event.arg_name != nullptr) {
+				line += ", \"args\": {";
+				json::append_string(line, event.arg_name);
+				line += ": ";
+				json::append_number(line, event.arg);
+				line += '}';
+			}
+			line += '}';
+		}
+		out << line;
+		line.clear();
+	}
+	out << "\n]}\n" << std::flush;
+}
@@ -0,0 +1,94 @@
+#ifndef MINISIM_TRACE_H
+#define MINISIM_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/// @brief A timeline of spans per thread, written as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+///
+/// Code is instrumented with the macros, which compile to nothing unless the build enables them (cmake
+/// -DENABLE_TRACE=ON defines MINISIM_TRACE):
+///
+///     MINISIM_TRACE_SCOPE("weather.load");                    // a span over the rest of the enclosing scope
+///     MINISIM_TRACE_SCOPE_ARG("race", "speed", speed);        // with a number shown in its details
+///     MINISIM_TRACE_SPAN(day_span, "race.day", "day", 0);     // a named span, which can be ended and restarted
+///     MINISIM_TRACE_NEXT(day_span, 1);                        // ends it and starts the next one
+///
+/// Even then, spans are only recorded when the MINISIM_TRACE_FILE environment variable names the file to write the
+/// trace to when the process exits. Each thread records into its own ring buffer without locks, keeping its last
+/// TRACE_EVENTS_PER_THREAD spans.
+namespace trace {
+	/// the spans each thread keeps; older ones are overwritten
+	constexpr std::uint64_t TRACE_EVENTS_PER_THREAD = std::uint64_t{1} << 16;
+
+	/// @return whether spans are being recorded
+	bool is_enabled() noexcept;
+
+	/// @brief Writes every recorded span as Chrome trace-event JSON. Threads should be done recording by then.
+	void write_json(std::ostream& out);
+
+	/// @brief Records the time from its construction (or next()) to its destruction (or next()) as a span of the
+	/// calling thread
+	class Span {
+	   public:
+		/// @param name and @p arg_name must be string literals (or live as long as the process)
+		/// @param arg_name nullptr for no argument
+		explicit Span(const char* name, const char* arg_name = nullptr, double arg = 0.0) noexcept
+			: name(name), arg_name(arg_name), arg(arg), recording(is_enabled()) {
+			if (recording) {
+				start = now();
+			}
+		}
+		~Span() {
+			if (recording) {
+				record(now());
+			}
+		}
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+		/// @brief Ends this span and starts another of the same name, with a new argument
+		void next(double next_arg) noexcept {
+			if (recording) {
+				const std::int64_t time = now();
+				record(time);
+				start = time;
+			}
+			arg = next_arg;
+		}
+
+	   private:
+		static std::int64_t now() noexcept {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch())
+				.count();
+		}
+		void record(std::int64_t end) noexcept;
+
+		const char* name;
+		const char* arg_name;
+		double arg;
+		bool recording;
+		/// (ns) on the steady clock
+		std::int64_t start = 0;
+	};
+}  // namespace trace
+
+#ifdef MINISIM_TRACE
+#define MINISIM_TRACE_CONCAT_(a, b) a##b
+#define MINISIM_TRACE_CONCAT(a, b) MINISIM_TRACE_CONCAT_(a, b)
+#define MINISIM_TRACE_SCOPE(name) const ::trace::Span MINISIM_TRACE_CONCAT(trace_span_, __LINE__)(name)
+#define MINISIM_TRACE_SCOPE_ARG(name, arg_name, arg) \
+	const ::trace::Span MINISIM_TRACE_CONCAT(trace_span_, __LINE__)(name, arg_name, static_cast<double>(arg))
+#define MINISIM_TRACE_SPAN(variable, name, arg_name, arg) \
+	::trace::Span variable(name, arg_name, static_cast<double>(arg))
+#define MINISIM_TRACE_NEXT(variable, arg) variable.next(static_cast<double>(arg))
+#else
+#define MINISIM_TRACE_SCOPE(name) static_cast<void>(0)
+#define MINISIM_TRACE_SCOPE_ARG(name, arg_name, arg) static_cast<void>(0)
+#define MINISIM_TRACE_SPAN(variable, name, arg_name, arg) static_cast<void>(0)
+#define MINISIM_TRACE_NEXT(variable, arg) static_cast<void>(0)
+#endif
+
+#endif  // MINISIM_TRACE_H
@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Json.h"
+#include "Trace.h"
+
+TEST_CASE("trace: write_json", "[Trace]") {
+	SECTION("Writes the spans of every thread") {
+		// Read once, by the first span; the trace written at exit is thrown away
+		setenv("MINISIM_TRACE_FILE", "/dev/null", 1);
+		REQUIRE(trace::is_enabled());
+
+		std::vector<std::jthread> threads;
+		for (int thread = 0; thread < 2; ++thread) {
+			threads.emplace_back([] {
+				const trace::Span outer("test.outer");
+				trace::Span day("test.day", "day", 0);
+				day.next(1);
+			});
+		}
+		threads.clear();
+
+		std::ostringstream out;
+		trace::write_json(out);
+		const json::Value trace = json::parse(out.str());
+		const auto* events = trace.find("traceEvents")->get_if<json::Value::Array>();
+		REQUIRE(events != nullptr);
+
+		size_t num_outer = 0;
+		size_t num_days = 0;
+		for (const json::Value& event : *events) {
+			const std::string& name = *event.find("name")->get_if<std::string>();
+			if (name == "thread_name") {
+				CHECK(*event.find("ph")->get_if<std::string>() == "M");
+				continue;
+			}
+			CHECK(*event.find("ph")->get_if<std::string>() == "X");
+			CHECK(*event.find("ts")->get_if<double>() >= 0.0);
+			CHECK(*event.find("dur")->get_if<double>() >= 0.0);
+			if (name == "test.outer") {
+				++num_outer;
+				CHECK(event.find("args") == nullptr);
+			} else if (name == "test.day") {
+				CHECK(*event.find("args")->find("day")->get_if<double>() == static_cast<double>(num_days % 2));
+				++num_days;
+			}
+		}
+		CHECK(num_outer == 2);
+		CHECK(num_days == 4);
+		CHECK(*trace.find("otherData")->find("dropped_spans")->get_if<double>() == 0.0);
+	}
+}
@@ -0,0 +1,90 @@
+#include "WorkStealing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace {
+	/// The tasks of one thread: it takes from the back, thieves take from the front
+	struct TaskDeque {
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+
+		std::optional<size_t> pop_back() {
+			const std::lock_guard lock(mutex);
+			if (tasks.empty()) {
+				return std::nullopt;
+			}
+			const size_t task = tasks.back();
+			tasks.pop_back();
+			return task;
+		}
+
+		std::optional<size_t> steal_front() {
+			const std::lock_guard lock(mutex);
+			if (tasks.empty()) {
+				return std::nullopt;
+			}
+			const size_t task = tasks.front();
+			tasks.pop_front();
+			return task;
+		}
+	};
+}  // namespace
+
+void work_stealing::for_each_index(
+	const size_t num_tasks, size_t num_threads, const std::function<void(size_t)>& task) {
+	if (num_threads == 0) {
+		num_threads = std::max(1U, std::thread::hardware_concurrency());
+	}
+	num_threads = std::max<size_t>(1, std::min(num_threads, num_tasks));
+
+	std::vector<TaskDeque> deques(num_threads);
+	for (size_t index = 0; index < num_tasks; ++index) {
+		deques[index % num_threads].tasks.push_back(index);
+	}
+
+	std::atomic<bool> failed = false;
+	std::exception_ptr first_error;
+	std::mutex error_mutex;
+
+	const auto work = [&](const size_t self) {
+		// No task makes new tasks, so once every deque was seen empty there is nothing left to do
+		while (!failed.load(std::memory_order_relaxed)) {
+			std::optional<size_t> next = deques[self].pop_back();
+			for (size_t offset = 1; !next && offset < num_threads; ++offset) {
+				next = deques[(self + offset) % num_threads].steal_front();
+			}
+			if (!next) {
+				return;
+			}
+			try {
+				task(*next);
+			} catch (...) {
+				const std::lock_guard lock(error_mutex);
+				if (!first_error) {
+					first_error = std::current_exception();
+				}
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::jthread> threads;
+	threads.reserve(num_threads - 1);
+	for (size_t self = 1; self < num_threads; ++self) {
+		threads.emplace_back(work, self);
+	}
+	work(0);
+	threads.clear();
+
+	if (first_error) {
+		std::rethrow_exception(first_error);
+	}
+}
@@ -0,0 +1,18 @@
+#ifndef MINISIM_WORKSTEALING_H
+#define MINISIM_WORKSTEALING_H
+
+#include <cstddef>
+#include <functional>
+
+namespace work_stealing {
+	/// @brief Runs task(0) to task(num_tasks - 1) on up to num_threads threads (the calling thread is one of them) and
+	/// returns once all of them are done.
+	///
+	/// The tasks are dealt out round-robin to one deque per thread. Each thread works through its own deque from the
+	/// back and, once it is empty, steals from the front of the others, so long tasks do not leave threads idle.
+	/// @param num_threads 0 for std::thread::hardware_concurrency()
+	/// @throws the first exception a task threw, after every thread stopped (tasks not started yet are skipped)
+	void for_each_index(size_t num_tasks, size_t num_threads, const std::function<void(size_t)>& task);
+}  // namespace work_stealing
+
+#endif  // MINISIM_WORKSTEALING_H
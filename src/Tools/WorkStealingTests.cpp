@@ -0,0 +1,61 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "WorkStealing.h"
+
+TEST_CASE("work_stealing: for_each_index", "[WorkStealing]") {
+	SECTION("Runs every index exactly once") {
+		for (const size_t num_threads : {size_t{0}, size_t{1}, size_t{3}, size_t{64}}) {
+			std::vector<std::atomic<int>> runs(1000);
+			work_stealing::for_each_index(runs.size(), num_threads, [&](size_t index) { runs[index] += 1; });
+			for (const std::atomic<int>& count : runs) {
+				REQUIRE(count == 1);
+			}
+		}
+	}
+
+	SECTION("Does nothing without tasks") {
+		std::atomic<int> runs = 0;
+		work_stealing::for_each_index(0, 0, [&](size_t /*index*/) { runs += 1; });
+		work_stealing::for_each_index(0, 4, [&](size_t /*index*/) { runs += 1; });
+		CHECK(runs == 0);
+	}
+
+	SECTION("Rethrows the exception of a task") {
+		std::atomic<int> runs = 0;
+		CHECK_THROWS_WITH(work_stealing::for_each_index(100, 4,
+							  [&](size_t index) {
+								  runs += 1;
+								  if (index == 42) {
+									  throw std::runtime_error("task 42");
+								  }
+							  }),
+			"task 42");
+		CHECK(runs >= 1);
+	}
+
+	SECTION("Rethrows the first exception and skips the tasks not started yet") {
+		std::atomic<int> runs = 0;
+		std::string first_error;
+		try {
+			work_stealing::for_each_index(100, 1, [&](size_t index) {
+				runs += 1;
+				if (index % 10 == 0) {
+					if (first_error.empty()) {
+						first_error = "task " + std::to_string(index);
+					}
+					throw std::runtime_error("task " + std::to_string(index));
+				}
+			});
+			FAIL("no exception was thrown");
+		} catch (const std::runtime_error& error) {
+			CHECK(error.what() == first_error);
+		}
+		CHECK(runs < 100);
+	}
+}
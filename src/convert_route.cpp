@@ -0,0 +1,22 @@
+#include <exception>
+#include <iostream>
+
+#include "RaceConfig/Route/Route.h"
+#include "RaceConfig/WeatherStations/WeatherStations.h"
+
+/// Converts a CSV route file to the binary route format minisim maps without parsing (see Route::write_binary())
+int main(int argc, char** argv) {
+	if (argc != 3) {
+		std::cerr << "Usage: convert_route <route.csv> <route.bin>\n";
+		return 1;
+	}
+	try {
+		const Route route(argv[1], WeatherStations());
+		route.write_binary(argv[2]);
+		std::cout << "[OUTPUT] Wrote " << route.get_num_segments() << " segments to " << argv[2] << "\n";
+	} catch (const std::exception& error) {
+		std::cerr << "[ERROR] " << error.what() << "\n";
+		return 2;
+	}
+	return 0;
+}
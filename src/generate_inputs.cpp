@@ -0,0 +1,175 @@
+#include <getopt.h>
+
+#include <charconv>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "RaceConfig/Synthetic/SyntheticInputs.h"
+#include "RaceConfig/WeatherStations/WeatherStations.h"
+#include "Tools/TimeTools.h"
+
+namespace {
+	constexpr double DAY = 86400.0;
+
+	struct CommandLine {
+		/// "route" or "weather"
+		std::string command;
+		std::vector<std::string> files;
+		std::uint64_t seed = 1;
+		std::size_t num_segments = 6544;
+		std::size_t num_weather_stations = 23;
+		/// the day before the 2007 schedule
+		std::string start = "2007-08-23T00:00:00Z";
+		double days = 8.0;
+		/// (s)
+		double period = 3600.0;
+	};
+
+	void print_help() {
+		std::cout << "Usage: generate_inputs route [options] <route.csv> <weather_stations.csv>\n"
+				  << "       generate_inputs weather [options] <weather_stations.csv> <weather.csv>\n\n"
+				  << "Writes synthetic inputs shaped like the real ones, of any size. The same options always give\n"
+				  << "the same files.\n"
+				  << "route writes a route and the weather stations along it. weather writes forecasts, hourly by\n"
+				  << "default, for the weather stations of a weather stations file, such as\n"
+				  << "data/Stations/australia_stations.csv.\n\n"
+				  << "Options:\n"
+				  << "  -h, --help      display this help and exit\n"
+				  << "  -S, --seed      the seed (default 1)\n"
+				  << "  -n, --segments  route: how many segments (default 6544)\n"
+				  << "  -g, --stations  route: how many weather stations (default 23)\n"
+				  << "  -b, --start     weather: the first forecast, as an ISO 8601 date-time (default\n"
+				  << "                  2007-08-23T00:00:00Z, the day before the 2007 schedule)\n"
+				  << "  -d, --days      weather: how many days of forecasts (default 8)\n"
+				  << "  -p, --period    weather: seconds between forecasts (default 3600)\n";
+	}
+
+	double read_number(const std::string& text, const std::string& option) {
+		std::size_t end = 0;
+		try {
+			const double number = std::stod(text, &end);
+			if (end == text.size()) {
+				return number;
+			}
+		} catch (const std::exception&) {
+		}
+		throw std::invalid_argument(option + " takes a number, not \"" + text + "\"");
+	}
+
+	std::uint64_t read_seed(const std::string& text) {
+		std::uint64_t seed = 0;
+		const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), seed);
+		if (error != std::errc() || end != text.data() + text.size()) {
+			throw std::invalid_argument("--seed takes a whole number, not \"" + text + "\"");
+		}
+		return seed;
+	}
+
+	std::size_t read_count(const std::string& text, const std::string& option) {
+		const double number = read_number(text, option);
+		if (!(number >= 1.0) || number != static_cast<double>(static_cast<std::size_t>(number))) {
+			throw std::invalid_argument(option + " takes a whole number of at least 1, not \"" + text + "\"");
+		}
+		return static_cast<std::size_t>(number);
+	}
+
+	/// @return nullopt if the program should exit (after --help)
+	std::optional<CommandLine> read_args(int argc, char** argv) {
+		static const option long_options[] = {
+			{"help",     no_argument,       nullptr, 'h'},
+			{"seed",     required_argument, nullptr, 'S'},
+			{"segments", required_argument, nullptr, 'n'},
+			{"stations", required_argument, nullptr, 'g'},
+			{"start",    required_argument, nullptr, 'b'},
+			{"days",     required_argument, nullptr, 'd'},
+			{"period",   required_argument, nullptr, 'p'},
+			{nullptr,    0,                 nullptr, 0  },
+		};
+		CommandLine args;
+		opterr = 0;
+		int choice = 0;
+		while ((choice = getopt_long(argc, argv, "hS:n:g:b:d:p:", long_options, nullptr)) != -1) {
+			switch (choice) {
+				case 'h':
+					print_help();
+					return std::nullopt;
+				case 'S':
+					args.seed = read_seed(optarg);
+					break;
+				case 'n':
+					args.num_segments = read_count(optarg, "--segments");
+					break;
+				case 'g':
+					args.num_weather_stations = read_count(optarg, "--stations");
+					break;
+				case 'b':
+					args.start = optarg;
+					break;
+				case 'd':
+					args.days = read_number(optarg, "--days");
+					break;
+				case 'p':
+					args.period = read_number(optarg, "--period");
+					break;
+				default:
+					throw std::invalid_argument("unknown option (see --help)");
+			}
+		}
+		if (optind < argc) {
+			args.command = argv[optind++];
+		}
+		for (; optind < argc; ++optind) {
+			args.files.emplace_back(argv[optind]);
+		}
+		if ((args.command != "route" && args.command != "weather") || args.files.size() != 2) {
+			throw std::invalid_argument("expected route or weather and two files (see --help)");
+		}
+		return args;
+	}
+}  // namespace
+
+/// Writes synthetic routes and weather for tests and scaling benchmarks (see synthetic::generate_route() and
+/// synthetic::generate_weather())
+int main(int argc, char** argv) {
+	std::optional<CommandLine> args;
+	try {
+		args = read_args(argc, argv);
+		if (!args.has_value()) {
+			return 0;
+		}
+
+		if (args->command == "route") {
+			const synthetic::GeneratedRoute route = synthetic::generate_route({
+				.seed = args->seed,
+				.num_segments = args->num_segments,
+				.num_weather_stations = args->num_weather_stations,
+			});
+			synthetic::write_route(args->files[0], route.segments);
+			synthetic::write_weather_stations(args->files[1], route.weather_stations);
+			std::cout << "[OUTPUT] Wrote " << route.segments.size() << " segments to " << args->files[0] << " and "
+					  << route.weather_stations.size() << " weather stations to " << args->files[1] << "\n";
+		} else {
+			const WeatherStations stations(args->files[0]);
+			std::vector<GeographicalCoordinate> coordinates;
+			for (std::size_t index = 0; index < stations.size(); ++index) {
+				coordinates.push_back(stations[index]);
+			}
+			const auto start_time = static_cast<double>(parse_time(args->start));
+			synthetic::write_weather(args->files[1], coordinates,
+				{.seed = args->seed, .start_time = start_time, .end_time = start_time + args->days * DAY,
+					.period = args->period});
+			std::cout << "[OUTPUT] Wrote " << args->days << " days of weather for " << coordinates.size()
+					  << " weather stations to " << args->files[1] << "\n";
+		}
+	} catch (const std::exception& error) {
+		std::cerr << "[ERROR] " << error.what() << "\n";
+		return 2;
+	}
+	return 0;
+}
@@ -1,20 +1,32 @@
 #include <getopt.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <exception>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "BatchJobs/BatchJobs.h"
 #include "ConfigFile/ConfigFile.h"
 #include "Optimizer/Optimizer.h"
 #include "RaceConfig/RaceSchedule/RaceSchedule.h"
 #include "RaceConfig/Route/Route.h"
 #include "RaceConfig/Weather/Weather.h"
 #include "RaceConfig/WeatherStations/WeatherStations.h"
+#include "SimulationServer/SimulationServer.h"
 #include "SolarCar/SolarCar.h"
 #include "Tools/Conversions.h"
+#include "Tools/Trace.h"
 
 namespace {
 	struct CommandLine {
@@ -24,20 +36,36 @@ namespace {
 		std::string route_file;
 		std::string schedule_file;
 		std::string optimizer_type;
+		/// optional: where the weather is shared with other minisim processes on this machine
+		std::string weather_shared_file;
+		/// optional: a job manifest to run instead of the single run described by the other options
+		std::string jobs_file;
+		/// print how long loading each input took
+		bool verbose = false;
 	};
 
 	void print_help() {
 		std::cout << "Usage: Simulator -o <optimizer-type> -c <car.toml> -w <weather.csv> -r <route.csv> -t "
-					 "<weather_stations.csv> -s <schedule.toml>\n\n"
+					 "<weather_stations.csv> -s <schedule.toml>\n"
+				  << "       Simulator -j <manifest.toml>\n"
+				  << "       Simulator serve <server.toml>\n\n"
 				  << "Run the simulator to optimize your car!\n\n"
 				  << "Options:\n"
 				  << "  -h, --help        display this help and exit\n"
+				  << "  -v, --verbose     print how long loading each input took\n"
 				  << "  -o, --optimizer   the optimizer to use (e.g. linear, binary)\n"
 				  << "  -c, --car         the car config file to use (TOML)\n"
 				  << "  -w, --weather     the weather file to use (CSV)\n"
-				  << "  -r, --route       the route file to use (CSV)\n"
+				  << "  -r, --route       the route file to use (CSV, or binary from convert_route)\n"
 				  << "  -t, --stations    the weather stations being used (CSV)\n"
-				  << "  -s, --schedule    the schedule file to use (TOML)\n";
+				  << "  -s, --schedule    the schedule file to use (TOML)\n"
+				  << "  -m, --weather-shm share the loaded weather with other runs through this file (e.g.\n"
+				  << "                    /dev/shm/minisim-weather): attach to it if it holds the same window of the\n"
+				  << "                    same version of the weather file, write it otherwise\n"
+				  << "  -j, --jobs        run every job of a manifest (TOML), loading each input file once, and print\n"
+				  << "                    one JSON line per job as it finishes\n\n"
+				  << "serve keeps the inputs of <server.toml> loaded and answers JSON requests, one per line, on a\n"
+				  << "Unix domain socket, reloading the inputs whose files change\n";
 	}
 
 	CommandLine read_args(const int argc, char** argv) {
@@ -47,13 +75,16 @@ namespace {
 
 		 
 		static struct option long_options[] = {
-			{"car",      required_argument, nullptr, 'c'},
-			{"weather",  required_argument, nullptr, 'w'},
-			{"route",    required_argument, nullptr, 'r'},
-			{"schedule", required_argument, nullptr, 's'},
-			{"stations", required_argument, nullptr, 't'},
-			{"help",     no_argument,       nullptr, 'h'},
-			{nullptr,    0,                 nullptr, 0  },
+			{"car",         required_argument, nullptr, 'c'},
+			{"weather",     required_argument, nullptr, 'w'},
+			{"route",       required_argument, nullptr, 'r'},
+			{"schedule",    required_argument, nullptr, 's'},
+			{"stations",    required_argument, nullptr, 't'},
+			{"weather-shm", required_argument, nullptr, 'm'},
+			{"jobs",        required_argument, nullptr, 'j'},
+			{"verbose",     no_argument,       nullptr, 'v'},
+			{"help",        no_argument,       nullptr, 'h'},
+			{nullptr,       0,                 nullptr, 0  },
 		};
 
 		CommandLine config = {};
@@ -73,12 +104,16 @@ namespace {
 		uint8_t params_received = 0;
 
 		 
-		while ((choice = getopt_long(argc, argv, "hc:w:r:s:t:o:", long_options, &index)) != -1) {
+		while ((choice = getopt_long(argc, argv, "hvc:w:r:s:t:o:m:j:", long_options, &index)) != -1) {
 			switch (choice) {
 				case 'h': {
 					print_help();
 					exit(0);   
 				}
+				case 'v': {
+					config.verbose = true;
+					break;
+				}
 				case 'c': {
 					config.car_file = std::string(optarg);
 					std::cout << "[CONFIG] Car File: " << config.car_file << "\n";
@@ -115,6 +150,15 @@ namespace {
 					params_received |= Params::Optimizer;
 					break;
 				}
+				case 'm': {
+					config.weather_shared_file = std::string(optarg);
+					std::cout << "[CONFIG] Shared Weather File: " << config.weather_shared_file << "\n";
+					break;
+				}
+				case 'j': {
+					config.jobs_file = std::string(optarg);
+					break;
+				}
 				default: {
 					std::cerr << "Invalid option: " << static_cast<char>(choice) << "\n\n";
 					print_help();
@@ -122,7 +166,7 @@ namespace {
 				}
 			}
 		}
-		if (params_received != Params::All) {
+		if (params_received != Params::All && config.jobs_file.empty()) {
 			std::cerr << "\n[ERROR] Missing Option: Not all required options were passed.\n\n";
 			print_help();
 			exit(2);   
@@ -130,38 +174,187 @@ namespace {
 		std::cout << std::flush;
 		return config;
 	}
+
+	struct LoadedWeather {
+		Weather weather;
+		/// whether it is the copy another minisim shared
+		bool attached = false;
+	};
+
+	/// Loads the weather of the schedule, or attaches to the copy another minisim on this machine already shared
+	/// of the same window of the same version of the weather file
+	LoadedWeather load_weather(
+		const CommandLine& config, const WeatherStations& weather_stations, const RaceSchedule& schedule) {
+		const WeatherTimeWindow window = WeatherTimeWindow::from_schedule(schedule, WeatherTimeWindow::SCHEDULE_MARGIN);
+		if (config.weather_shared_file.empty()) {
+			return {.weather = Weather(config.weather_file, weather_stations, window), .attached = false};
+		}
+
+		// Shared weather of another weather file, another version of it or another window is replaced, and so is a
+		// file that is missing or cannot be attached
+		const WeatherSource source = WeatherSource::of(config.weather_file, window);
+		if (std::optional<Weather> attached = Weather::attach_shared(config.weather_shared_file, source)) {
+			return {.weather = std::move(*attached), .attached = true};
+		}
+		LoadedWeather loaded = {.weather = Weather(config.weather_file, weather_stations, window), .attached = false};
+		loaded.weather.write_shared(config.weather_shared_file, source);
+		return loaded;
+	}
+
+	using Clock = std::chrono::steady_clock;
+
+	/// @brief When each input was loaded, for --verbose
+	class LoadTimings {
+	   public:
+		explicit LoadTimings(Clock::time_point start) : start(start) {}
+
+		void record(std::string_view name, Clock::time_point task_start, Clock::time_point task_end) {
+			const std::lock_guard lock(mutex);
+			tasks.push_back({.name = name, .start = task_start, .end = task_end});
+		}
+
+		/// @brief Prints the loads in the order they started: how long each took, and when it started
+		void print(std::ostream& out) {
+			const std::lock_guard lock(mutex);
+			std::sort(tasks.begin(), tasks.end(), [](const Task& a, const Task& b) { return a.start < b.start; });
+			const auto milliseconds = [](Clock::duration duration) {
+				return std::chrono::duration<double, std::milli>(duration).count();
+			};
+			out << std::fixed << std::setprecision(3);
+			Clock::time_point last_end = start;
+			for (const Task& task : tasks) {
+				out << "[TIMING] " << std::left << std::setw(16) << task.name << std::right << std::setw(10)
+					<< milliseconds(task.end - task.start) << " ms, from " << milliseconds(task.start - start)
+					<< " ms\n";
+				last_end = std::max(last_end, task.end);
+			}
+			out << "[TIMING] " << std::left << std::setw(16) << "all inputs" << std::right << std::setw(10)
+				<< milliseconds(last_end - start) << " ms\n"
+				<< std::defaultfloat << std::setprecision(6);
+		}
+
+	   private:
+		struct Task {
+			std::string_view name;
+			Clock::time_point start;
+			Clock::time_point end;
+		};
+
+		Clock::time_point start;
+		std::mutex mutex;
+		std::vector<Task> tasks;
+	};
+
+	/// @brief Starts loading an input on its own thread, as soon as the inputs it is made from are loaded
+	/// @param load is called with the loaded dependencies
+	/// @return the input; an error of the load or of a dependency is thrown by its get()
+	template <typename Load, typename... Dependencies>
+	auto start_load(
+		LoadTimings& timings, const char* name, Load load, std::shared_future<Dependencies>... dependencies) {
+		return std::async(std::launch::async, [&timings, name, load = std::move(load), dependencies...] {
+			(dependencies.wait(), ...);
+			MINISIM_TRACE_SCOPE(name);
+			const auto start = Clock::now();
+			auto input = load(dependencies.get()...);
+			timings.record(name, start, Clock::now());
+			return input;
+		}).share();
+	}
 }   
 
 int main(int argc, char** argv) {
+	if (argc == 3 && std::string_view(argv[1]) == "serve") {
+		try {
+			SimulationServer server(ServerConfig::from_path(argv[2]));
+			server.serve();
+			return 0;
+		} catch (const std::exception& error) {
+			std::cerr << "[ERROR] " << error.what() << "\n";
+			return 2;
+		}
+	}
+
 	const auto config = read_args(argc, argv);
 
-	ConfigFile car_config;
-	{   
-		const auto car_config_opt = ConfigFile::from_path(config.car_file);
-		if (!car_config_opt.has_value()) {
-			std::cerr << "[ERROR] Car Config is Invalid\n";
-			exit(2);   
+	if (!config.jobs_file.empty()) {
+		// stdout only carries the job results, so it can be piped straight into other tools
+		try {
+			const size_t num_failed = run_jobs(JobManifest::from_path(config.jobs_file), std::cout);
+			return num_failed == 0 ? 0 : 1;
+		} catch (const std::exception& error) {
+			std::cerr << "[ERROR] " << error.what() << "\n";
+			return 2;
 		}
-		car_config = car_config_opt.value();
 	}
-	ConfigFile schedule_config;
-	{   
-		const auto schedule_config_opt = ConfigFile::from_path(config.schedule_file);
-		if (!schedule_config_opt.has_value()) {
-			std::cerr << "[ERROR] Schedule is Invalid\n";
-			exit(2);   
+
+	// Every input loads on its own thread as soon as what it is made from is loaded, so startup takes as long as the
+	// slowest chain of loads (the stations, then the weather) rather than all of them
+	LoadTimings timings(Clock::now());
+	const auto car_config = start_load(timings, "car config", [&] { return read_config(config.car_file); });
+	const auto schedule_config =
+		start_load(timings, "schedule config", [&] { return read_config(config.schedule_file); });
+	const auto weather_stations = start_load(
+		timings, "weather stations", [&] { return WeatherStations(config.weather_stations_file); });
+	const auto solarcar = start_load(
+		timings, "car", [](const ConfigFile& car_config) { return SolarCar(car_config); }, car_config);
+	const auto schedule = start_load(
+		timings, "schedule", [](const ConfigFile& schedule_config) { return RaceSchedule(schedule_config); },
+		schedule_config);
+	const auto weather = start_load(
+		timings, "weather",
+		[&](const WeatherStations& stations, const RaceSchedule& race_schedule) {
+			return load_weather(config, stations, race_schedule);
+		},
+		weather_stations, schedule);
+	const auto route = start_load(
+		timings, "route", [&](const WeatherStations& stations) { return Route(config.route_file, stations); },
+		weather_stations);
+
+	// The loads only report from here, so their output is not interleaved. Every input that failed is reported, except
+	// those that only failed because what they are made from did; the configs keep the messages they always had
+	std::vector<std::string> load_errors;
+	const auto loaded = [&load_errors](const auto& input, const char* message = nullptr) {
+		try {
+			input.get();
+			return true;
+		} catch (const std::exception& error) {
+			load_errors.emplace_back(message != nullptr ? message : error.what());
+			return false;
 		}
-		schedule_config = schedule_config_opt.value();
+	};
+	const bool car_config_loaded = loaded(car_config, "Car Config is Invalid");
+	const bool schedule_loaded = loaded(schedule_config, "Schedule is Invalid") && loaded(schedule);
+	const bool weather_stations_loaded = loaded(weather_stations);
+	if (car_config_loaded) {
+		loaded(solarcar);
+	}
+	if (weather_stations_loaded) {
+		loaded(route);
+	}
+	if (weather_stations_loaded && schedule_loaded) {
+		loaded(weather);
+	}
+	if (!load_errors.empty()) {
+		for (const std::string& error : load_errors) {
+			std::cerr << "[ERROR] " << error << "\n";
+		}
+		return 2;
 	}
 
-	const auto solarcar = SolarCar(car_config);
-	const auto weather_stations = WeatherStations(config.weather_stations_file);
-	const auto weather = Weather(config.weather_file, weather_stations);
-	const auto route = Route(config.route_file, weather_stations);
-	const auto schedule = RaceSchedule(schedule_config);
-
-	const std::unique_ptr<const Optimizer> optimizer =
-		Optimizer::create_optimizer(config.optimizer_type, solarcar, weather, route, schedule);
+	std::unique_ptr<const Optimizer> optimizer;
+	try {
+		if (weather.get().attached) {
+			std::cout << "[CONFIG] Attached to Shared Weather\n";
+		}
+		optimizer = Optimizer::create_optimizer(
+			config.optimizer_type, solarcar.get(), weather.get().weather, route.get(), schedule.get());
+	} catch (const std::exception& error) {
+		std::cerr << "[ERROR] " << error.what() << "\n";
+		return 2;
+	}
+	if (config.verbose) {
+		timings.print(std::cout);
+	}
 
 	const auto solution_opt = optimizer->optimize_race();
 	constexpr int precision = 5;
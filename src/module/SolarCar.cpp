@@ -1,6 +1,7 @@
 #include "SolarCar.h"
 
 #include "ConfigFile/ConfigFile.h"
+#include "ConfigFile/ConfigSchema.h"
 #include "SolarCar/Aerobody/Aerobody.h"
 #include "SolarCar/Array/Array.h"
 #include "SolarCar/Battery/Battery.h"
@@ -37,34 +38,73 @@
  
  
 
-SolarCar::SolarCar(const ConfigFile& car_config)
-	: aerobody(0, 0), array(0, 0), battery(0, 0, 0, 0), motor(0, 0), tire({}, 0), mass(0), wheel_radius(0) {
-	mass = car_config.get_force<double>("mass");                        
-	wheel_radius = car_config.get_force<double>("tire.wheel-radius");   
+namespace {
+	/// The numbers of a car config file
+	struct CarParameters {
+		double mass;
+		double wheel_radius;
+		double drag_coefficient;
+		double frontal_area;
+		double array_area;
+		double array_efficiency;
+		double battery_capacity;
+		double pack_resistance;
+		double min_voltage;
+		double max_voltage;
+		double hysteresis_loss;
+		double eddy_current_loss_coefficient;
+		double tire_alpha;
+		double tire_beta;
+		double tire_a;
+		double tire_b;
+		double tire_c;
+		double tire_pressure;
+	};
 
-	const auto aerobody_config = car_config.get_force<ConfigFile>("aerobody");
-	aerobody = Aerobody(
-		aerobody_config.get_force<double>("drag-coefficient"), aerobody_config.get_force<double>("frontal-area"));
+	const ConfigSchema<CarParameters>& car_schema() {
+		static const auto schema = ConfigSchema<CarParameters>()
+									   .bind("mass", &CarParameters::mass)
+									   .bind("tire.wheel-radius", &CarParameters::wheel_radius)
+									   .bind("aerobody.drag-coefficient", &CarParameters::drag_coefficient)
+									   .bind("aerobody.frontal-area", &CarParameters::frontal_area)
+									   .bind("array.area", &CarParameters::array_area)
+									   .bind("array.efficiency", &CarParameters::array_efficiency)
+									   .bind("battery.capacity", &CarParameters::battery_capacity)
+									   .bind("battery.pack-resistance", &CarParameters::pack_resistance)
+									   .bind("battery.min-voltage", &CarParameters::min_voltage)
+									   .bind("battery.max-voltage", &CarParameters::max_voltage)
+									   .bind("motor.hysteresis-loss", &CarParameters::hysteresis_loss)
+									   .bind("motor.eddy-current-loss-coefficient",
+										   &CarParameters::eddy_current_loss_coefficient)
+									   .bind("tire.alpha", &CarParameters::tire_alpha)
+									   .bind("tire.beta", &CarParameters::tire_beta)
+									   .bind("tire.a", &CarParameters::tire_a)
+									   .bind("tire.b", &CarParameters::tire_b)
+									   .bind("tire.c", &CarParameters::tire_c)
+									   .bind("tire.pressure", &CarParameters::tire_pressure);
+		return schema;
+	}
 
-	const auto array_config = car_config.get_force<ConfigFile>("array");
-	array = Array(array_config.get_force<double>("area"), array_config.get_force<double>("efficiency"));
+	SolarCar make_car(const CarParameters& parameters) {
+		return {
+			Aerobody(parameters.drag_coefficient, parameters.frontal_area),
+			Array(parameters.array_area, parameters.array_efficiency),
+			Battery(parameters.battery_capacity, parameters.pack_resistance, parameters.min_voltage,
+				parameters.max_voltage),
+			Motor(parameters.hysteresis_loss, parameters.eddy_current_loss_coefficient),
+			Tire(
+				{
+					.alpha = parameters.tire_alpha,
+					.beta = parameters.tire_beta,
+					.a = parameters.tire_a,
+					.b = parameters.tire_b,
+					.c = parameters.tire_c,
+				},
+				parameters.tire_pressure),
+			parameters.mass,
+			parameters.wheel_radius,
+		};
+	}
+}  // namespace
 
-	const auto battery_config = car_config.get_force<ConfigFile>("battery");
-	battery = Battery(battery_config.get_force<double>("capacity"), battery_config.get_force<double>("pack-resistance"),
-		battery_config.get_force<double>("min-voltage"), battery_config.get_force<double>("max-voltage"));
-
-	const auto motor_config = car_config.get_force<ConfigFile>("motor");
-	motor = Motor(motor_config.get_force<double>("hysteresis-loss"),
-		motor_config.get_force<double>("eddy-current-loss-coefficient"));
-
-	const auto tire_config = car_config.get_force<ConfigFile>("tire");
-	tire = Tire(
-		{
-			.alpha = tire_config.get_force<double>("alpha"),
-			.beta = tire_config.get_force<double>("beta"),
-			.a = tire_config.get_force<double>("a"),
-			.b = tire_config.get_force<double>("b"),
-			.c = tire_config.get_force<double>("c"),
-		},
-		tire_config.get_force<double>("pressure"));
-}
+SolarCar::SolarCar(const ConfigFile& car_config) : SolarCar(make_car(car_schema().extract(car_config))) {}
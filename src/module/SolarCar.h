@@ -31,6 +31,7 @@ class SolarCar {
 		  tire(tire),
 		  mass(mass),
 		  wheel_radius(wheel_radius) {}
+	/// @throws ConfigSchemaError listing every missing or mistyped number of the car config
 	explicit SolarCar(const ConfigFile& car_config);
 };
 